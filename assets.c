@@ -84,6 +84,17 @@ get_small_font(void) {
   return small_font;
 }
 
+TTF_Font*
+open_scaled_font(TTF_Font *font, double scale) {
+  int size = font == large_font ? LARGE_FONT_SIZE
+    : font == medium_font ? MEDIUM_FONT_SIZE
+    : font == small_font ? SMALL_FONT_SIZE : 0;
+  if (!size) {
+    return 0;
+  }
+  return TTF_OpenFont(FONT_FILE, SDL_max((int) (size*scale + 0.5), 1));
+}
+
 SDL_Texture*
 get_tetris_block_img(void) {
   ASSERT_VALID_ASSETS();
@@ -25,6 +25,14 @@ get_medium_font(void);
 TTF_Font*
 get_small_font(void);
 
+/**
+ * Opens another copy of font (one of the three above) at its size times
+ * scale, for drawing text at that scale. Returns null if it couldn't, without
+ * touching the error stack, so any thread can call it.
+ */
+TTF_Font*
+open_scaled_font(TTF_Font *font, double scale);
+
 void
 destroy_assets(void);
 
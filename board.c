@@ -0,0 +1,547 @@
+#include <SDL2/SDL.h>
+
+#include "bytes.h"
+#include "error.h"
+#include "2D.h"
+#include "board.h"
+
+/*
+ * Pieces and rotations follow SRS (the Super Rotation System). Each piece
+ * lives in a box (4x4 for I, 2x2 for O, 3x3 for the rest) which is what gets
+ * rotated, so pieces turn around the box's center instead of drifting.
+ * Everything here has y growing upwards, with 0,0 the box's bottom-left.
+ */
+
+struct Shape {
+  // One bit mask per row of the box, bit x is column x.
+  Uint8 masks[NUM_PIECE_PARTS];
+  GridPoint2D blocks[NUM_PIECE_PARTS];
+};
+
+enum {
+  NUM_ROTATIONS = 4,
+  // Positions tried, in order, when rotating: SRS' kick tests.
+  NUM_KICKS = 5
+};
+
+// By kind, then rotation (0 is how pieces spawn, then clockwise).
+static const struct Shape SHAPES[NUM_DIFFERENT_PIECES][NUM_ROTATIONS] = {
+  { // I
+    {{0x0, 0x0, 0xf, 0x0}, {{0, 2}, {1, 2}, {2, 2}, {3, 2}}},
+    {{0x4, 0x4, 0x4, 0x4}, {{2, 0}, {2, 1}, {2, 2}, {2, 3}}},
+    {{0x0, 0xf, 0x0, 0x0}, {{0, 1}, {1, 1}, {2, 1}, {3, 1}}},
+    {{0x2, 0x2, 0x2, 0x2}, {{1, 0}, {1, 1}, {1, 2}, {1, 3}}}
+  },
+  { // O
+    {{0x3, 0x3, 0x0, 0x0}, {{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+    {{0x3, 0x3, 0x0, 0x0}, {{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+    {{0x3, 0x3, 0x0, 0x0}, {{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+    {{0x3, 0x3, 0x0, 0x0}, {{0, 0}, {1, 0}, {0, 1}, {1, 1}}}
+  },
+  { // S
+    {{0x0, 0x3, 0x6, 0x0}, {{0, 1}, {1, 1}, {1, 2}, {2, 2}}},
+    {{0x4, 0x6, 0x2, 0x0}, {{2, 0}, {1, 1}, {2, 1}, {1, 2}}},
+    {{0x3, 0x6, 0x0, 0x0}, {{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
+    {{0x2, 0x3, 0x1, 0x0}, {{1, 0}, {0, 1}, {1, 1}, {0, 2}}}
+  },
+  { // Z
+    {{0x0, 0x6, 0x3, 0x0}, {{1, 1}, {2, 1}, {0, 2}, {1, 2}}},
+    {{0x2, 0x6, 0x4, 0x0}, {{1, 0}, {1, 1}, {2, 1}, {2, 2}}},
+    {{0x6, 0x3, 0x0, 0x0}, {{1, 0}, {2, 0}, {0, 1}, {1, 1}}},
+    {{0x1, 0x3, 0x2, 0x0}, {{0, 0}, {0, 1}, {1, 1}, {1, 2}}}
+  },
+  { // L
+    {{0x0, 0x7, 0x4, 0x0}, {{0, 1}, {1, 1}, {2, 1}, {2, 2}}},
+    {{0x6, 0x2, 0x2, 0x0}, {{1, 0}, {2, 0}, {1, 1}, {1, 2}}},
+    {{0x1, 0x7, 0x0, 0x0}, {{0, 0}, {0, 1}, {1, 1}, {2, 1}}},
+    {{0x2, 0x2, 0x3, 0x0}, {{1, 0}, {1, 1}, {0, 2}, {1, 2}}}
+  },
+  { // J
+    {{0x0, 0x7, 0x1, 0x0}, {{0, 1}, {1, 1}, {2, 1}, {0, 2}}},
+    {{0x2, 0x2, 0x6, 0x0}, {{1, 0}, {1, 1}, {1, 2}, {2, 2}}},
+    {{0x4, 0x7, 0x0, 0x0}, {{2, 0}, {0, 1}, {1, 1}, {2, 1}}},
+    {{0x3, 0x2, 0x2, 0x0}, {{0, 0}, {1, 0}, {1, 1}, {1, 2}}}
+  },
+  { // T
+    {{0x0, 0x7, 0x2, 0x0}, {{0, 1}, {1, 1}, {2, 1}, {1, 2}}},
+    {{0x2, 0x6, 0x2, 0x0}, {{1, 0}, {1, 1}, {2, 1}, {1, 2}}},
+    {{0x2, 0x7, 0x0, 0x0}, {{1, 0}, {0, 1}, {1, 1}, {2, 1}}},
+    {{0x2, 0x3, 0x2, 0x0}, {{1, 0}, {0, 1}, {1, 1}, {1, 2}}}
+  }
+};
+
+// Width of each piece's box.
+static const int BOX_SIZE[NUM_DIFFERENT_PIECES] = {4, 2, 3, 3, 3, 3, 3};
+
+/*
+ * Offsets tried when rotating from a rotation, clockwise ([0]) or counter
+ * clockwise ([1]).
+ */
+typedef GridPoint2D KickTable[NUM_ROTATIONS][2][NUM_KICKS];
+
+static const KickTable KICKS_JLSTZ = {
+  {{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}},
+   {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}},
+  {{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},
+   {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}},
+  {{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},
+   {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}},
+  {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},
+   {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}}
+};
+
+static const KickTable KICKS_I = {
+  {{{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}},
+   {{0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1}}},
+  {{{0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1}},
+   {{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}}},
+  {{{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}},
+   {{0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1}}},
+  {{{0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1}},
+   {{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}}}
+};
+
+// O doesn't really turn, so it doesn't kick either.
+static const KickTable KICKS_O;
+
+/**
+ * xorshift32. Each board has its own generator so games can be replayed from
+ * their seed, no matter how many other games are going on.
+ */
+static Uint32
+next_random(struct Board *b) {
+  Uint32 x = b->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  b->rng = x;
+  return x;
+}
+
+/**
+ * Zobrist key of a cell: splitmix64 of its index, so there's no table to
+ * set up.
+ */
+static Uint64
+cell_key(int y, int x) {
+  Uint64 z = (Uint64) (y*PANEL_COLS + x + 1)*0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static Uint64
+row_key(int y, unsigned row) {
+  Uint64 key = 0;
+  for (int x = 0; row; x++, row >>= 1) {
+    if (row & 1) {
+      key ^= cell_key(y, x);
+    }
+  }
+  return key;
+}
+
+static void
+set_shape(struct BoardPiece *p, int rotation) {
+  p->rotation = rotation;
+  SDL_memcpy(p->blocks, SHAPES[p->kind][rotation].blocks,
+    sizeof p->blocks);
+}
+
+static void
+set_next_piece(struct Board *b, int kind) {
+  b->next.kind = kind;
+  set_shape(&b->next, 0);
+
+  // Centered, with its highest block on the top row.
+  const Uint8 *masks = SHAPES[kind][0].masks;
+  int top = NUM_PIECE_PARTS - 1;
+  while (!masks[top]) {
+    top--;
+  }
+  b->next.relative = (GridPoint2D) {
+    .x = (PANEL_COLS - BOX_SIZE[kind])/2,
+    .y = PANEL_ROWS - 1 - top
+  };
+}
+
+static void
+pick_next_piece(struct Board *b) {
+  set_next_piece(b, next_random(b) % NUM_DIFFERENT_PIECES);
+}
+
+void
+board_set_piece(struct BoardPiece *p, int kind, int rotation,
+                GridPoint2D relative)
+{
+  SDL_assert(kind >= 0 && kind < NUM_DIFFERENT_PIECES);
+  p->kind = kind;
+  p->relative = relative;
+  set_shape(p, rotation & (NUM_ROTATIONS - 1));
+}
+
+void
+board_reset(struct Board *b, Uint32 seed) {
+  SDL_memset(b->cells, 0, sizeof b->cells);
+  SDL_memset(b->rows, 0, sizeof b->rows);
+  b->hash = 0;
+  // xorshift gets stuck on 0.
+  b->rng = seed ? seed : 0x9E3779B9u;
+  b->points = 0;
+  b->lines = 0;
+  b->pieces = 0;
+  b->falling.kind = NO_PIECE;
+  pick_next_piece(b);
+}
+
+int
+board_is_falling(const struct Board *b) {
+  return b->falling.kind != NO_PIECE;
+}
+
+/**
+ * Whether a shape with its box's bottom-left at x,y would overlap the walls,
+ * the floor or blocks on the board. Rows above the top are free.
+ */
+static int
+shape_collides(const struct Board *b, const struct Shape *s, int x, int y) {
+  for (int k = 0; k < NUM_PIECE_PARTS; k++) {
+    unsigned mask = s->masks[k];
+    if (!mask) {
+      continue;
+    }
+    int row = y + k;
+    if (row < 0) {
+      return 1;
+    }
+    unsigned placed;
+    if (x >= 0) {
+      placed = mask << x;
+    }
+    else {
+      // Anything shifted out went through the left wall.
+      if (mask & ((1u << -x) - 1)) {
+        return 1;
+      }
+      placed = mask >> -x;
+    }
+    if (placed & ~(unsigned) FULL_ROW) {
+      return 1;
+    }
+    if (row < PANEL_ROWS && (b->rows[row] & placed)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+board_collides(const struct Board *b, const struct BoardPiece *p) {
+  return shape_collides(b, &SHAPES[p->kind][p->rotation], p->relative.x,
+    p->relative.y);
+}
+
+int
+board_spawn(struct Board *b) {
+  SDL_assert(!board_is_falling(b));
+  b->falling = b->next;
+  b->pieces++;
+  pick_next_piece(b);
+  return board_collides(b, &b->falling) ? -1 : 0;
+}
+
+int
+board_move(struct Board *b, int dx, int dy) {
+  SDL_assert(board_is_falling(b));
+  GridPoint2D *rel = &b->falling.relative;
+  rel->x += dx;
+  rel->y += dy;
+  if (board_collides(b, &b->falling)) {
+    rel->x -= dx;
+    rel->y -= dy;
+    return 0;
+  }
+  return 1;
+}
+
+int
+board_drop_distance(const struct Board *b) {
+  SDL_assert(board_is_falling(b));
+
+  // The piece as one bit mask per row, starting from its lowest row.
+  Uint16 masks[NUM_PIECE_PARTS] = {0};
+  const struct BoardPiece *p = &b->falling;
+  int bottom = PANEL_ROWS, top = 0;
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    bottom = SDL_min(bottom, p->relative.y + p->blocks[i].y);
+    top = SDL_max(top, p->relative.y + p->blocks[i].y);
+  }
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    int y = p->relative.y + p->blocks[i].y - bottom;
+    masks[y] |= 1 << (p->relative.x + p->blocks[i].x);
+  }
+
+  int height = top - bottom + 1;
+  int d = 0;
+  for (; d < bottom; d++) {
+    int y = bottom - d - 1;
+    int hit = 0;
+    for (int k = 0; k < height && y + k < PANEL_ROWS; k++) {
+      hit |= b->rows[y + k] & masks[k];
+    }
+    if (hit) {
+      break;
+    }
+  }
+  return d;
+}
+
+int
+board_drop(struct Board *b, int max_rows) {
+  int rows = SDL_min(max_rows, board_drop_distance(b));
+  b->falling.relative.y -= rows;
+  return rows;
+}
+
+int
+board_level(const struct Board *b) {
+  return SDL_min(MAX_LEVEL, b->lines/LINES_PER_LEVEL);
+}
+
+Uint32
+board_gravity(int level) {
+  static const Uint32 GRAVITY[MAX_LEVEL + 1] = {
+    GRAVITY_ONE/18, GRAVITY_ONE/15, GRAVITY_ONE/12, GRAVITY_ONE/10,
+    GRAVITY_ONE/8, GRAVITY_ONE/6, GRAVITY_ONE/5, GRAVITY_ONE/4,
+    GRAVITY_ONE/3, GRAVITY_ONE/2, GRAVITY_ONE, 2*GRAVITY_ONE,
+    3*GRAVITY_ONE, 5*GRAVITY_ONE, 10*GRAVITY_ONE, MAX_GRAVITY
+  };
+  SDL_assert(level >= 0);
+  return GRAVITY[SDL_min(level, MAX_LEVEL)];
+}
+
+int
+board_rotate(struct Board *b, int dir) {
+  SDL_assert(board_is_falling(b));
+  SDL_assert(dir == 1 || dir == -1);
+  struct BoardPiece *p = &b->falling;
+  int to = (p->rotation + dir) & (NUM_ROTATIONS - 1);
+  const struct Shape *shape = &SHAPES[p->kind][to];
+  const KickTable *table = p->kind == PIECE_I ? &KICKS_I
+    : p->kind == PIECE_O ? &KICKS_O : &KICKS_JLSTZ;
+  const GridPoint2D *kicks = (*table)[p->rotation][dir < 0];
+
+  for (int i = 0; i < NUM_KICKS; i++) {
+    int x = p->relative.x + kicks[i].x;
+    int y = p->relative.y + kicks[i].y;
+    if (!shape_collides(b, shape, x, y)) {
+      p->relative = (GridPoint2D) {x, y};
+      set_shape(p, to);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void
+eliminate_line(struct Board *b, int line) {
+  b->hash ^= row_key(line, b->rows[line]);
+  for (int i = line+1; i < PANEL_ROWS; i++) {
+    // Row i moves down to i-1, so its cells' keys change.
+    b->hash ^= row_key(i, b->rows[i]) ^ row_key(i-1, b->rows[i]);
+    SDL_memcpy(b->cells[i-1], b->cells[i], PANEL_COLS);
+    b->rows[i-1] = b->rows[i];
+  }
+  SDL_memset(b->cells[PANEL_ROWS-1], 0, PANEL_COLS);
+  b->rows[PANEL_ROWS-1] = 0;
+}
+
+static void
+try_score(struct Board *b, struct LockResult *result) {
+  int pts = 0;
+  int upper_bound = PANEL_ROWS;
+  int i = 0;
+  int lines = 0;
+  Uint32 removed_rows = 0;
+  while (i < upper_bound) {
+    if (b->rows[i] == FULL_ROW) {
+      eliminate_line(b, i);
+      // Rows above a removed one shift down, so i is lines rows below where
+      // this one started.
+      removed_rows |= 1u << (i + lines);
+      // 1, 2 or 3 points depending on how high the player is (=D).
+      pts += i < 5 ? 1 : (i < 13 ? 2 : 3);
+      upper_bound--;
+      lines++;
+    }
+    else {
+      i++;
+    }
+  }
+  if (lines > 0) {
+    // Each extra line you remove, you should double your points. If a line
+    // gives you P points, removing 2 lines will give you 2P points, but
+    // removing 3 lines (at once) will give you 4P; 4 lines 8P.
+    pts <<= lines - 1;
+  }
+  b->points += pts;
+  b->lines += lines;
+  result->lines = lines;
+  result->removed_rows = removed_rows;
+  result->points = pts;
+}
+
+void
+board_fixate(struct Board *b, struct LockResult *result) {
+  SDL_assert(board_is_falling(b));
+  const GridPoint2D *rel = &b->falling.relative;
+  const GridPoint2D *blocks = b->falling.blocks;
+
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    int x = rel->x + blocks[i].x;
+    int y = rel->y + blocks[i].y;
+    if (y >= PANEL_ROWS) {
+      continue;
+    }
+    b->cells[y][x] = b->falling.kind + 1;
+    b->rows[y] |= 1 << x;
+    b->hash ^= cell_key(y, x);
+  }
+  b->falling.kind = NO_PIECE;
+  try_score(b, result);
+}
+
+int
+board_place(const struct Board *b, int kind, int rotation, int x,
+            struct Board *out)
+{
+  *out = *b;
+  struct BoardPiece *p = &out->falling;
+  // With the whole box inside the board.
+  board_set_piece(p, kind, rotation,
+    (GridPoint2D) {x, PANEL_ROWS - NUM_PIECE_PARTS});
+  if (board_collides(out, p)) {
+    return -1;
+  }
+  board_drop(out, PANEL_ROWS);
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    if (p->relative.y + p->blocks[i].y >= PANEL_ROWS) {
+      return -1;
+    }
+  }
+
+  struct LockResult lock;
+  board_fixate(out, &lock);
+  return lock.lines;
+}
+
+void
+board_save(const struct Board *b, Uint8 *out) {
+  const Uint8 *cells = &b->cells[0][0];
+  for (int i = 0; i < PANEL_ROWS*PANEL_COLS; i += 2) {
+    *out++ = cells[i] | cells[i+1] << 4;
+  }
+  const struct BoardPiece *f = &b->falling;
+  *out++ = (Uint8) f->kind;
+  *out++ = f->rotation;
+  *out++ = (Uint8) f->relative.x;
+  *out++ = (Uint8) f->relative.y;
+  *out++ = b->next.kind;
+  out = put_u32(out, b->rng);
+  out = put_u32(out, b->points);
+  out = put_u32(out, b->lines);
+  put_u32(out, b->pieces);
+}
+
+int
+board_load(struct Board *b, const Uint8 *in) {
+  struct Board l;
+  Uint8 *cells = &l.cells[0][0];
+  for (int i = 0; i < PANEL_ROWS*PANEL_COLS; i += 2, in++) {
+    cells[i] = *in & 0xF;
+    cells[i+1] = *in >> 4;
+    COND_ERET(cells[i] > NUM_DIFFERENT_PIECES
+      || cells[i+1] > NUM_DIFFERENT_PIECES, -1, "Bad cell in saved board.");
+  }
+  l.hash = 0;
+  for (int y = 0; y < PANEL_ROWS; y++) {
+    l.rows[y] = 0;
+    for (int x = 0; x < PANEL_COLS; x++) {
+      l.rows[y] |= (l.cells[y][x] != 0) << x;
+    }
+    l.hash ^= row_key(y, l.rows[y]);
+  }
+
+  int kind = (Sint8) in[0];
+  int rotation = in[1];
+  GridPoint2D relative = {(Sint8) in[2], (Sint8) in[3]};
+  int next_kind = in[4];
+  in += 5;
+  COND_ERET(kind < NO_PIECE || kind >= NUM_DIFFERENT_PIECES
+    || rotation >= NUM_ROTATIONS || next_kind >= NUM_DIFFERENT_PIECES, -1,
+    "Bad piece in saved board.");
+  if (kind == NO_PIECE) {
+    l.falling.kind = NO_PIECE;
+  }
+  else {
+    board_set_piece(&l.falling, kind, rotation, relative);
+    COND_ERET(board_collides(&l, &l.falling), -1,
+      "Falling piece out of place in saved board.");
+  }
+  set_next_piece(&l, next_kind);
+
+  l.rng = get_u32(in);
+  l.points = get_u32(in + 4);
+  l.lines = get_u32(in + 8);
+  l.pieces = get_u32(in + 12);
+  COND_ERET(!l.rng || l.points < 0 || l.lines < 0 || l.pieces < 0, -1,
+    "Bad score in saved board.");
+  *b = l;
+  return 0;
+}
+
+void
+board_upcoming(const struct Board *b, Sint8 *kinds, int n) {
+  // Only the generator gets used.
+  struct Board ahead;
+  ahead.rng = b->rng;
+  int i = 0;
+  if (board_is_falling(b) && i < n) {
+    kinds[i++] = b->falling.kind;
+  }
+  if (i < n) {
+    kinds[i++] = b->next.kind;
+  }
+  while (i < n) {
+    kinds[i++] = next_random(&ahead) % NUM_DIFFERENT_PIECES;
+  }
+}
+
+void
+board_set_rows(struct Board *b, const Uint16 rows[PANEL_ROWS], Uint8 cell) {
+  b->hash = 0;
+  for (int y = 0; y < PANEL_ROWS; y++) {
+    b->rows[y] = rows[y] & FULL_ROW;
+    b->hash ^= row_key(y, b->rows[y]);
+    for (int x = 0; x < PANEL_COLS; x++) {
+      b->cells[y][x] = b->rows[y] >> x & 1 ? cell : 0;
+    }
+  }
+}
+
+int
+board_stack_height(const struct Board *b) {
+  int h = PANEL_ROWS;
+  while (h > 0 && !b->rows[h-1]) {
+    h--;
+  }
+  return h;
+}
+
+void
+board_piece_cells(const struct BoardPiece *p, Uint8 cells[NUM_PIECE_PARTS]) {
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    cells[i] = (p->relative.y + p->blocks[i].y)*PANEL_COLS
+      + p->relative.x + p->blocks[i].x;
+  }
+}
@@ -0,0 +1,223 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <SDL2/SDL.h>
+
+#include "2D.h"
+
+/*
+ * The rules of the game, apart from anything that has to do with timing,
+ * input or drawing. Everything in here works on a struct Board the caller
+ * owns, so any number of games can be simulated at once (the game screen
+ * has one, the vectorized environment has many).
+ */
+
+enum {
+  PANEL_ROWS = 20,
+  PANEL_COLS = 10,
+
+  // In tetris, a piece always is made out of 4 blocks.
+  NUM_PIECE_PARTS = 4,
+
+  // There are 7 different kinds of tetris pieces.
+  NUM_DIFFERENT_PIECES = 7,
+
+  // Kind of a piece slot that holds nothing.
+  NO_PIECE = -1,
+
+  // The kinds the rotation rules treat specially.
+  PIECE_I = 0,
+  PIECE_O = 1,
+
+  FULL_ROW = (1 << PANEL_COLS) - 1,
+
+  // Leftmost column a piece's box can be at (pieces don't always fill their
+  // box's left columns). See board_place.
+  PLACE_MIN_X = -2,
+
+  // The level goes up every LINES_PER_LEVEL cleared lines, up to MAX_LEVEL.
+  LINES_PER_LEVEL = 10,
+  MAX_LEVEL = 15,
+
+  // Gravity is in rows per tick, fixed point: GRAVITY_ONE is 1 row per tick
+  // (1G). Past MAX_GRAVITY (20G) a piece already reaches the floor on the
+  // tick it shows up.
+  GRAVITY_ONE = 1 << 16,
+  MAX_GRAVITY = 20*GRAVITY_ONE,
+
+  // Bytes board_save writes: the cells (2 per byte), the falling piece's
+  // kind, rotation and position, the next piece's kind, then the generator
+  // and the score (u32 each).
+  BOARD_SAVE_SIZE = PANEL_ROWS*PANEL_COLS/2 + 5 + 4*4
+};
+
+typedef struct Point2D GridPoint2D;
+typedef struct Dim2D GridDim2D;
+
+struct BoardPiece {
+  GridPoint2D blocks[NUM_PIECE_PARTS];
+  GridPoint2D relative; // 0,0 means bottom-left
+  int kind; // piece number or NO_PIECE
+  int rotation; // 0 (as spawned) to 3, clockwise
+};
+
+struct Board {
+  /**
+   * 0 is an empty cell, otherwise it's the kind + 1 of the piece that left
+   * the block there.
+   *
+   * Row 0 is the row on the bottom. Column 0 is the column on the left. Rows
+   * grow from bottom->up and columns from left->right.
+   */
+  Uint8 cells[PANEL_ROWS][PANEL_COLS];
+
+  // Same as cells, one bit per column (bit j is column j): 1 means filled.
+  Uint16 rows[PANEL_ROWS];
+
+  /**
+   * Zobrist hash of which cells are filled (not of what filled them): the
+   * xor of a fixed random key per filled cell. It's kept up to date as
+   * pieces get fixed and rows removed, so boards with the same stack have
+   * the same hash no matter how they got there.
+   */
+  Uint64 hash;
+
+  struct BoardPiece falling, next;
+  Uint32 rng;
+  int points;
+  int lines;
+  int pieces;
+};
+
+/**
+ * What happened when a piece became part of the board.
+ */
+struct LockResult {
+  int lines;
+  // Removed rows, as they were numbered before any got removed.
+  Uint32 removed_rows;
+  int points;
+};
+
+/**
+ * Empties the board, zeroes the score and picks the first next piece. No
+ * piece will be falling until board_spawn is called.
+ */
+void
+board_reset(struct Board *b, Uint32 seed);
+
+/**
+ * Makes the next piece fall and picks a new next one. Returns 0, or -1 if the
+ * new piece doesn't fit, which means the game is over.
+ */
+int
+board_spawn(struct Board *b);
+
+int
+board_is_falling(const struct Board *b);
+
+/**
+ * Sets *p up as a piece of the given kind and rotation with its box's
+ * bottom-left at relative. Meant for trying placements out (the AI does).
+ */
+void
+board_set_piece(struct BoardPiece *p, int kind, int rotation,
+                GridPoint2D relative);
+
+int
+board_collides(const struct Board *b, const struct BoardPiece *p);
+
+/**
+ * Tries to move the falling piece. Returns 1 if it moved and 0 if it was in
+ * the way of something (in which case it stays where it was).
+ */
+int
+board_move(struct Board *b, int dx, int dy);
+
+/**
+ * How many rows the falling piece could go down before it hits something.
+ */
+int
+board_drop_distance(const struct Board *b);
+
+/**
+ * Moves the falling piece down max_rows rows, or less if it lands before
+ * that. Returns how many rows it went down.
+ */
+int
+board_drop(struct Board *b, int max_rows);
+
+int
+board_level(const struct Board *b);
+
+/**
+ * Rows per tick (in GRAVITY_ONE units) pieces fall at on the given level.
+ */
+Uint32
+board_gravity(int level);
+
+/**
+ * Same as board_move, but for a pi/2 rad rotation: clockwise if dir is 1,
+ * counter clockwise if it's -1. If the piece doesn't fit turned where it
+ * is, it's tried a few cells around it (SRS wall kicks) before giving up.
+ */
+int
+board_rotate(struct Board *b, int dir);
+
+/**
+ * Turns the falling piece into blocks of the board, then removes complete
+ * rows and scores them.
+ */
+void
+board_fixate(struct Board *b, struct LockResult *result);
+
+/**
+ * Drops a piece of the given kind and rotation straight down from the top,
+ * with its box's left at column x (PLACE_MIN_X to PANEL_COLS - 1), and fixes
+ * it, all on a copy of *b. Returns how many lines that cleared, or -1 if the
+ * piece doesn't fit there or ends up sticking out of the top.
+ */
+int
+board_place(const struct Board *b, int kind, int rotation, int x,
+            struct Board *out);
+
+/**
+ * Writes everything about *b, BOARD_SAVE_SIZE bytes, to out.
+ */
+void
+board_save(const struct Board *b, Uint8 *out);
+
+/**
+ * Sets *b up as it was when board_save wrote in. Returns -1 if in doesn't
+ * make sense as a board (and then *b is left as it was).
+ */
+int
+board_load(struct Board *b, const Uint8 *in);
+
+/**
+ * Kinds of the falling piece (if any), the next one and the ones after them,
+ * n in all, as they'll come.
+ */
+void
+board_upcoming(const struct Board *b, Sint8 *kinds, int n);
+
+/**
+ * Fills the board's cells from row bitmasks (as in Board.rows), with cell in
+ * each filled one. For loading positions that weren't played up to.
+ */
+void
+board_set_rows(struct Board *b, const Uint16 rows[PANEL_ROWS], Uint8 cell);
+
+/**
+ * How many rows from the bottom up to the highest block on the board.
+ */
+int
+board_stack_height(const struct Board *b);
+
+/**
+ * Cell indexes (y*PANEL_COLS + x) of a piece's blocks.
+ */
+void
+board_piece_cells(const struct BoardPiece *p, Uint8 cells[NUM_PIECE_PARTS]);
+
+#endif
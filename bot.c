@@ -0,0 +1,272 @@
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "board.h"
+#include "ttable.h"
+#include "bot.h"
+
+enum {
+  // Box positions tried in each rotation: PLACE_MIN_X to PANEL_COLS - 1.
+  NUM_XS = PANEL_COLS - PLACE_MIN_X,
+  NUM_PLACEMENTS = 4*NUM_XS
+};
+
+// Value of a placement that loses the game.
+static const double LOST = -1e9;
+
+// Weight of a cleared line. Lines count the same wherever they happen along
+// the way, so they're kept out of the values the table stores.
+static const double LINE_WEIGHT = 0.760666;
+
+struct Candidate {
+  // The board once the falling piece landed there, and where it landed.
+  struct Board after;
+  struct BoardPiece piece;
+  int lines;
+  // Best value found so far at the depth being searched.
+  double value;
+};
+
+static Uint32 budget_us = BOT_DEFAULT_BUDGET_US;
+static int max_depth = BOT_DEFAULT_DEPTH;
+
+static int next_kind;
+static struct Candidate candidates[NUM_PLACEMENTS];
+static int num_candidates;
+
+// Where the search is: depth being searched, candidate and placement of the
+// next piece on it to try next.
+static int depth;
+static int at_candidate, at_placement;
+
+static struct BotMove best;
+
+// Values of search() by board hash and depth. Null to search without it.
+static struct TTable *ttable;
+static int use_ttable = 1;
+static struct BotStats stats;
+
+int
+init_bot(void) {
+  ttable = tt_create(BOT_TTABLE_BYTES);
+  COND_ERET_IF0(ttable, -1, 0);
+  return 0;
+}
+
+void
+destroy_bot(void) {
+  tt_destroy(ttable);
+  ttable = 0;
+}
+
+void
+bot_use_ttable(int on) {
+  use_ttable = on;
+  if (ttable) {
+    tt_clear(ttable);
+  }
+}
+
+const struct BotStats*
+get_bot_stats(void) {
+  return &stats;
+}
+
+void
+bot_configure(Uint32 budget_us_, int depth_) {
+  budget_us = budget_us_;
+  max_depth = SDL_max(1, SDL_min(BOT_MAX_DEPTH, depth_));
+}
+
+Uint32
+bot_budget_us(void) {
+  return budget_us;
+}
+
+/**
+ * board_place with placement number j. Returns -1 as well for the turned O
+ * pieces, which are all the same as the one that isn't.
+ */
+static int
+place(const struct Board *b, int kind, int j, struct Board *out) {
+  int rotation = j/NUM_XS;
+  if (kind == PIECE_O && rotation) {
+    return -1;
+  }
+  return board_place(b, kind, rotation, j % NUM_XS + PLACE_MIN_X, out);
+}
+
+static int
+count_bits(unsigned x) {
+  int n = 0;
+  for (; x; x &= x - 1) {
+    n++;
+  }
+  return n;
+}
+
+/**
+ * How good a board looks: low, flat, no holes (and lines cleared on the way
+ * there, see LINE_WEIGHT). The weights are the ones from Yiyuan Lee's well
+ * known tetris AI.
+ */
+static double
+evaluate(const struct Board *b) {
+  int heights[PANEL_COLS] = {0};
+  int holes = 0;
+  unsigned above = 0;
+
+  for (int y = PANEL_ROWS - 1; y >= 0; y--) {
+    unsigned row = b->rows[y];
+    unsigned first = row & ~above;
+    for (int x = 0; first; x++, first >>= 1) {
+      if (first & 1) {
+        heights[x] = y + 1;
+      }
+    }
+    holes += count_bits(~row & above & FULL_ROW);
+    above |= row;
+  }
+
+  int total_height = 0, bumpiness = 0;
+  for (int x = 0; x < PANEL_COLS; x++) {
+    total_height += heights[x];
+    if (x > 0) {
+      bumpiness += SDL_abs(heights[x] - heights[x-1]);
+    }
+  }
+  return -0.510066*total_height - 0.35663*holes - 0.184483*bumpiness;
+}
+
+/**
+ * Value of *b with depth_left pieces still to come, which could be any of
+ * them: the average over kinds of the best placement of each.
+ */
+static double
+search(const struct Board *b, int depth_left) {
+  stats.searched++;
+  if (!depth_left) {
+    return evaluate(b);
+  }
+
+  // The same stack is often reached by placing pieces in another order.
+  Uint64 key = b->hash + (Uint64) depth_left*0x9E3779B97F4A7C15ull;
+  if (use_ttable && ttable) {
+    float cached;
+    stats.tt_probes++;
+    if (tt_probe(ttable, key, depth_left, &cached)) {
+      stats.tt_hits++;
+      return cached;
+    }
+  }
+
+  double total = 0;
+  for (int kind = 0; kind < NUM_DIFFERENT_PIECES; kind++) {
+    double kind_best = LOST;
+    for (int j = 0; j < NUM_PLACEMENTS; j++) {
+      struct Board after;
+      int cleared = place(b, kind, j, &after);
+      if (cleared >= 0) {
+        // Not in SDL_max: it's a macro and would search twice.
+        double value = cleared*LINE_WEIGHT + search(&after, depth_left - 1);
+        kind_best = SDL_max(kind_best, value);
+      }
+    }
+    total += kind_best;
+  }
+  total /= NUM_DIFFERENT_PIECES;
+
+  if (use_ttable && ttable) {
+    tt_store(ttable, key, depth_left, (float) total);
+  }
+  return total;
+}
+
+/**
+ * Takes the best candidate as the answer for the depth just searched and
+ * moves on to the next depth.
+ */
+static void
+finish_depth(void) {
+  const struct Candidate *top = 0;
+  for (int i = 0; i < num_candidates; i++) {
+    if (!top || candidates[i].value > top->value) {
+      top = candidates + i;
+    }
+  }
+  if (top) {
+    best.piece = top->piece;
+    best.depth = depth;
+  }
+  depth++;
+  at_candidate = 0;
+  at_placement = 0;
+}
+
+void
+bot_start(const struct Board *b) {
+  SDL_assert(board_is_falling(b));
+  next_kind = b->next.kind;
+  num_candidates = 0;
+  best.depth = 0;
+  if (ttable) {
+    tt_new_search(ttable);
+  }
+
+  // Depth 1 is cheap enough to search right away.
+  depth = 1;
+  for (int j = 0; j < NUM_PLACEMENTS; j++) {
+    struct Candidate *c = candidates + num_candidates;
+    int cleared = place(b, b->falling.kind, j, &c->after);
+    if (cleared >= 0) {
+      // place fixed the piece, but it's still in falling.
+      c->piece = c->after.falling;
+      c->piece.kind = b->falling.kind;
+      c->lines = cleared;
+      c->value = cleared*LINE_WEIGHT + evaluate(&c->after);
+      num_candidates++;
+    }
+  }
+  finish_depth();
+}
+
+int
+bot_think(void) {
+  if (depth > max_depth || !num_candidates) {
+    return 0;
+  }
+
+  const Uint64 start = SDL_GetPerformanceCounter();
+  const Uint64 limit = (Uint64) budget_us*SDL_GetPerformanceFrequency()
+    / 1000000;
+  while (SDL_GetPerformanceCounter() - start < limit) {
+    struct Candidate *c = candidates + at_candidate;
+    if (at_placement == 0) {
+      c->value = LOST;
+    }
+
+    struct Board after;
+    int cleared = place(&c->after, next_kind, at_placement, &after);
+    if (cleared >= 0) {
+      double value = (c->lines + cleared)*LINE_WEIGHT
+        + search(&after, depth - 2);
+      c->value = SDL_max(c->value, value);
+    }
+
+    if (++at_placement == NUM_PLACEMENTS) {
+      at_placement = 0;
+      if (++at_candidate == num_candidates) {
+        finish_depth();
+        if (depth > max_depth) {
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+const struct BotMove*
+bot_best(void) {
+  return &best;
+}
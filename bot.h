@@ -0,0 +1,89 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+
+/*
+ * Anytime search for where the falling piece should go. bot_start takes a
+ * copy of the board; then each bot_think call searches for at most the time
+ * it's given and picks up where the last one stopped, so it can run a bit
+ * every frame on the main thread. The answer gets better with depth:
+ *
+ *   1: the falling piece alone,
+ *   2: the falling piece, then the next piece,
+ *   3 and more: then every possible piece after that, averaged.
+ *
+ * Placements are straight drops from the top in each rotation; moves that
+ * need sliding under overhangs are not considered.
+ */
+
+enum {
+  // Deeper than this, a single step of the search (one placement of the
+  // next piece) would take too long to fit in a frame.
+  BOT_MAX_DEPTH = 3,
+  BOT_DEFAULT_DEPTH = 2,
+  BOT_DEFAULT_BUDGET_US = 1000,
+  BOT_TTABLE_BYTES = 4 << 20
+};
+
+struct BotStats {
+  // Positions looked at, and transposition table probes and hits.
+  Uint64 searched, tt_probes, tt_hits;
+};
+
+struct BotMove {
+  // Where the falling piece ends up (its position after dropping).
+  struct BoardPiece piece;
+  // Deepest search finished for this answer. 0 means there's no answer yet.
+  int depth;
+};
+
+/**
+ * Sets up the transposition table. Without it, the bot still works but
+ * searches the same positions over and over.
+ */
+int
+init_bot(void);
+
+void
+destroy_bot(void);
+
+/**
+ * Turns the transposition table on or off (it's on by default), emptying
+ * it. For measuring what it's worth.
+ */
+void
+bot_use_ttable(int on);
+
+const struct BotStats*
+get_bot_stats(void);
+
+/**
+ * How much to search. budget_us is the most bot_think should take per call
+ * and depth the depth to stop at.
+ */
+void
+bot_configure(Uint32 budget_us, int depth);
+
+Uint32
+bot_budget_us(void);
+
+/**
+ * Starts over on a new board. It must have a falling piece.
+ */
+void
+bot_start(const struct Board *b);
+
+/**
+ * Searches for bot_budget_us at most. Returns 1 if there's more left to
+ * search, 0 when the configured depth is done.
+ */
+int
+bot_think(void);
+
+const struct BotMove*
+bot_best(void);
+
+#endif
@@ -0,0 +1,13 @@
+#include "bytes.h"
+
+extern Uint8*
+put_u16(Uint8 *out, Uint16 v);
+
+extern Uint8*
+put_u32(Uint8 *out, Uint32 v);
+
+extern Uint16
+get_u16(const Uint8 *in);
+
+extern Uint32
+get_u32(const Uint8 *in);
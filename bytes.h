@@ -0,0 +1,43 @@
+#ifndef BYTES_H
+#define BYTES_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Little endian integers, as everything this program writes to files,
+ * sockets and shared memory stores them.
+ */
+
+/**
+ * Writes v to out and returns where the next value goes.
+ */
+inline Uint8*
+put_u16(Uint8 *out, Uint16 v) {
+  out[0] = v & 0xFF;
+  out[1] = v >> 8;
+  return out + 2;
+}
+
+inline Uint8*
+put_u32(Uint8 *out, Uint32 v) {
+  out[0] = v & 0xFF;
+  out[1] = (v >> 8) & 0xFF;
+  out[2] = (v >> 16) & 0xFF;
+  out[3] = v >> 24;
+  return out + 4;
+}
+
+inline Uint16
+get_u16(const Uint8 *in) {
+  return (Uint16) (in[0] | in[1] << 8);
+}
+
+inline Uint32
+get_u32(const Uint8 *in) {
+  return (Uint32) in[0]
+    | (Uint32) in[1] << 8
+    | (Uint32) in[2] << 16
+    | (Uint32) in[3] << 24;
+}
+
+#endif
@@ -0,0 +1,768 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "bytes.h"
+#include "error.h"
+#include "jobs.h"
+#include "percentile.h"
+#include "play.h"
+#include "replay.h"
+
+/*
+ * Analytics over a corpus of replays, on all cores.
+ *
+ * Usage: corpus build INDEX FILE...
+ *        corpus [-t THREADS] [-p MIN_POINTS] [-l MIN_LINES] [-s SEED]
+ *               INDEX REPORT...
+ *
+ * The first form scans replay files (replays.bin, or many of them
+ * concatenated) and writes INDEX: each game's seed, score, lines, pieces,
+ * duration and where it starts. Only the headers get read.
+ *
+ * The second one runs REPORTs over the games of INDEX that pass the filters:
+ *
+ *   list       a line per game
+ *   points     score distribution
+ *   survival   how many games are still going after so long
+ *   clears     how often locking a piece clears 0 to 4 lines
+ *   columns    landing column heatmap, by kind of piece
+ *
+ * The first three only need the index. The others re-simulate every game
+ * from its inputs, through play.c and the same tick loop as game_replay_step,
+ * and count the ones that don't end up with the score they were recorded
+ * with as out of sync.
+ *
+ * The index and the replay files are memory mapped, and the games are split
+ * into jobs over a pool of threads, each with tallies of its own that get
+ * added up at the end. Nothing is read into memory other than the pages
+ * being looked at, which the kernel is free to drop as soon as the job
+ * reading them moves past them.
+ */
+
+enum {
+  INDEX_VERSION = 1,
+  // "TIDX", version, number of files and number of games (u32 each).
+  INDEX_HEADER_SIZE = 4 + 3*4,
+  // File number, offset (u64), seed, ticks, points, lines, pieces.
+  INDEX_GAME_SIZE = 8*4,
+
+  // More jobs than threads, since games take very different times to
+  // simulate.
+  JOBS_PER_THREAD = 16,
+
+  SURVIVAL_STEP_S = 10,
+  // An hour. Longer games all go in the last bucket.
+  SURVIVAL_BUCKETS = 360,
+  MAX_SURVIVAL_ROWS = 20,
+
+  POINTS_BUCKETS = 10,
+  BAR_WIDTH = 50
+};
+
+enum Report {
+  REPORT_LIST = 1 << 0,
+  REPORT_POINTS = 1 << 1,
+  REPORT_SURVIVAL = 1 << 2,
+  REPORT_CLEARS = 1 << 3,
+  REPORT_COLUMNS = 1 << 4,
+
+  // The ones that need the games simulated.
+  REPORTS_SIMULATED = REPORT_CLEARS | REPORT_COLUMNS
+};
+
+static const char *const REPORT_NAMES[] = {
+  "list", "points", "survival", "clears", "columns"
+};
+
+static const char PIECE_LETTERS[NUM_DIFFERENT_PIECES + 1] = "IOSZLJT";
+
+struct Mapping {
+  const Uint8 *data;
+  size_t size;
+};
+
+struct Game {
+  Uint32 file;
+  Uint64 offset;
+  Uint32 seed, ticks, points, lines, pieces;
+};
+
+struct Corpus {
+  struct Mapping index;
+  int num_files;
+  char **paths;
+  // Only mapped when games get simulated.
+  struct Mapping *files;
+  const Uint8 *games;
+  Uint32 num_games;
+};
+
+struct Filter {
+  Uint32 min_points, min_lines;
+  int by_seed;
+  Uint32 seed;
+};
+
+/**
+ * What a job counted over its share of the games.
+ */
+struct Tally {
+  Uint32 matched;
+  // Games whose bytes aren't where the index says, and games that simulated
+  // to another score.
+  Uint32 missing, desynced;
+  Uint64 clears[5];
+  Uint64 columns[NUM_DIFFERENT_PIECES][PANEL_COLS];
+  // Games that ended in each SURVIVAL_STEP_S s bucket.
+  Uint32 ended[SURVIVAL_BUCKETS];
+};
+
+struct Scan {
+  const struct Corpus *corpus;
+  const struct Filter *filter;
+  int simulate;
+  int num_jobs;
+  struct Tally *tallies;
+  // The points of each matching game, at the start of its job's share.
+  Uint32 *points;
+};
+
+static void
+usage(const char *prog) {
+  fprintf(stderr, "Usage: %s build INDEX FILE...\n"
+    "       %s [-t THREADS] [-p MIN_POINTS] [-l MIN_LINES] [-s SEED] "
+    "INDEX REPORT...\n"
+    "REPORTs: list, points, survival, clears, columns\n", prog, prog);
+}
+
+static double
+ms_since(Uint64 start) {
+  return (SDL_GetPerformanceCounter() - start)*1000.0
+    / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Maps the whole file at path, read only. An empty file maps to nothing.
+ */
+static int
+map_file(const char *path, struct Mapping *m) {
+  m->data = 0;
+  m->size = 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+  m->size = st.st_size;
+  if (m->size > 0) {
+    void *p = mmap(0, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      perror(path);
+      close(fd);
+      m->size = 0;
+      return -1;
+    }
+    m->data = p;
+    // Each job reads its share front to back, once.
+    posix_madvise(p, m->size, POSIX_MADV_SEQUENTIAL);
+  }
+  close(fd);
+  return 0;
+}
+
+static void
+unmap_file(struct Mapping *m) {
+  if (m->data) {
+    munmap((void*) m->data, m->size);
+  }
+  m->data = 0;
+  m->size = 0;
+}
+
+/**
+ * Writes an index entry for each game in the replay file at path. Stops at
+ * the first thing that isn't one (a game cut short by a crash, say), keeping
+ * the ones before it. Returns -1 if path can't be read, -2 if out can't be
+ * written.
+ */
+static int
+index_file(FILE *out, const char *path, Uint32 file, Uint32 *num_games) {
+  struct Mapping m;
+  if (map_file(path, &m) < 0) {
+    return -1;
+  }
+  size_t offset = 0;
+  while (offset < m.size) {
+    size_t left = m.size - offset;
+    struct ReplayHeader h;
+    if (replay_parse_header(m.data + offset,
+          (int) SDL_min(left, (size_t) REPLAY_HEADER_SIZE), &h) < 0
+        || h.inputs_size > left - REPLAY_HEADER_SIZE)
+    {
+      fprintf(stderr, "%s: no game at byte %lu, skipping the %lu bytes "
+        "left\n", path, (unsigned long) offset, (unsigned long) left);
+      free_error(0);
+      break;
+    }
+    Uint8 entry[INDEX_GAME_SIZE];
+    Uint8 *p = put_u32(entry, file);
+    p = put_u32(p, (Uint32) offset);
+    p = put_u32(p, (Uint32) ((Uint64) offset >> 32));
+    p = put_u32(p, h.seed);
+    p = put_u32(p, h.ticks);
+    p = put_u32(p, h.points);
+    p = put_u32(p, h.lines);
+    put_u32(p, h.pieces);
+    if (fwrite(entry, sizeof entry, 1, out) != 1) {
+      unmap_file(&m);
+      return -2;
+    }
+    (*num_games)++;
+    offset += REPLAY_HEADER_SIZE + h.inputs_size;
+  }
+  unmap_file(&m);
+  return 0;
+}
+
+static int
+build(const char *index_path, char *files[], int num_files) {
+  Uint64 start = SDL_GetPerformanceCounter();
+  FILE *out = fopen(index_path, "wb");
+  if (!out) {
+    perror(index_path);
+    return -1;
+  }
+  Uint8 header[INDEX_HEADER_SIZE] = {'T', 'I', 'D', 'X'};
+  Uint8 *p = put_u32(header + 4, INDEX_VERSION);
+  p = put_u32(p, num_files);
+  // The number of games goes in once they're counted.
+  put_u32(p, 0);
+  int ok = fwrite(header, sizeof header, 1, out) == 1;
+  for (int i = 0; ok && i < num_files; i++) {
+    Uint32 len = strlen(files[i]);
+    Uint8 len_bytes[4];
+    put_u32(len_bytes, len);
+    ok = fwrite(len_bytes, sizeof len_bytes, 1, out) == 1
+      && fwrite(files[i], len, 1, out) == 1;
+  }
+
+  Uint32 num_games = 0;
+  int got = 0;
+  for (int i = 0; ok && got == 0 && i < num_files; i++) {
+    got = index_file(out, files[i], i, &num_games);
+    ok = got != -2;
+  }
+  if (ok && got == 0) {
+    put_u32(header + 12, num_games);
+    ok = fseek(out, 12, SEEK_SET) == 0
+      && fwrite(header + 12, 4, 1, out) == 1;
+  }
+  if (fclose(out) != 0 || !ok) {
+    perror(index_path);
+    return -1;
+  }
+  if (got < 0) {
+    // Already told why; an index without all the files would mislead.
+    remove(index_path);
+    return -1;
+  }
+  printf("%u games from %d files indexed in %.1f ms\n", num_games, num_files,
+    ms_since(start));
+  return 0;
+}
+
+static void
+close_corpus(struct Corpus *c) {
+  for (int i = 0; i < c->num_files; i++) {
+    if (c->paths) {
+      SDL_free(c->paths[i]);
+    }
+    if (c->files) {
+      unmap_file(c->files + i);
+    }
+  }
+  SDL_free(c->paths);
+  SDL_free(c->files);
+  unmap_file(&c->index);
+}
+
+static int
+open_corpus(const char *path, struct Corpus *c) {
+  SDL_zerop(c);
+  if (map_file(path, &c->index) < 0) {
+    return -1;
+  }
+  const Uint8 *p = c->index.data;
+  size_t left = c->index.size;
+  if (left < INDEX_HEADER_SIZE || memcmp(p, "TIDX", 4)
+      || get_u32(p + 4) != INDEX_VERSION)
+  {
+    goto e_bad;
+  }
+  Uint32 num_files = get_u32(p + 8);
+  c->num_games = get_u32(p + 12);
+  p += INDEX_HEADER_SIZE;
+  left -= INDEX_HEADER_SIZE;
+  if (num_files > left/4) {
+    goto e_bad;
+  }
+  c->paths = SDL_calloc(num_files, sizeof *c->paths);
+  c->files = SDL_calloc(num_files, sizeof *c->files);
+  if (!c->paths || !c->files) {
+    fputs("Out of memory.\n", stderr);
+    goto e_cleanup;
+  }
+  c->num_files = num_files;
+  for (Uint32 i = 0; i < num_files; i++) {
+    Uint32 len = left >= 4 ? get_u32(p) : 0;
+    if (left < 4 || len > left - 4) {
+      goto e_bad;
+    }
+    c->paths[i] = SDL_malloc(len + 1);
+    if (!c->paths[i]) {
+      fputs("Out of memory.\n", stderr);
+      goto e_cleanup;
+    }
+    memcpy(c->paths[i], p + 4, len);
+    c->paths[i][len] = '\0';
+    p += 4 + len;
+    left -= 4 + len;
+  }
+  if (left != (Uint64) c->num_games*INDEX_GAME_SIZE) {
+    goto e_bad;
+  }
+  c->games = p;
+  return 0;
+
+e_bad:
+  fprintf(stderr, "%s: not a corpus index\n", path);
+e_cleanup:
+  close_corpus(c);
+  return -1;
+}
+
+static int
+map_replays(struct Corpus *c) {
+  for (int i = 0; i < c->num_files; i++) {
+    if (map_file(c->paths[i], c->files + i) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void
+read_game(const struct Corpus *c, Uint32 i, struct Game *g) {
+  const Uint8 *p = c->games + (size_t) i*INDEX_GAME_SIZE;
+  g->file = get_u32(p);
+  g->offset = get_u32(p + 4) | (Uint64) get_u32(p + 8) << 32;
+  g->seed = get_u32(p + 12);
+  g->ticks = get_u32(p + 16);
+  g->points = get_u32(p + 20);
+  g->lines = get_u32(p + 24);
+  g->pieces = get_u32(p + 28);
+}
+
+static int
+matches(const struct Filter *f, const struct Game *g) {
+  return g->points >= f->min_points && g->lines >= f->min_lines
+    && (!f->by_seed || g->seed == f->seed);
+}
+
+static void
+count_lock(const struct PlayEvents *ev, struct Tally *t) {
+  if (!ev->locked) {
+    return;
+  }
+  Uint8 cells[NUM_PIECE_PARTS];
+  board_piece_cells(&ev->piece, cells);
+  int column = PANEL_COLS - 1;
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    column = SDL_min(column, cells[i] % PANEL_COLS);
+  }
+  t->columns[ev->piece.kind][column]++;
+  t->clears[ev->lock.lines]++;
+}
+
+/**
+ * Plays game g back from its inputs, a tick at a time as game_replay_step
+ * does, counting what happens on every lock.
+ */
+static void
+simulate(const struct Corpus *c, const struct Game *g, struct Tally *t) {
+  // The index may be older than the file, which may have been replaced.
+  if (g->file >= (Uint32) c->num_files) {
+    t->missing++;
+    return;
+  }
+  const struct Mapping *m = c->files + g->file;
+  if (g->offset > m->size || m->size - g->offset < REPLAY_HEADER_SIZE) {
+    t->missing++;
+    return;
+  }
+  const Uint8 *rec = m->data + g->offset;
+  Uint32 size = get_u32(rec + 5 + 6*4);
+  if (memcmp(rec, "TRPL", 4) || rec[4] != REPLAY_VERSION
+      || get_u32(rec + 5) != g->seed
+      || size > m->size - g->offset - REPLAY_HEADER_SIZE)
+  {
+    t->missing++;
+    return;
+  }
+  const Uint8 *inputs = rec + REPLAY_HEADER_SIZE;
+
+  struct Play p;
+  play_reset(&p, g->seed);
+  struct PlayEvents ev;
+  struct ReplayInput in = {0, 0};
+  Uint32 pos = 0;
+  int more = replay_next_input(inputs, size, &pos, &in);
+  while (!p.over && p.tick < g->ticks) {
+    for (; more > 0 && in.tick <= p.tick;
+         more = replay_next_input(inputs, size, &pos, &in))
+    {
+      play_input(&p, in.action, &ev);
+      count_lock(&ev, t);
+    }
+    play_tick(&p, &ev);
+    count_lock(&ev, t);
+  }
+  const struct Board *b = &p.board;
+  if (more < 0 || (Uint32) b->points != g->points
+      || (Uint32) b->lines != g->lines || (Uint32) b->pieces != g->pieces)
+  {
+    t->desynced++;
+  }
+}
+
+static void
+scan_job(void *ctx, int job_i) {
+  struct Scan *s = ctx;
+  const struct Corpus *c = s->corpus;
+  struct Tally *t = s->tallies + job_i;
+  Uint32 first = (Uint64) c->num_games*job_i/s->num_jobs;
+  Uint32 last = (Uint64) c->num_games*(job_i + 1)/s->num_jobs;
+  for (Uint32 i = first; i < last; i++) {
+    struct Game g;
+    read_game(c, i, &g);
+    if (!matches(s->filter, &g)) {
+      continue;
+    }
+    s->points[first + t->matched++] = g.points;
+    Uint32 bucket = g.ticks/TICKS_PER_SECOND/SURVIVAL_STEP_S;
+    t->ended[SDL_min(bucket, (Uint32) SURVIVAL_BUCKETS - 1)]++;
+    if (s->simulate) {
+      simulate(c, &g, t);
+    }
+  }
+}
+
+static void
+add_tally(struct Tally *sum, const struct Tally *t) {
+  sum->matched += t->matched;
+  sum->missing += t->missing;
+  sum->desynced += t->desynced;
+  for (int i = 0; i < 5; i++) {
+    sum->clears[i] += t->clears[i];
+  }
+  for (int k = 0; k < NUM_DIFFERENT_PIECES; k++) {
+    for (int x = 0; x < PANEL_COLS; x++) {
+      sum->columns[k][x] += t->columns[k][x];
+    }
+  }
+  for (int i = 0; i < SURVIVAL_BUCKETS; i++) {
+    sum->ended[i] += t->ended[i];
+  }
+}
+
+static void
+list_games(const struct Corpus *c, const struct Filter *f) {
+  Uint32 unknown = 0;
+  puts("file offset seed points lines pieces seconds");
+  for (Uint32 i = 0; i < c->num_games; i++) {
+    struct Game g;
+    read_game(c, i, &g);
+    if (!matches(f, &g)) {
+      continue;
+    }
+    // As in simulate: the index isn't trusted to only name its own files.
+    if (g.file >= (Uint32) c->num_files) {
+      unknown++;
+      continue;
+    }
+    printf("%s %llu %u %u %u %u %.1f\n", c->paths[g.file],
+      (unsigned long long) g.offset, g.seed, g.points, g.lines, g.pieces,
+      (double) g.ticks/TICKS_PER_SECOND);
+  }
+  if (unknown) {
+    fprintf(stderr, "%u games left out: the index names no file for them\n",
+      unknown);
+  }
+}
+
+static void
+print_bar(Uint64 count, Uint64 max) {
+  int len = max ? (int) (count*BAR_WIDTH/max) : 0;
+  for (int i = 0; i < len; i++) {
+    putchar('#');
+  }
+  putchar('\n');
+}
+
+/**
+ * points has the n matching games' points, sorted.
+ */
+static void
+report_points(const Uint32 *points, Uint32 n) {
+  Uint64 total = 0;
+  for (Uint32 i = 0; i < n; i++) {
+    total += points[i];
+  }
+  printf("\nPoints: mean %.1f, p10 %u, p50 %u, p90 %u, p99 %u, max %u\n",
+    (double) total/n, percentile(points, n, 10), percentile(points, n, 50),
+    percentile(points, n, 90), percentile(points, n, 99), points[n - 1]);
+
+  Uint32 width = points[n - 1]/POINTS_BUCKETS + 1;
+  Uint32 counts[POINTS_BUCKETS] = {0}, max = 0;
+  for (Uint32 i = 0; i < n; i++) {
+    counts[points[i]/width]++;
+  }
+  for (int i = 0; i < POINTS_BUCKETS; i++) {
+    max = SDL_max(max, counts[i]);
+  }
+  for (int i = 0; i < POINTS_BUCKETS; i++) {
+    printf("%9u+ %8u ", i*width, counts[i]);
+    print_bar(counts[i], max);
+  }
+}
+
+static void
+report_survival(const struct Tally *t) {
+  int last = SURVIVAL_BUCKETS - 1;
+  while (last > 0 && !t->ended[last]) {
+    last--;
+  }
+  int step = last/MAX_SURVIVAL_ROWS + 1;
+  printf("\nSurvival (games still going after):\n");
+  Uint32 alive = t->matched;
+  for (int i = 0; i <= last; i++) {
+    if (i % step == 0) {
+      printf("%7ds %8u %5.1f%% ", i*SURVIVAL_STEP_S, alive,
+        100.0*alive/t->matched);
+      print_bar(alive, t->matched);
+    }
+    alive -= t->ended[i];
+  }
+  if (alive) {
+    printf("%u games went on for longer than %d s\n", alive,
+      SURVIVAL_BUCKETS*SURVIVAL_STEP_S);
+  }
+}
+
+static void
+report_simulated(const struct Tally *t) {
+  printf("\n%u games simulated", t->matched - t->missing);
+  if (t->missing) {
+    printf(", %u not found where the index says", t->missing);
+  }
+  printf(", %u out of sync\n", t->desynced);
+}
+
+static void
+report_clears(const struct Tally *t) {
+  static const char *const NAMES[] = {
+    "none", "single", "double", "triple", "tetris"
+  };
+  Uint64 locks = 0, lines = 0;
+  for (int i = 0; i < 5; i++) {
+    locks += t->clears[i];
+    lines += i*t->clears[i];
+  }
+  Uint32 games = t->matched - t->missing;
+  printf("\nLine clears: %llu pieces locked, %.2f lines per game\n",
+    (unsigned long long) locks, games ? (double) lines/games : 0.0);
+  for (int i = 0; i < 5; i++) {
+    printf("%8s %10llu %6.2f%% ", NAMES[i],
+      (unsigned long long) t->clears[i],
+      locks ? 100.0*t->clears[i]/locks : 0.0);
+    print_bar(t->clears[i], locks);
+  }
+}
+
+static void
+report_columns(const struct Tally *t) {
+  printf("\nLanding columns (%% of each kind's pieces, by leftmost "
+    "block):\n    ");
+  for (int x = 0; x < PANEL_COLS; x++) {
+    printf("%6d", x);
+  }
+  putchar('\n');
+  Uint64 all[PANEL_COLS] = {0}, total = 0;
+  for (int k = 0; k < NUM_DIFFERENT_PIECES; k++) {
+    Uint64 pieces = 0;
+    for (int x = 0; x < PANEL_COLS; x++) {
+      pieces += t->columns[k][x];
+      all[x] += t->columns[k][x];
+    }
+    total += pieces;
+    printf("   %c", PIECE_LETTERS[k]);
+    for (int x = 0; x < PANEL_COLS; x++) {
+      printf("%6.1f", pieces ? 100.0*t->columns[k][x]/pieces : 0.0);
+    }
+    putchar('\n');
+  }
+  printf(" all");
+  for (int x = 0; x < PANEL_COLS; x++) {
+    printf("%6.1f", total ? 100.0*all[x]/total : 0.0);
+  }
+  putchar('\n');
+}
+
+static int
+run_reports(const struct Corpus *c, const struct Filter *f, int reports,
+            int threads)
+{
+  if (reports & REPORT_LIST) {
+    list_games(c, f);
+  }
+  if (!(reports & ~REPORT_LIST)) {
+    return 0;
+  }
+
+  Uint64 start = SDL_GetPerformanceCounter();
+  struct JobPool *pool = create_job_pool(threads);
+  struct Scan s = {c, f, (reports & REPORTS_SIMULATED) != 0, 0, 0, 0};
+  if (pool) {
+    s.num_jobs = job_pool_threads(pool)*JOBS_PER_THREAD;
+    s.tallies = SDL_calloc(s.num_jobs, sizeof *s.tallies);
+    s.points = SDL_malloc(SDL_max(c->num_games, 1u)*sizeof *s.points);
+  }
+  int ret = -1;
+  if (!pool || !s.tallies || !s.points) {
+    fputs("Out of memory.\n", stderr);
+    goto cleanup;
+  }
+  run_jobs(pool, scan_job, &s, s.num_jobs);
+
+  struct Tally sum = {0};
+  for (int i = 0; i < s.num_jobs; i++) {
+    // Each job's points are at the start of its share; pack them together.
+    memmove(s.points + sum.matched,
+      s.points + (Uint64) c->num_games*i/s.num_jobs,
+      s.tallies[i].matched*sizeof *s.points);
+    add_tally(&sum, s.tallies + i);
+  }
+  double ms = ms_since(start);
+  if (!sum.matched) {
+    puts("No games match.");
+    ret = 0;
+    goto cleanup;
+  }
+  sort_u32(s.points, sum.matched);
+
+  printf("%u of %u games\n", sum.matched, c->num_games);
+  if (reports & REPORT_POINTS) {
+    report_points(s.points, sum.matched);
+  }
+  if (reports & REPORT_SURVIVAL) {
+    report_survival(&sum);
+  }
+  if (reports & REPORTS_SIMULATED) {
+    report_simulated(&sum);
+  }
+  if (reports & REPORT_CLEARS) {
+    report_clears(&sum);
+  }
+  if (reports & REPORT_COLUMNS) {
+    report_columns(&sum);
+  }
+  printf("\nScanned in %.1f ms on %d threads\n", ms, job_pool_threads(pool));
+  ret = 0;
+
+cleanup:
+  SDL_free(s.points);
+  SDL_free(s.tallies);
+  destroy_job_pool(pool);
+  return ret;
+}
+
+int
+main(int argc, char *argv[]) {
+  if (argc >= 4 && !strcmp(argv[1], "build")) {
+    return build(argv[2], argv + 3, argc - 3) < 0 ? EXIT_FAILURE : 0;
+  }
+
+  int threads = 0;
+  struct Filter filter = {0, 0, 0, 0};
+  int i = 1;
+  for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+    if (!strcmp(argv[i], "-t")) {
+      threads = atoi(argv[i+1]);
+    }
+    else if (!strcmp(argv[i], "-p")) {
+      filter.min_points = strtoul(argv[i+1], 0, 10);
+    }
+    else if (!strcmp(argv[i], "-l")) {
+      filter.min_lines = strtoul(argv[i+1], 0, 10);
+    }
+    else if (!strcmp(argv[i], "-s")) {
+      filter.by_seed = 1;
+      filter.seed = strtoul(argv[i+1], 0, 10);
+    }
+    else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - i < 2) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *index_path = argv[i++];
+  int reports = 0;
+  for (; i < argc; i++) {
+    int r = 0;
+    while (r < (int) SDL_arraysize(REPORT_NAMES)
+           && strcmp(argv[i], REPORT_NAMES[r]))
+    {
+      r++;
+    }
+    if (r == (int) SDL_arraysize(REPORT_NAMES)) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    reports |= 1 << r;
+  }
+
+  struct Corpus corpus;
+  if (open_corpus(index_path, &corpus) < 0) {
+    return EXIT_FAILURE;
+  }
+  int ret = EXIT_FAILURE;
+  if ((reports & REPORTS_SIMULATED) && map_replays(&corpus) < 0) {
+    goto cleanup;
+  }
+  if (run_reports(&corpus, &filter, reports, threads) == 0) {
+    ret = 0;
+  }
+
+cleanup:
+  close_corpus(&corpus);
+  return ret;
+}
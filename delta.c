@@ -0,0 +1,242 @@
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "bytes.h"
+#include "delta.h"
+
+static int
+valid_cells(const Uint8 *cells) {
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    if (cells[i] >= DELTA_CELL_LIMIT) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int
+valid_kind(Uint8 kind) {
+  return kind <= DELTA_MAX_KIND;
+}
+
+void
+delta_reset(struct DeltaBoard *b) {
+  SDL_memset(b, 0, sizeof *b);
+}
+
+int
+delta_msg_len(const Uint8 *msg, int avail) {
+  if (avail < 1) {
+    return 0;
+  }
+  switch (msg[0]) {
+    case DELTA_KEYFRAME:
+      return DELTA_KEYFRAME_LEN;
+    case DELTA_NEW_GAME:
+    case DELTA_FALL:
+    case DELTA_FIXATE:
+      return 1;
+    case DELTA_MOVE:
+      return 2;
+    case DELTA_LINES:
+      return 4;
+    case DELTA_SHAPE:
+      return 1 + NUM_PIECE_PARTS;
+    case DELTA_SPAWN:
+      return 3 + NUM_PIECE_PARTS;
+    case DELTA_SCORE:
+      for (int i = 1; i < avail && i <= 5; i++) {
+        if (!(msg[i] & 0x80)) {
+          return i + 1;
+        }
+      }
+      return avail > 5 ? -1 : 0;
+  }
+  return -1;
+}
+
+static void
+remove_row(struct DeltaBoard *b, int row) {
+  for (int i = row+1; i < PANEL_ROWS; i++) {
+    SDL_memcpy(b->cells[i-1], b->cells[i], PANEL_COLS);
+  }
+  SDL_memset(b->cells[PANEL_ROWS-1], 0, PANEL_COLS);
+}
+
+int
+delta_apply(struct DeltaBoard *b, const Uint8 *msg, int len) {
+  if (len < 1 || delta_msg_len(msg, len) != len) {
+    return -1;
+  }
+
+  switch (msg[0]) {
+    case DELTA_KEYFRAME: {
+      const Uint8 *packed = msg + 11 + NUM_PIECE_PARTS;
+      if (!valid_kind(msg[9]) || !valid_kind(msg[10])
+          || !valid_cells(msg + 11))
+      {
+        return -1;
+      }
+      for (int i = 0; i < PANEL_ROWS*PANEL_COLS/2; i++) {
+        if (!valid_kind(packed[i] & 0x0F) || !valid_kind(packed[i] >> 4)) {
+          return -1;
+        }
+      }
+      b->pieces = get_u32(msg + 1);
+      b->points = get_u32(msg + 5);
+      b->piece_kind = msg[9];
+      b->next_kind = msg[10];
+      SDL_memcpy(b->piece, msg + 11, NUM_PIECE_PARTS);
+      Uint8 *cells = &b->cells[0][0];
+      for (int i = 0; i < PANEL_ROWS*PANEL_COLS; i++) {
+        cells[i] = (packed[i/2] >> (i%2 ? 4 : 0)) & 0x0F;
+      }
+      break;
+    }
+    case DELTA_NEW_GAME:
+      delta_reset(b);
+      break;
+    case DELTA_SPAWN:
+      if (!valid_kind(msg[1]) || !valid_kind(msg[2])
+          || !valid_cells(msg + 3))
+      {
+        return -1;
+      }
+      b->piece_kind = msg[1];
+      b->next_kind = msg[2];
+      SDL_memcpy(b->piece, msg + 3, NUM_PIECE_PARTS);
+      b->pieces++;
+      break;
+    case DELTA_FALL:
+    case DELTA_MOVE: {
+      int dx = 0;
+      int dy = -1;
+      if (msg[0] == DELTA_MOVE) {
+        dx = (msg[1] >> 4) - 8;
+        dy = (msg[1] & 0x0F) - 8;
+      }
+      for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+        int moved = b->piece[i] + dy*PANEL_COLS + dx;
+        if (moved < 0 || moved >= DELTA_CELL_LIMIT) {
+          return -1;
+        }
+        b->piece[i] = moved;
+      }
+      break;
+    }
+    case DELTA_SHAPE:
+      if (!valid_cells(msg + 1)) {
+        return -1;
+      }
+      SDL_memcpy(b->piece, msg + 1, NUM_PIECE_PARTS);
+      break;
+    case DELTA_FIXATE:
+      for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+        if (b->piece[i] < PANEL_ROWS*PANEL_COLS) {
+          b->cells[b->piece[i]/PANEL_COLS][b->piece[i]%PANEL_COLS] =
+            b->piece_kind;
+        }
+      }
+      b->piece_kind = 0;
+      break;
+    case DELTA_LINES: {
+      Uint32 mask = msg[1] | msg[2] << 8 | (Uint32) msg[3] << 16;
+      // Top-down, so that removing a row doesn't shift the ones still to be
+      // removed.
+      for (int row = PANEL_ROWS-1; row >= 0; row--) {
+        if (mask & (1u << row)) {
+          remove_row(b, row);
+        }
+      }
+      break;
+    }
+    case DELTA_SCORE: {
+      Uint32 points = 0;
+      for (int i = 1; i < len; i++) {
+        points |= (Uint32) (msg[i] & 0x7F) << (7*(i-1));
+      }
+      b->points = points;
+      break;
+    }
+  }
+  return 0;
+}
+
+int
+delta_put_keyframe(Uint8 *out, const struct DeltaBoard *b) {
+  out[0] = DELTA_KEYFRAME;
+  put_u32(out + 1, b->pieces);
+  put_u32(out + 5, b->points);
+  out[9] = b->piece_kind;
+  out[10] = b->next_kind;
+  SDL_memcpy(out + 11, b->piece, NUM_PIECE_PARTS);
+  Uint8 *packed = out + 11 + NUM_PIECE_PARTS;
+  const Uint8 *cells = &b->cells[0][0];
+  for (int i = 0; i < PANEL_ROWS*PANEL_COLS; i += 2) {
+    packed[i/2] = (cells[i] & 0x0F) | (cells[i+1] & 0x0F) << 4;
+  }
+  return DELTA_KEYFRAME_LEN;
+}
+
+int
+delta_put_spawn(Uint8 *out, int kind, int next_kind,
+                const Uint8 cells[NUM_PIECE_PARTS])
+{
+  out[0] = DELTA_SPAWN;
+  out[1] = kind;
+  out[2] = next_kind;
+  SDL_memcpy(out + 3, cells, NUM_PIECE_PARTS);
+  return 3 + NUM_PIECE_PARTS;
+}
+
+int
+delta_put_move(Uint8 *out, int dx, int dy) {
+  SDL_assert(dx >= DELTA_MOVE_MIN && dx <= DELTA_MOVE_MAX);
+  SDL_assert(dy >= DELTA_MOVE_MIN && dy <= DELTA_MOVE_MAX);
+  if (dx == 0 && dy == -1) {
+    out[0] = DELTA_FALL;
+    return 1;
+  }
+  out[0] = DELTA_MOVE;
+  out[1] = (dx + 8) << 4 | (dy + 8);
+  return 2;
+}
+
+int
+delta_put_shape(Uint8 *out, const Uint8 cells[NUM_PIECE_PARTS]) {
+  out[0] = DELTA_SHAPE;
+  SDL_memcpy(out + 1, cells, NUM_PIECE_PARTS);
+  return 1 + NUM_PIECE_PARTS;
+}
+
+int
+delta_put_lines(Uint8 *out, Uint32 row_mask) {
+  out[0] = DELTA_LINES;
+  out[1] = row_mask & 0xFF;
+  out[2] = (row_mask >> 8) & 0xFF;
+  out[3] = (row_mask >> 16) & 0xFF;
+  return 4;
+}
+
+int
+delta_put_score(Uint8 *out, Uint32 points) {
+  int len = 1;
+  out[0] = DELTA_SCORE;
+  do {
+    out[len] = points & 0x7F;
+    points >>= 7;
+    if (points) {
+      out[len] |= 0x80;
+    }
+    len++;
+  } while (points);
+  return len;
+}
+
+int
+delta_put_simple(Uint8 *out, enum DeltaMsgType type) {
+  SDL_assert(type == DELTA_NEW_GAME || type == DELTA_FIXATE
+    || type == DELTA_FALL);
+  out[0] = type;
+  return 1;
+}
@@ -0,0 +1,115 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+
+/*
+ * Wire format of the spectator feed (see spectate.h).
+ *
+ * The stream is a sequence of messages. The first byte of a message is its
+ * type, which also tells its length. Multi-byte integers are little endian.
+ *
+ *  'K' keyframe: pieces (4), points (4), piece kind (1), next kind (1),
+ *      piece cells (4), board cells (PANEL_ROWS*PANEL_COLS/2, two per byte,
+ *      low nibble first).
+ *  'N' new game: nothing follows.
+ *  'S' spawn: piece kind (1), next kind (1), piece cells (4).
+ *  'v' falling piece moved one row down: nothing follows.
+ *  'M' falling piece moved: (dx + 8) << 4 | (dy + 8) (1).
+ *  'R' falling piece rotated: piece cells (4).
+ *  'F' falling piece became part of the board: nothing follows.
+ *  'L' rows removed: bit mask of the rows, as they were before the removal
+ *      (3).
+ *  'P' points: unsigned LEB128 varint (1 to 5).
+ *
+ * Kinds are 0 for "nothing" and piece number + 1 otherwise, so never more
+ * than DELTA_MAX_KIND. Cells are addressed by y*PANEL_COLS + x, with row 0
+ * at the bottom. Messages with kinds or piece cells out of range are
+ * malformed.
+ */
+
+enum DeltaMsgType {
+  DELTA_KEYFRAME = 'K',
+  DELTA_NEW_GAME = 'N',
+  DELTA_SPAWN = 'S',
+  DELTA_FALL = 'v',
+  DELTA_MOVE = 'M',
+  DELTA_SHAPE = 'R',
+  DELTA_FIXATE = 'F',
+  DELTA_LINES = 'L',
+  DELTA_SCORE = 'P'
+};
+
+enum {
+  // Pieces may poke a few rows above the panel right after spawning.
+  DELTA_CELL_LIMIT = (PANEL_ROWS + 5)*PANEL_COLS,
+
+  DELTA_MAX_KIND = NUM_DIFFERENT_PIECES,
+
+  DELTA_KEYFRAME_LEN = 1 + 4 + 4 + 1 + 1 + NUM_PIECE_PARTS +
+    PANEL_ROWS*PANEL_COLS/2,
+  DELTA_MAX_MSG_LEN = DELTA_KEYFRAME_LEN,
+
+  // Largest offset a single 'M' message can carry in each direction.
+  DELTA_MOVE_MIN = -8,
+  DELTA_MOVE_MAX = 7
+};
+
+/**
+ * What a spectator knows about a game. It's all that's needed to draw it.
+ */
+struct DeltaBoard {
+  Uint8 cells[PANEL_ROWS][PANEL_COLS];
+  Uint8 piece[NUM_PIECE_PARTS];
+  Uint8 piece_kind, next_kind;
+  Uint32 points;
+  Uint32 pieces;
+};
+
+void
+delta_reset(struct DeltaBoard *b);
+
+/**
+ * Returns how long the message starting at msg is, 0 if more than avail
+ * bytes are needed to tell or negative if msg doesn't start a valid message.
+ */
+int
+delta_msg_len(const Uint8 *msg, int avail);
+
+/**
+ * Applies a complete message (as sized by delta_msg_len) to *b. Returns
+ * negative if the message is malformed.
+ */
+int
+delta_apply(struct DeltaBoard *b, const Uint8 *msg, int len);
+
+/*
+ * Encoders. Each one writes a message to out, which must have room for
+ * DELTA_MAX_MSG_LEN bytes, and returns its length.
+ */
+
+int
+delta_put_keyframe(Uint8 *out, const struct DeltaBoard *b);
+
+int
+delta_put_spawn(Uint8 *out, int kind, int next_kind,
+                const Uint8 cells[NUM_PIECE_PARTS]);
+
+int
+delta_put_move(Uint8 *out, int dx, int dy);
+
+int
+delta_put_shape(Uint8 *out, const Uint8 cells[NUM_PIECE_PARTS]);
+
+int
+delta_put_lines(Uint8 *out, Uint32 row_mask);
+
+int
+delta_put_score(Uint8 *out, Uint32 points);
+
+int
+delta_put_simple(Uint8 *out, enum DeltaMsgType type);
+
+#endif
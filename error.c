@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "error.h"
+#include "memtrack.h"
 
 /*
  * The "no dynamic allocation" constraint is off here, but this could surely
@@ -16,8 +17,8 @@ static int
 set_string(struct BasicString *string, const char *src) {
   if (src) {
     int src_len = strlen(src);
-    free(string->data);
-    string->data = malloc(src_len+1);
+    memtrack_free(string->data);
+    string->data = memtrack_malloc(MEM_ERRORS, src_len+1);
     if (!string->data) {
       string->len = -1;
       return -1;
@@ -40,7 +41,8 @@ link_error_to(struct ErrorInfo *old_head,
               const char *func_name,
               const char *code)
 {
-  struct ErrorInfo *new_head = malloc(sizeof (struct ErrorInfo));
+  struct ErrorInfo *new_head = memtrack_malloc(MEM_ERRORS,
+    sizeof (struct ErrorInfo));
   if (!new_head) {
     return 0;
   }
@@ -101,11 +103,11 @@ free_error(struct ErrorInfo *err) {
   }
   while (err) {
     struct ErrorInfo *aux = err->next;
-    free(err->msg.data);
-    free(err->file_name.data);
-    free(err->func_name.data);
-    free(err->code.data);
-    free(err);
+    memtrack_free(err->msg.data);
+    memtrack_free(err->file_name.data);
+    memtrack_free(err->func_name.data);
+    memtrack_free(err->code.data);
+    memtrack_free(err);
     err = aux;
   }
 }
@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "error.h"
+#include "export.h"
+
+enum {
+  NUM_SLOTS = 16,
+  MAX_WORKERS = 8,
+  PATH_LIMIT = 1024
+};
+
+struct Slot {
+  Uint8 *pixels;
+  int frame;
+  // Posted by the worker that took the slot once it's done with it. Workers
+  // finish out of order, so each slot needs its own.
+  SDL_sem *free;
+};
+
+static enum ExportFormat format;
+static const char *dest;
+static int width, height;
+static FILE *pipe_out;
+
+static struct Slot slots[NUM_SLOTS];
+static Uint8 *slot_memory;
+
+/*
+ * Slots cycle in order: the renderer fills them at head, once their own free
+ * semaphore says so, and workers take them at tail. full_slots counts what's
+ * waiting for the workers; tail is shared by them, hence the lock.
+ */
+static SDL_sem *full_slots;
+static SDL_mutex *tail_lock;
+static int head, tail;
+static int next_frame;
+
+static SDL_Thread *workers[MAX_WORKERS];
+static int num_workers;
+static SDL_atomic_t failed;
+
+static int
+write_frame(const struct Slot *s) {
+  char path[PATH_LIMIT];
+  const int size = width*height*4;
+
+  switch (format) {
+    case EXPORT_RAW: {
+      snprintf(path, sizeof path, "%s/%06d.rgba", dest, s->frame);
+      SDL_RWops *f = SDL_RWFromFile(path, "wb");
+      if (!f) {
+        return -1;
+      }
+      int ok = SDL_RWwrite(f, s->pixels, size, 1) == 1;
+      return SDL_RWclose(f) == 0 && ok ? 0 : -1;
+    }
+    case EXPORT_PNG: {
+      snprintf(path, sizeof path, "%s/%06d.png", dest, s->frame);
+      SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormatFrom(s->pixels,
+        width, height, 32, width*4, SDL_PIXELFORMAT_RGBA32);
+      if (!surf) {
+        return -1;
+      }
+      int err = IMG_SavePNG(surf, path);
+      SDL_FreeSurface(surf);
+      return err;
+    }
+    case EXPORT_PIPE:
+      return fwrite(s->pixels, size, 1, pipe_out) == 1 ? 0 : -1;
+  }
+  return -1;
+}
+
+static int
+worker(void *unused) {
+  (void) unused;
+  for (;;) {
+    SDL_SemWait(full_slots);
+    SDL_LockMutex(tail_lock);
+    struct Slot *s = slots + tail;
+    tail = (tail + 1) % NUM_SLOTS;
+    SDL_UnlockMutex(tail_lock);
+
+    if (s->frame < 0) {
+      // Sentinel from export_finish.
+      SDL_SemPost(s->free);
+      return 0;
+    }
+    if (!SDL_AtomicGet(&failed) && write_frame(s) < 0) {
+      SDL_AtomicSet(&failed, 1);
+    }
+    SDL_SemPost(s->free);
+  }
+}
+
+static void
+cleanup(void) {
+  if (pipe_out) {
+    pclose(pipe_out);
+    pipe_out = 0;
+  }
+  if (tail_lock) {
+    SDL_DestroyMutex(tail_lock);
+    tail_lock = 0;
+  }
+  if (full_slots) {
+    SDL_DestroySemaphore(full_slots);
+    full_slots = 0;
+  }
+  for (int i = 0; i < NUM_SLOTS; i++) {
+    if (slots[i].free) {
+      SDL_DestroySemaphore(slots[i].free);
+      slots[i].free = 0;
+    }
+  }
+  SDL_free(slot_memory);
+  slot_memory = 0;
+}
+
+int
+export_start(enum ExportFormat format_, const char *dest_, int w, int h) {
+  format = format_;
+  dest = dest_;
+  width = w;
+  height = h;
+  head = tail = next_frame = 0;
+  SDL_AtomicSet(&failed, 0);
+
+  slot_memory = SDL_malloc((size_t) NUM_SLOTS*w*h*4);
+  COND_EGOTO_IF0(slot_memory, e_cleanup, "Out of memory.");
+  for (int i = 0; i < NUM_SLOTS; i++) {
+    slots[i].pixels = slot_memory + (size_t) i*w*h*4;
+    slots[i].free = SDL_CreateSemaphore(1);
+    COND_EGOTO_IF0(slots[i].free, e_cleanup, SDL_GetError());
+  }
+
+  full_slots = SDL_CreateSemaphore(0);
+  COND_EGOTO_IF0(full_slots, e_cleanup, SDL_GetError());
+  tail_lock = SDL_CreateMutex();
+  COND_EGOTO_IF0(tail_lock, e_cleanup, SDL_GetError());
+
+  if (format == EXPORT_PIPE) {
+    pipe_out = popen(dest, "w");
+    COND_EGOTO_IF0(pipe_out, e_cleanup, "Couldn't start the encoder.");
+  }
+
+  // A pipe needs its frames in order, so it gets a single writer. Files can
+  // be compressed and written in parallel.
+  int wanted = format == EXPORT_PIPE ? 1 :
+    SDL_max(1, SDL_min(SDL_GetCPUCount() - 1, MAX_WORKERS));
+  for (num_workers = 0; num_workers < wanted; num_workers++) {
+    workers[num_workers] = SDL_CreateThread(worker, "export", 0);
+    COND_EGOTO_IF0(workers[num_workers], e_cleanup, SDL_GetError());
+  }
+  return 0;
+
+e_cleanup:
+  ERR_IGNORE(export_finish());
+  return -1;
+}
+
+Uint8*
+export_acquire_frame(void) {
+  SDL_SemWait(slots[head].free);
+  return slots[head].pixels;
+}
+
+void
+export_submit_frame(void) {
+  slots[head].frame = next_frame++;
+  head = (head + 1) % NUM_SLOTS;
+  SDL_SemPost(full_slots);
+}
+
+int
+export_finish(void) {
+  // One sentinel per worker. Each worker stops at the first one it takes,
+  // and everything submitted before them gets written first.
+  for (int i = 0; i < num_workers; i++) {
+    SDL_SemWait(slots[head].free);
+    slots[head].frame = -1;
+    head = (head + 1) % NUM_SLOTS;
+    SDL_SemPost(full_slots);
+  }
+  for (int i = 0; i < num_workers; i++) {
+    SDL_WaitThread(workers[i], 0);
+  }
+  num_workers = 0;
+  cleanup();
+  COND_ERET(SDL_AtomicGet(&failed), -1, "Couldn't write some frames.");
+  return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Writes rendered frames out without making the renderer wait for the disk.
+ * Frames go through a fixed ring of buffers: the renderer copies a frame in
+ * and moves on, worker threads compress and write it.
+ */
+
+enum ExportFormat {
+  // DEST/NNNNNN.rgba, raw RGBA bytes, row after row.
+  EXPORT_RAW,
+  // DEST/NNNNNN.png
+  EXPORT_PNG,
+  // Raw RGBA frames, in order, to the standard input of the command DEST.
+  EXPORT_PIPE
+};
+
+int
+export_start(enum ExportFormat format, const char *dest, int w, int h);
+
+/**
+ * Returns a w*h*4 bytes buffer to put the next frame in. Blocks only if
+ * every buffer is still waiting to be written.
+ */
+Uint8*
+export_acquire_frame(void);
+
+/**
+ * Hands the frame last acquired to the workers.
+ */
+void
+export_submit_frame(void);
+
+/**
+ * Waits for every submitted frame to be written. Returns negative if any of
+ * them failed.
+ */
+int
+export_finish(void);
+
+#endif
@@ -11,408 +11,888 @@
 #include "assets.h"
 #include "error.h"
 #include "scores.h"
+#include "board.h"
+#include "play.h"
+#include "spectate.h"
+#include "stats.h"
+#include "replay.h"
+#include "latency.h"
+#include "bot.h"
+#include "pcsolve.h"
+#include "snapshot.h"
+#include "sfx.h"
+#include "music.h"
+#include "livestate.h"
+#include "ring.h"
 
 #define WHITE_INIT_CODE {255, 255, 255, 255}
 #define BLACK_INIT_CODE {0,   0,   0,   255}
 
-#define COLOR0_INIT_CODE {255, 0,   0,   255}
-#define COLOR1_INIT_CODE {0,   255, 0,   255}
-#define COLOR2_INIT_CODE {0,   0,   255, 255}
-#define COLOR3_INIT_CODE {255, 255, 0,   255}
-#define COLOR4_INIT_CODE {255, 0,   255, 255}
-#define COLOR5_INIT_CODE {0,   255, 255, 255}
-#define COLOR6_INIT_CODE {0,   128, 255, 255}
-
 static const SDL_Color BLACK = BLACK_INIT_CODE;
 static const SDL_Color WHITE = WHITE_INIT_CODE;
 static const SDL_Color PANEL_BORDER_COLOR = WHITE_INIT_CODE;
 
-typedef struct Point2D GridPoint2D;
-typedef struct Dim2D GridDim2D;
-
 enum {
-  PANEL_ROWS = 20,
-  PANEL_COLS = 10,
   PADDING_PX = 30,
 
-  // In tetris, a piece always is made out of 4 blocks.
-  NUM_PIECE_PARTS = 4,
+  // If the simulation fell so far behind that more ticks than this are due
+  // at once, the game slows down instead of trying to catch up.
+  MAX_TICKS_PER_FRAME = 15,
+
+  // Commands the game loop can have waiting for the simulation thread. Must
+  // be a power of 2.
+  COMMAND_RING_SIZE = 64,
 
-  // Initial fall delay.
-  FALL_DELAY_MS = 300,
+  // A frame drawn more than this many ticks after the last one is a render
+  // stall: the screen missed at least a tick.
+  RENDER_STALL_TICKS = 2,
 
   // At most 1 key press each KEY_PRESS_DELAY.
   KEY_PRESS_DELAY = 150,
 
-  // There are 6 different kinds of tetris pieces.
-  NUM_DIFFERENT_PIECES = 7
-};
+  // Pieces the perfect clear assist looks at, the falling one included.
+  PC_ASSIST_PIECES = 10,
 
-struct FallingPiece {
-  GridPoint2D blocks[NUM_PIECE_PARTS];
-  GridPoint2D relative; // 0,0 means bottom-left
-  SDL_Color color;
+  // Bumped whenever what game_suspend writes changes.
+  SNAPSHOT_VERSION = 2,
+  // The game (see play_save), then the recording.
+  SNAPSHOT_SIZE = PLAY_SAVE_SIZE + MAX_RECORDING_SAVE_SIZE
 };
 
+static const char *const SNAPSHOT_FILE = "suspended.bin";
+
 struct Score {
-  // label_text is supposed to hold the "Score" text.
-  // points_text is supposed to hold a numeric string representing how many
-  // points the player has.
-  struct TextImage label_text, points_text;
-  int points;
+  // label_text is supposed to hold the "Pts" text. level_text holds "Level ",
+  // under the next piece.
+  struct TextImage label_text, level_text;
 };
 
+// "0" to "9" in the medium font (for the points) and the small one (for the
+// level). Numbers are drawn a digit at a time out of these, so they never
+// need rasterizing when they change (or when a game gets restored).
+static struct TextImage medium_digits[10], small_digits[10];
+
 struct Panel {
   PixelDim2D block_dim;
   SDL_Rect geom;
 
-  /**
-   * Empty blocks are black.
-   *
-   * Row 0 is the row on the bottom. Column 0 is the column on the left. Rows
-   * grow from bottom->up and columns from left->right.
-   */
-  SDL_Color blocks[PANEL_ROWS][PANEL_COLS];
-
-  struct FallingPiece falling_piece, next_piece;
+  // The game itself. The rest of this module is timing, input and drawing.
+  struct Play play;
 };
 
-static const SDL_Color colors[NUM_DIFFERENT_PIECES] = {
-  COLOR0_INIT_CODE, COLOR1_INIT_CODE, COLOR2_INIT_CODE, COLOR3_INIT_CODE,
-  COLOR4_INIT_CODE, COLOR5_INIT_CODE, COLOR6_INIT_CODE
+static struct Panel panel;
+static struct Score score;
+static struct TextImage pause_text;
+static SDL_Texture *block;
+static SDL_Renderer *g_rend;
+static PixelDim2D screen_dim;
 
-};
+/*
+ * While a live game goes on, the simulation (panel.play, the clock below,
+ * and the stats, replay and spectate notifications) runs on a thread of its
+ * own, so a slow frame can't hold up gravity or input. The game loop's
+ * thread forwards the player's commands to it through a ring and draws the
+ * views of the game it publishes. Replays run the simulation on the caller's
+ * thread instead, a game_replay_step at a time.
+ */
 
-struct PieceTemplate {
-  GridPoint2D fills[NUM_PIECE_PARTS];
-  GridDim2D size;
+// Tick schedule of the simulation thread: clock_ticks ticks ran since
+// clock_start (a performance counter value), and the next one is due
+// (clock_ticks + 1)/TICKS_PER_SECOND s after it.
+static Uint64 clock_start;
+static Uint32 clock_ticks;
+static int paused;
+// Pieces spawned so far, so the game loop can tell when a new one shows up.
+static Uint32 spawns;
+
+// Whether the falling piece is drawn in between cells (see game_set_smooth).
+// Only set before the simulation starts.
+static int smooth;
+// For smooth drawing: the falling piece and how far it had fallen as of the
+// start of the last tick, and when that tick was due.
+static struct BoardPiece prev_falling;
+static Uint32 prev_acc;
+static Uint64 last_tick_at;
+
+enum SimCommandType {
+  CMD_INPUT,
+  CMD_TOGGLE_PAUSE,
+  CMD_PAUSE
 };
 
-static const struct PieceTemplate
-template[NUM_DIFFERENT_PIECES] = {
-  { .fills = { {0, 0}, {1, 0}, {2, 0}, {3, 0} },
-    .size = {4, 1} },
-
-  { .fills = { {0, 0}, {0, 1}, {1, 0}, {1, 1} },
-    .size = {2, 2} },
-
-  { .fills = { {0, 0}, {1, 0}, {1, 1}, {2, 1} },
-    .size = {2, 1} },
-
-  { .fills = { {0, 1}, {1, 1}, {1, 0}, {2, 0} },
-    .size = {3, 1} },
-
-  { .fills = { {0, 0}, {1, 0}, {2, 0}, {2, 1} },
-    .size = {3, 2} },
+struct SimCommand {
+  Uint8 type;
+  // An InputAction, for CMD_INPUT.
+  Uint8 action;
+};
 
-  { .fills = { {0, 1}, {1, 1}, {2, 1}, {2, 0} },
-    .size = {3, 2} },
+// From the game loop (producer) to the simulation (consumer).
+static struct SimCommand commands[COMMAND_RING_SIZE];
+static struct Ring command_ring = {.size = COMMAND_RING_SIZE};
+// Posted along with each command, so the simulation doesn't sit on it
+// until the next tick.
+static SDL_sem *sim_wake;
+static SDL_Thread *sim_thread;
+static SDL_atomic_t sim_quit, sim_failed;
+// Commands taken off the ring, and when each of the last ones was applied
+// (at its number % COMMAND_RING_SIZE, 0 if it changed nothing).
+static Uint32 commands_done;
+static Uint64 applied_at[COMMAND_RING_SIZE];
 
-  { .fills = { {0, 0}, {1, 0}, {2, 0}, {1, 1} },
-    .size = {3, 2} }
+/**
+ * What drawing the game needs, as of the tick it was published on.
+ */
+struct GameView {
+  struct Board board;
+  int paused, game_over;
+  Uint32 spawns;
+  Uint32 commands_done;
+  Uint64 applied_at[COMMAND_RING_SIZE];
+  // Only kept up to date when drawing smooth.
+  struct BoardPiece prev_falling;
+  Uint32 prev_acc, acc;
+  Uint64 tick_at;
 };
 
-static struct Panel panel;
-static struct Score score;
-static Uint32 last_update_ms;
-static SDL_Texture *block;
-static SDL_Renderer *g_rend;
-static PixelDim2D screen_dim;
+/*
+ * Triple buffer. The simulation fills views[back], then swaps it with the
+ * middle one (its index is in latest, VIEW_FRESH tells it hasn't been taken
+ * yet). The game loop swaps the middle one with views[front] when it's
+ * fresh. Neither side ever waits for the other, and the game loop always
+ * gets the latest view that was complete.
+ */
+enum {
+  VIEW_FRESH = 4
+};
+static struct GameView views[3];
+static SDL_atomic_t latest;
+static int back, front;
+// The game loop only ever looks at this one.
+static const struct GameView *shown = views;
+
+// Game loop side bookkeeping: the spawns and commands shown accounts for.
+static Uint32 shown_spawns, commands_resolved;
+
+// Stall counts, logged when the simulation thread stops. The simulation's
+// are ticks that ran more than a tick late and times it fell too far behind
+// to catch up. The game loop's are frames that came more than
+// RENDER_STALL_TICKS after the last one.
+static Uint32 sim_ticks, sim_late, sim_stalls;
+static Uint32 frames, render_stalls;
+static Uint64 last_frame;
+
+// While paused, nothing changes after the first frame showing it, so the
+// screen stops being dirty and the game loop can sleep.
+static int pause_drawn;
+
+// Whether the suggested placement is shown (H toggles it), and the search
+// depth it's for. "Hint depth N" is made for every depth up front, so the
+// depth changing doesn't rasterize anything.
+static int show_hint;
+static int hint_depth;
+static struct TextImage hint_texts[BOT_MAX_DEPTH + 1];
+
+// Whether the bot plays (see game_set_autoplay).
+static int autoplay;
+
+// Whether the perfect clear assist is on (C toggles it), and whether pc_text,
+// pc_ms and pc_rate are about its last search. Like the hint's, every text
+// it can show is made up front: one per result, and the units its numbers
+// (drawn out of small_digits) go with.
+static int show_pc;
+static int pc_text_ready;
+static struct TextImage pc_not_found_text, pc_gave_up_text;
+static struct TextImage pc_found_texts[PC_ASSIST_PIECES + 1];
+static struct TextImage pc_ms_text, pc_dot_text, pc_rate_unit_text;
+static struct TextImage *pc_text;
+// The search's time in ms, and its speed in tenths of millions of nodes per
+// second.
+static int pc_ms, pc_rate;
+
+// Set while playing back a recorded game instead of a live one.
+static const struct Replay *replay;
+static Uint32 replay_next;
+
+// Set when game_resume restored a game, so that focus goes on with it
+// instead of starting a new one.
+static int resumed;
+static Uint8 snapshot[SNAPSHOT_SIZE];
+
+static void stop_sim(void);
 
 static void
 destroy(void) {
+  stop_sim();
+  if (sim_wake) {
+    SDL_DestroySemaphore(sim_wake);
+    sim_wake = 0;
+  }
   destroy_text_image(&score.label_text);
-  destroy_text_image(&score.points_text);
+  destroy_text_image(&score.level_text);
+  for (int i = 0; i < 10; i++) {
+    destroy_text_image(medium_digits + i);
+    destroy_text_image(small_digits + i);
+  }
+  destroy_text_image(&pause_text);
+  for (int i = 0; i <= BOT_MAX_DEPTH; i++) {
+    destroy_text_image(hint_texts + i);
+  }
+  destroy_text_image(&pc_not_found_text);
+  destroy_text_image(&pc_gave_up_text);
+  for (int i = 0; i <= PC_ASSIST_PIECES; i++) {
+    destroy_text_image(pc_found_texts + i);
+  }
+  destroy_text_image(&pc_ms_text);
+  destroy_text_image(&pc_dot_text);
+  destroy_text_image(&pc_rate_unit_text);
 }
 
-static int
-panel_has_block(int x, int y) {
-  return !xSDL_ColorEq(panel.blocks[y] + x, &BLACK);
+static Uint32
+sim_ms(void) {
+  return (Uint64) panel.play.tick*1000/TICKS_PER_SECOND;
 }
 
-static int
-is_colliding(void) {
-  const GridPoint2D *rel = &panel.falling_piece.relative;
-  const GridPoint2D *blocks = panel.falling_piece.blocks;
-
-  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
-    int x = rel->x + blocks[i].x;
-    int y = rel->y + blocks[i].y;
-    if (x < 0 || x >= PANEL_COLS || y < 0 ||
-        (y < PANEL_ROWS && panel_has_block(x, y)))
-    {
-      return 1;
-    }
-  }
-  return 0;
+static void
+notify_shape(void) {
+  Uint8 cells[NUM_PIECE_PARTS];
+  board_piece_cells(&panel.play.board.falling, cells);
+  spectate_shape(cells);
 }
 
+/**
+ * Tells the stats, sound effects and spectators what happened in the game.
+ */
 static void
-flip(struct FallingPiece *piece) {
-  GridPoint2D *blocks = piece->blocks;
-  int adj_x = 0;
-  int adj_y = 0;
+notify(const struct PlayEvents *ev) {
+  struct Board *b = &panel.play.board;
+  if (ev->dropped) {
+    spectate_move(0, -ev->dropped);
+  }
 
-  // Perform a pi/2 rad rotation.
-  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
-    int x = blocks[i].x;
-    int y = blocks[i].y;
-    int xp = -y;
-    int yp = x;
-    blocks[i].x = xp;
-    blocks[i].y = yp;
-
-    // Gather negatives.
-    if (yp < 0 && -yp > adj_y) {
-      adj_y = -yp;
+  if (ev->locked) {
+    const struct LockResult *lock = &ev->lock;
+    if (!replay) {
+      stats_lock(lock->lines, lock->points, board_stack_height(b));
+      sfx_play(lock->lines == 4 ? SFX_TETRIS
+        : lock->lines ? SFX_LINES : SFX_LOCK);
     }
-    if (xp < 0 && -xp > adj_x) {
-      adj_x = -xp;
+    spectate_fixate();
+    if (lock->lines > 0) {
+      spectate_lines(lock->removed_rows);
+      spectate_score(b->points);
     }
   }
 
-  // Normalize from the negatives gathered so that nothing is negative in the
-  // end result.
-  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
-    blocks[i].x += adj_x;
-    blocks[i].y += adj_y;
+  // A piece that doesn't fit ends the game, but it still shows up.
+  if (ev->spawned || ev->game_over) {
+    if (spectate_desynced()) {
+      spectate_resync(b->cells, b->points);
+    }
+    if (!replay) {
+      stats_spawn(sim_ms());
+    }
+    if (ev->spawned) {
+      spawns++;
+    }
+    Uint8 cells[NUM_PIECE_PARTS];
+    board_piece_cells(&b->falling, cells);
+    spectate_spawn(b->falling.kind, b->next.kind, cells);
   }
 }
 
-static void
-flip_back(struct FallingPiece *piece) {
-  flip(piece);
-  flip(piece);
-  flip(piece);
-}
-
+/**
+ * Every player input goes through here, live or replayed, so both get
+ * exactly the same result. Returns whether it changed anything.
+ */
 static int
-handle_event(const SDL_Event *e) {
-  GridPoint2D *rel = &panel.falling_piece.relative;
-  if (e->type == SDL_KEYDOWN) {
-    switch (e->key.keysym.sym) {
-      case SDLK_DOWN:
-        rel->y--;
-        if (is_colliding()) {
-          rel->y++;
-        }
-        else {
-          last_update_ms = SDL_GetTicks();
-        }
+apply_input(enum InputAction action) {
+  struct PlayEvents ev;
+  int done = play_input(&panel.play, action, &ev);
+  if (done && !ev.locked) {
+    switch (action) {
+      case INPUT_DOWN:
+        spectate_move(0, -1);
         break;
-      case SDLK_LEFT:
-        rel->x--;
-        if (is_colliding()) {
-          rel->x++;
-        }
+      case INPUT_LEFT:
+        spectate_move(-1, 0);
         break;
-      case SDLK_RIGHT:
-        rel->x++;
-        if (is_colliding()) {
-          rel->x--;
-        }
+      case INPUT_RIGHT:
+        spectate_move(1, 0);
         break;
-      case SDLK_UP:
-        flip(&panel.falling_piece);
-        if (is_colliding()) {
-          flip_back(&panel.falling_piece);
-        }
+      case INPUT_ROTATE:
+      case INPUT_ROTATE_CCW:
+        notify_shape();
+        break;
+      case NUM_INPUT_ACTIONS:
         break;
     }
   }
-  return 0;
+
+  // Inputs that didn't change anything don't need to be replayed.
+  if (done && !replay) {
+    replay_record_input(panel.play.tick, action);
+    stats_input();
+    if (!ev.locked) {
+      sfx_play(action == INPUT_ROTATE || action == INPUT_ROTATE_CCW
+        ? SFX_ROTATE : SFX_MOVE);
+    }
+  }
+  notify(&ev);
+  return done;
 }
 
-/**
- * Black colors indicate nothing is falling.
- */
-static int
-is_falling(void) {
-  return !xSDL_ColorEq(&panel.falling_piece.color, &BLACK);
+static void
+set_paused(int p) {
+  paused = p;
+  // Time spent paused is not simulated afterwards.
+  clock_start = SDL_GetPerformanceCounter();
+  clock_ticks = 0;
 }
 
 static void
-update_next_piece(void) {
-  int piece_num = rand()%NUM_DIFFERENT_PIECES;
-  memcpy(panel.next_piece.blocks,
-         template[piece_num].fills,
-         NUM_PIECE_PARTS * sizeof (GridPoint2D));
-  panel.next_piece.color = colors[piece_num];
-  int num_flips = rand()%4;
-  for (int i = 0; i < num_flips; i++) {
-    flip(&panel.next_piece);
-  }
-  // Depending on how many flips took place, height becomes width.
-  if (num_flips % 2 == 1) {
-    panel.next_piece.relative = (GridPoint2D) {
-      .x = PANEL_COLS/2 - template[piece_num].size.h/2,
-      .y = PANEL_ROWS - template[piece_num].size.w/2 - 1
-    };
+publish_view(void) {
+  struct GameView *v = views + back;
+  v->board = panel.play.board;
+  v->paused = paused;
+  v->game_over = panel.play.over;
+  v->spawns = spawns;
+  v->commands_done = commands_done;
+  SDL_memcpy(v->applied_at, applied_at, sizeof applied_at);
+  if (smooth) {
+    v->prev_falling = prev_falling;
+    v->prev_acc = prev_acc;
+    v->acc = play_gravity_acc(&panel.play);
+    v->tick_at = last_tick_at;
   }
-  else {
-    panel.next_piece.relative = (GridPoint2D) {
-      .x = PANEL_COLS/2 - template[piece_num].size.w/2,
-      .y = PANEL_ROWS - template[piece_num].size.h/2 - 1
-    };
+  // All of it has to be there before the game loop can take it.
+  SDL_MemoryBarrierRelease();
+  back = SDL_AtomicSet(&latest, back | VIEW_FRESH) & ~VIEW_FRESH;
+
+  // A replay being watched isn't the game being played.
+  if (!replay) {
+    livestate_publish(&panel.play.board, panel.play.tick,
+      panel.play.over ? LIVE_GAME_OVER
+      : paused ? LIVE_PAUSED : LIVE_PLAYING);
+  }
+}
+
+/**
+ * Tells the latency probe about the commands shown accounts for.
+ */
+static void
+resolve_commands(void) {
+  for (; commands_resolved != shown->commands_done; commands_resolved++) {
+    Uint64 applied = 0;
+    if (shown->commands_done - commands_resolved <= COMMAND_RING_SIZE) {
+      applied =
+        shown->applied_at[ring_slot(&command_ring, commands_resolved)];
+    }
+    latency_resolve(commands_resolved, applied);
   }
 }
 
+/**
+ * Moves shown on to the latest view, if there's a new one. Returns 1 if
+ * there was.
+ */
+static int
+take_view(void) {
+  if (!(SDL_AtomicGet(&latest) & VIEW_FRESH)) {
+    return 0;
+  }
+  front = SDL_AtomicSet(&latest, front) & ~VIEW_FRESH;
+  SDL_MemoryBarrierAcquire();
+  shown = views + front;
+  pause_drawn = 0;
+  resolve_commands();
+  return 1;
+}
+
+/**
+ * Starts the views and the command ring over, with a view of the game as it
+ * is now. Only while the simulation thread isn't running.
+ */
 static void
-spawn_piece(void) {
-  SDL_assert(!is_falling());
-  memcpy(&panel.falling_piece,
-         &panel.next_piece,
-         sizeof (struct FallingPiece));
-  SDL_assert(is_falling());
-  update_next_piece();
+reset_views(void) {
+  ring_reset(&command_ring);
+  commands_done = commands_resolved = 0;
+  SDL_memset(applied_at, 0, sizeof applied_at);
+  shown_spawns = spawns;
+  front = 0;
+  back = 1;
+  SDL_AtomicSet(&latest, 2);
+  shown = views + front;
+  publish_view();
+  take_view();
 }
 
 static void
-reset_piece(void) {
-  panel.falling_piece.color = BLACK;
-  SDL_assert(!is_falling());
+send_command(enum SimCommandType type, enum InputAction action) {
+  unsigned room;
+  unsigned head = ring_reserve(&command_ring, &room);
+  if (!sim_thread || !room) {
+    // Nothing to take it, or the simulation hasn't taken anything in a
+    // ring's worth of key presses. Either way, it's lost.
+    return;
+  }
+  commands[ring_slot(&command_ring, head)] = (struct SimCommand) {
+    .type = type,
+    .action = action
+  };
+  latency_defer(head);
+  ring_publish(&command_ring, head, 1);
+  SDL_SemPost(sim_wake);
 }
 
+/**
+ * Simulation side: applies the commands the game loop sent so far.
+ */
 static void
-empty_line(int line) {
-  /* memset(panel.blocks[line], 0, PANEL_COLS * sizeof (SDL_Color)); */
-  for (int j = 0; j < PANEL_COLS; j++) {
-    panel.blocks[line][j] = BLACK;
+run_commands(void) {
+  unsigned n;
+  unsigned tail = ring_peek(&command_ring, &n);
+  for (unsigned i = 0; i < n; i++) {
+    unsigned slot = ring_slot(&command_ring, tail + i);
+    const struct SimCommand *c = commands + slot;
+    Uint64 *at = applied_at + slot;
+    *at = 0;
+    switch (c->type) {
+      case CMD_INPUT:
+        if (!paused && apply_input((enum InputAction) c->action)) {
+          *at = SDL_GetPerformanceCounter();
+        }
+        break;
+      case CMD_TOGGLE_PAUSE:
+        set_paused(!paused);
+        break;
+      case CMD_PAUSE:
+        set_paused(1);
+        break;
+    }
   }
+  commands_done = tail + n;
+  ring_release(&command_ring, tail, n);
 }
 
+/**
+ * Starts a perfect clear search for the piece that just started falling.
+ * The game goes on without it if that doesn't work out.
+ */
 static void
-eliminate_line(int line) {
-  for (int i = line+1; i < PANEL_ROWS; i++) {
-    memcpy(panel.blocks+i-1,
-           panel.blocks+i,
-           PANEL_COLS * sizeof (SDL_Color));
+start_pc_assist(void) {
+  pc_text_ready = 0;
+  if (pc_assist_start(&shown->board, PC_ASSIST_PIECES) < 0) {
+    show_pc = 0;
+    free_error(0);
   }
-  empty_line(PANEL_ROWS-1);
 }
 
 static int
-try_score_line(int line) {
-  for (int i = 0; i < PANEL_COLS; i++) {
-    if (xSDL_ColorEq(panel.blocks[line]+i, &BLACK)) {
-      return 0;
+handle_event(const SDL_Event *e) {
+  if (e->type == SDL_WINDOWEVENT
+      && e->window.event == SDL_WINDOWEVENT_FOCUS_LOST)
+  {
+    send_command(CMD_PAUSE, NUM_INPUT_ACTIONS);
+    return 0;
+  }
+  if (e->type != SDL_KEYDOWN) {
+    return 0;
+  }
+  if (e->key.keysym.sym == SDLK_p) {
+    send_command(CMD_TOGGLE_PAUSE, NUM_INPUT_ACTIONS);
+    return 0;
+  }
+  if (e->key.keysym.sym == SDLK_h) {
+    show_hint = !show_hint;
+    if (show_hint && board_is_falling(&shown->board)) {
+      bot_start(&shown->board);
+    }
+    return 0;
+  }
+  if (e->key.keysym.sym == SDLK_c) {
+    show_pc = !show_pc;
+    if (show_pc && board_is_falling(&shown->board)) {
+      start_pc_assist();
+    }
+    else {
+      pc_assist_stop();
     }
+    return 0;
+  }
+  // The simulation ignores them while paused: it may not be yet by the time
+  // they get there, or not anymore.
+  switch (e->key.keysym.sym) {
+    case SDLK_DOWN:
+      send_command(CMD_INPUT, INPUT_DOWN);
+      break;
+    case SDLK_LEFT:
+      send_command(CMD_INPUT, INPUT_LEFT);
+      break;
+    case SDLK_RIGHT:
+      send_command(CMD_INPUT, INPUT_RIGHT);
+      break;
+    case SDLK_UP:
+    case SDLK_x:
+      send_command(CMD_INPUT, INPUT_ROTATE);
+      break;
+    case SDLK_z:
+      send_command(CMD_INPUT, INPUT_ROTATE_CCW);
+      break;
   }
-  eliminate_line(line);
-  // 1, 2 or 3 points depending on how high the player is (=D).
-  return line < 5 ? 1 : (line < 13 ? 2 : 3);
+  return 0;
 }
 
+/**
+ * Advances the game by one tick.
+ */
 static int
-refresh_points_text(void) {
-  char text[30];
-  snprintf(text, sizeof text, "%d", score.points);
-  destroy_text_image(&score.points_text);
-  COND_PRET_LT0(init_text_image(&score.points_text, get_medium_font(), text,
-    g_rend, &DEFAULT_FG_COLOR));
-  score.points_text.pos = (Point2D) {
-    .x = PADDING_PX + panel.geom.w - score.points_text.dim.w,
-    .y = PADDING_PX
-  };
+sim_tick(void) {
+  if (smooth) {
+    prev_falling = panel.play.board.falling;
+    prev_acc = play_gravity_acc(&panel.play);
+  }
+
+  struct PlayEvents ev;
+  play_tick(&panel.play, &ev);
+  notify(&ev);
+  if (ev.spawned || ev.game_over) {
+    // Nothing to draw it coming from.
+    prev_falling = panel.play.board.falling;
+    prev_acc = 0;
+  }
   return 0;
 }
 
+/**
+ * Performance counter value tick number n of the schedule is due at.
+ */
+static Uint64
+tick_due(Uint32 n) {
+  return clock_start + (Uint64) n*SDL_GetPerformanceFrequency()
+    / TICKS_PER_SECOND;
+}
+
+/**
+ * The simulation thread. Ticks run on a schedule of their own, off the
+ * performance counter, so however long frames take, ticks neither drift nor
+ * get lost. It stops on its own when the game is over; the game loop ends
+ * the game once it sees that.
+ */
 static int
-try_score(void) {
-  int pts = 0;
-  int upper_bound = PANEL_ROWS;
-  int i = 0;
-  int lines = 0;
-  while (i < upper_bound) {
-    int line_pts = try_score_line(i);
-    if (line_pts != 0) {
-      pts += line_pts;
-      upper_bound--;
-      lines++;
+sim_main(void *unused) {
+  (void) unused;
+  const Uint64 period = SDL_GetPerformanceFrequency()/TICKS_PER_SECOND;
+  while (!SDL_AtomicGet(&sim_quit)) {
+    Uint32 done_before = commands_done;
+    run_commands();
+    int changed = commands_done != done_before;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    for (int i = 0;
+         !paused && !panel.play.over && tick_due(clock_ticks + 1) <= now;
+         i++)
+    {
+      if (i == MAX_TICKS_PER_FRAME) {
+        // The thread didn't get to run for a good while.
+        sim_stalls++;
+        clock_start = now;
+        clock_ticks = 0;
+        break;
+      }
+      if (now - tick_due(clock_ticks + 1) > period) {
+        sim_late++;
+      }
+      clock_ticks++;
+      sim_ticks++;
+      last_tick_at = tick_due(clock_ticks);
+      if (sim_tick() < 0) {
+        // Its error can't go on the game loop thread's error stack.
+        SDL_AtomicSet(&sim_failed, 1);
+        return -1;
+      }
+      changed = 1;
+    }
+    if (changed) {
+      publish_view();
+    }
+    if (panel.play.over) {
+      break;
+    }
+
+    if (paused) {
+      SDL_SemWait(sim_wake);
     }
     else {
-      i++;
+      now = SDL_GetPerformanceCounter();
+      Uint64 due = tick_due(clock_ticks + 1);
+      Uint32 wait_ms = due > now
+        ? (Uint32) ((due - now)*1000/SDL_GetPerformanceFrequency()) + 1 : 0;
+      SDL_SemWaitTimeout(sim_wake, wait_ms);
     }
   }
-  if (lines > 0) {
-    // Each extra line you remove, you should double your points. If a line
-    // gives you P points, removing 2 lines will give you 2P points, but
-    // removing 3 lines (at once) will give you 4P; 4 lines 8P.
-    pts <<= lines - 1;
-    score.points += pts;
-    COND_PRET_LT0(refresh_points_text());
-  }
   return 0;
 }
 
 static int
-fixate(void) {
-  const GridPoint2D *rel = &panel.falling_piece.relative;
-  const GridPoint2D *blocks = panel.falling_piece.blocks;
+start_sim(void) {
+  SDL_AtomicSet(&sim_quit, 0);
+  SDL_AtomicSet(&sim_failed, 0);
+  sim_ticks = sim_late = sim_stalls = 0;
+  frames = render_stalls = 0;
+  last_frame = 0;
+  sim_thread = SDL_CreateThread(sim_main, "sim", 0);
+  COND_ERET_IF0(sim_thread, -1, SDL_GetError());
+  return 0;
+}
 
-  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
-    int x = rel->x + blocks[i].x;
-    int y = rel->y + blocks[i].y;
-    if (y >= PANEL_ROWS) {
-      continue;
-    }
-    panel.blocks[y][x] = panel.falling_piece.color;
+/**
+ * Stops the simulation thread, if it's running, so that the game is this
+ * thread's to touch again.
+ */
+static void
+stop_sim(void) {
+  if (!sim_thread) {
+    return;
   }
-  reset_piece();
-  COND_PRET_LT0(try_score());
-  return 0;
+  SDL_AtomicSet(&sim_quit, 1);
+  SDL_SemPost(sim_wake);
+  SDL_WaitThread(sim_thread, 0);
+  sim_thread = 0;
+  SDL_Log("game: simulation: %u ticks, %u late, %u stalls; "
+    "render: %u frames, %u stalls", sim_ticks, sim_late, sim_stalls, frames,
+    render_stalls);
 }
 
-static int
-update(void) {
-  Uint32 now_ms = SDL_GetTicks();
+static void
+end_game(void) {
+  const struct Board *b = &panel.play.board;
+  pc_assist_stop();
+  if (snapshot_remove(SNAPSHOT_FILE) < 0) {
+    // At worst, the game that just ended gets resumed next launch.
+    free_error(0);
+  }
+  stats_game_end(sim_ms(), b->points);
+  if (replay_record_end(panel.play.tick, b->points, b->lines, b->pieces) < 0) {
+    // Losing the replay isn't worth stopping the program for.
+    free_error(0);
+  }
+  add_score(b->points);
+  change_screen(MENU_SCREEN);
+}
 
-  if (is_falling()) {
-    Uint32 delta_ms = now_ms - last_update_ms;
+static void
+refresh_pc_text(const struct PcResult *r) {
+  switch (r->status) {
+    case PC_NOT_FOUND:
+      pc_text = &pc_not_found_text;
+      break;
+    case PC_FOUND:
+      pc_text = pc_found_texts + SDL_min(r->num_moves, PC_ASSIST_PIECES);
+      break;
+    case PC_GAVE_UP:
+      pc_text = &pc_gave_up_text;
+      break;
+  }
+  pc_ms = r->ms + 0.5;
+  pc_rate = r->ms > 0 ? r->nodes/r->ms/100 + 0.5 : 0;
+  pc_text_ready = 1;
+}
+
+/**
+ * Steers the falling piece towards where the bot would put it: turns it,
+ * then moves it over, then drops it, a command at a time and each only once
+ * the game shows the last one, so it never overshoots.
+ */
+static void
+autoplay_step(void) {
+  const struct BotMove *move = bot_best();
+  const struct BoardPiece *piece = &shown->board.falling;
+  if (!move->depth || !board_is_falling(&shown->board)
+      || commands_resolved != ring_published(&command_ring))
+  {
+    return;
+  }
+  enum InputAction action = INPUT_DOWN;
+  if (piece->rotation != move->piece.rotation) {
+    action = INPUT_ROTATE;
+  }
+  else if (piece->relative.x < move->piece.relative.x) {
+    action = INPUT_RIGHT;
+  }
+  else if (piece->relative.x > move->piece.relative.x) {
+    action = INPUT_LEFT;
+  }
+  send_command(CMD_INPUT, action);
+}
 
-    if (delta_ms > FALL_DELAY_MS) {
-      GridPoint2D *rel = &panel.falling_piece.relative;
+static int
+update(void) {
+  COND_ERET(SDL_AtomicGet(&sim_failed), -1, "The game simulation failed.");
+  take_view();
+  if (shown->game_over) {
+    stop_sim();
+    end_game();
+    return 0;
+  }
+  music_set_level(board_level(&shown->board));
+  if (shown->paused) {
+    return 0;
+  }
 
-      rel->y--;
-      if (is_colliding()) {
-        rel->y++;
-        COND_PRET_LT0(fixate());
+  // Searches for the piece that just started falling.
+  if (shown->spawns != shown_spawns) {
+    shown_spawns = shown->spawns;
+    if (board_is_falling(&shown->board)) {
+      if (show_hint || autoplay) {
+        bot_start(&shown->board);
+      }
+      if (show_pc) {
+        start_pc_assist();
       }
-      last_update_ms = now_ms;
     }
   }
-  else {
-    spawn_piece();
-    if (is_colliding()) {
-      // If right after creation of new piece, it's already colliding, then
-      // this game ended: add score and leave.
-      add_score(score.points);
-      change_screen(MENU_SCREEN);
-    }
+
+  // Whatever is left of the frame goes to the hint, up to its budget.
+  if ((show_hint || autoplay) && board_is_falling(&shown->board)) {
+    bot_think();
+    hint_depth = bot_best()->depth;
+  }
+  if (autoplay) {
+    autoplay_step();
+  }
+  if (show_pc && !pc_text_ready && pc_assist_result()) {
+    refresh_pc_text(pc_assist_result());
+  }
+  return 0;
+}
+
+void
+game_set_smooth(int on) {
+  smooth = on;
+}
+
+void
+game_set_autoplay(int on) {
+  autoplay = on;
+}
+
+static int
+start_game(Uint32 seed) {
+  play_reset(&panel.play, seed);
+  spawns = 0;
+  set_paused(0);
+  spectate_new_game();
+  reset_views();
+  return 0;
+}
+
+int
+game_suspend(void) {
+  stop_sim();
+  if (replay || panel.play.over) {
+    return 0;
   }
+  Uint8 *p = snapshot;
+  play_save(&panel.play, p);
+  p += PLAY_SAVE_SIZE;
+  p += replay_record_save(p);
+  COND_PRET_LT0(snapshot_save(SNAPSHOT_FILE, SNAPSHOT_VERSION, snapshot,
+    p - snapshot));
   return 0;
 }
 
+int
+game_resume(void) {
+  Uint64 start = SDL_GetPerformanceCounter();
+  int size = snapshot_load(SNAPSHOT_FILE, SNAPSHOT_VERSION, snapshot,
+    sizeof snapshot);
+  COND_PRET_LT0(size);
+  if (!size) {
+    return 0;
+  }
+
+  if (size < PLAY_SAVE_SIZE || play_load(&panel.play, snapshot) < 0
+      || replay_record_load(snapshot + PLAY_SAVE_SIZE,
+        size - PLAY_SAVE_SIZE) < 0)
+  {
+    // It passed the checksum, so it was written like that. Nothing to do
+    // but start over.
+    SDL_Log("game: ignoring a snapshot that doesn't make sense");
+    free_error(0);
+    return 0;
+  }
+  replay = 0;
+  resumed = 1;
+
+  SDL_Log("game: resumed a game in %.3f ms",
+    (SDL_GetPerformanceCounter() - start)*1000.0
+      / SDL_GetPerformanceFrequency());
+  return 1;
+}
+
+/**
+ * Goes on with the game game_resume restored. It starts paused, so whoever
+ * walks up to it gets to see the board first.
+ */
 static void
-empty_blocks(void) {
-  for (int i = 0; i < PANEL_ROWS; i++) {
-    empty_line(i);
+continue_game(void) {
+  resumed = 0;
+  set_paused(1);
+  spawns = 0;
+  reset_views();
+  stats_game_start(sim_ms());
+  spectate_new_game();
+  spectate_resync(panel.play.board.cells, panel.play.board.points);
+  if (board_is_falling(&panel.play.board)) {
+    Uint8 cells[NUM_PIECE_PARTS];
+    board_piece_cells(&panel.play.board.falling, cells);
+    spectate_spawn(panel.play.board.falling.kind, panel.play.board.next.kind,
+      cells);
   }
 }
 
 static int
 focus(void) {
-  last_update_ms = SDL_GetTicks();
-
-  // On focus, a new game should be started.
-  empty_blocks();
-  reset_piece();
-  score.points = 0;
-  COND_PRET_LT0(refresh_points_text());
-  update_next_piece();
+  if (resumed) {
+    continue_game();
+  }
+  else {
+    // On focus, a new game should be started.
+    Uint32 seed = rand();
+    replay = 0;
+    replay_record_start(seed);
+    stats_game_start(0);
+    COND_PRET_LT0(start_game(seed));
+  }
+  COND_PRET_LT0(start_sim());
+  return 0;
+}
+
+int
+game_start_replay(const struct Replay *r) {
+  replay = r;
+  replay_next = 0;
+  COND_PRET_LT0(start_game(r->header.seed));
   return 0;
 }
 
+int
+game_replay_step(void) {
+  SDL_assert(replay);
+  if (panel.play.over || panel.play.tick >= replay->header.ticks) {
+    return 0;
+  }
+  while (replay_next < replay->header.num_inputs
+         && replay->inputs[replay_next].tick <= panel.play.tick)
+  {
+    apply_input(replay->inputs[replay_next].action);
+    replay_next++;
+  }
+  COND_PRET_LT0(sim_tick());
+  publish_view();
+  return 1;
+}
+
 static int
 render_panel_border(void) {
   const SDL_Rect border = {
@@ -425,6 +905,14 @@ render_panel_border(void) {
   return 0;
 }
 
+/**
+ * Empty cells (kind 0) are black.
+ */
+static const SDL_Color*
+kind_color(int cell) {
+  return cell ? PIECE_COLORS + cell - 1 : &BLACK;
+}
+
 static int
 render_block(const SDL_Rect *rect, const SDL_Color *color) {
   COND_ERET_LT0(xSDL_SetTextureColorMod(block, color), SDL_GetError());
@@ -443,45 +931,206 @@ render_panel_blocks(void) {
     block_rect.y = (PANEL_ROWS - i - 1)*block_rect.h;
     for (int j = 0; j < PANEL_COLS; j++) {
       block_rect.x = block_rect.w*j;
-      COND_PRET_LT0(render_block(&block_rect, panel.blocks[i] + j));
+      COND_PRET_LT0(render_block(&block_rect,
+        kind_color(shown->board.cells[i][j])));
     }
   }
   COND_ERET_LT0(xSDL_SetTextureColorMod(block, &WHITE), SDL_GetError());
   return 0;
 }
 
+/**
+ * How much of a row piece has fallen below its cell, with gravity_acc at
+ * acc. Nothing if it's resting on something.
+ */
+static double
+fallen(const struct BoardPiece *piece, Uint32 acc) {
+  struct BoardPiece below = *piece;
+  below.relative.y--;
+  return board_collides(&shown->board, &below) ? 0 : (double) acc/GRAVITY_ONE;
+}
+
+/**
+ * The fraction of a tick gone by since the last one, from 0 to 1.
+ */
+static double
+tick_alpha(void) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (now <= shown->tick_at) {
+    return 0;
+  }
+  double alpha = (double) (now - shown->tick_at)*TICKS_PER_SECOND
+    / SDL_GetPerformanceFrequency();
+  return alpha < 1 ? alpha : 1;
+}
+
 static int
 render_falling_piece(void) {
+  if (!board_is_falling(&shown->board)) {
+    return 0;
+  }
+
   const int block_w = panel.block_dim.w;
   const int block_h = panel.block_dim.h;
 
-  const GridPoint2D *rel = &panel.falling_piece.relative;
+  const struct BoardPiece *piece = &shown->board.falling;
+  const GridPoint2D *rel = &piece->relative;
 
   // Remembering that vertical indices grow from bottom -> up.
-  const int base_x_px = rel->x*block_w;
-  const int base_y_px = (PANEL_ROWS - rel->y - 1)*block_h;
+  int base_x_px = rel->x*block_w;
+  int base_y_px = (PANEL_ROWS - rel->y - 1)*block_h;
+
+  // Drawn as far from where it was on the last tick to where it is now as
+  // the time since that tick goes, so it moves in between cells on displays
+  // showing more frames than there are ticks. Replays get a frame per tick,
+  // and a turned piece jumps to its new shape.
+  const struct BoardPiece *prev = &shown->prev_falling;
+  if (smooth && sim_thread && prev->kind == piece->kind
+      && prev->rotation == piece->rotation)
+  {
+    double alpha = tick_alpha();
+    double x = prev->relative.x + (rel->x - prev->relative.x)*alpha;
+    double y_before = prev->relative.y - fallen(prev, shown->prev_acc);
+    double y_now = rel->y - fallen(piece, shown->acc);
+    double y = y_before + (y_now - y_before)*alpha;
+    base_x_px = (int) SDL_floor(x*block_w + 0.5);
+    base_y_px = (int) SDL_floor((PANEL_ROWS - y - 1)*block_h + 0.5);
+  }
 
   SDL_Rect block_rect;
   block_rect.w = panel.block_dim.w;
   block_rect.h = panel.block_dim.h;
 
   for (int i = 0; i < NUM_PIECE_PARTS; i++) {
-    const GridPoint2D *block = panel.falling_piece.blocks + i;
+    const GridPoint2D *b = piece->blocks + i;
 
     // Remembering, again, that vertical indices grow from bottom -> up.
-    block_rect.x = block->x*block_w + base_x_px;
-    block_rect.y = -block->y*block_h + base_y_px;
+    block_rect.x = b->x*block_w + base_x_px;
+    block_rect.y = -b->y*block_h + base_y_px;
 
-    COND_PRET_LT0(render_block(&block_rect, &panel.falling_piece.color));
+    COND_PRET_LT0(render_block(&block_rect, PIECE_COLORS + piece->kind));
   }
   COND_ERET_LT0(xSDL_SetTextureColorMod(block, &WHITE), SDL_GetError());
   return 0;
 }
 
+static int
+render_outline(const struct BoardPiece *piece, const SDL_Color *color) {
+  COND_ERET_LT0(xSDL_SetRenderDrawColor(g_rend, color), SDL_GetError());
+  for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+    const int x = piece->relative.x + piece->blocks[i].x;
+    const int y = piece->relative.y + piece->blocks[i].y;
+    const SDL_Rect rect = {
+      .x = x*panel.block_dim.w,
+      .y = (PANEL_ROWS - y - 1)*panel.block_dim.h,
+      .w = panel.block_dim.w,
+      .h = panel.block_dim.h
+    };
+    COND_ERET_LT0(SDL_RenderDrawRect(g_rend, &rect), SDL_GetError());
+  }
+  return 0;
+}
+
+/**
+ * Outline of where the hint says the falling piece should go.
+ */
+static int
+render_hint(void) {
+  const struct BotMove *move = bot_best();
+  if (!show_hint || !move->depth || !board_is_falling(&shown->board)) {
+    return 0;
+  }
+  const struct BoardPiece *piece = &move->piece;
+  return render_outline(piece, PIECE_COLORS + piece->kind);
+}
+
+/**
+ * Outline (in white, unlike the hint's) of where the falling piece goes for
+ * the perfect clear the assist found.
+ */
+static int
+render_pc_move(void) {
+  const struct PcResult *r = pc_assist_result();
+  if (!show_pc || !r || r->status != PC_FOUND
+      || !board_is_falling(&shown->board))
+  {
+    return 0;
+  }
+  return render_outline(r->moves, &WHITE);
+}
+
+/**
+ * Draws n out of digit images, from x on (or up to x, if right_aligned).
+ */
+static int
+render_number(struct TextImage digits[10], int n, int x, int y,
+              int right_aligned)
+{
+  char text[12];
+  int len = snprintf(text, sizeof text, "%d", n);
+  if (right_aligned) {
+    for (int i = 0; i < len; i++) {
+      x -= digits[text[i] - '0'].dim.w;
+    }
+  }
+  for (int i = 0; i < len; i++) {
+    struct TextImage *digit = digits + (text[i] - '0');
+    digit->pos = (Point2D) {x, y};
+    COND_PRET_LT0(render_text_image(digit));
+    x += digit->dim.w;
+  }
+  return 0;
+}
+
+/**
+ * Width render_number takes to draw n.
+ */
+static int
+number_width(const struct TextImage digits[10], int n) {
+  char text[12];
+  int len = snprintf(text, sizeof text, "%d", n);
+  int w = 0;
+  for (int i = 0; i < len; i++) {
+    w += digits[text[i] - '0'].dim.w;
+  }
+  return w;
+}
+
+/**
+ * Draws the last search's result, and under it "<ms>ms <rate>M/s".
+ */
+static int
+render_pc_text(void) {
+  COND_PRET_LT0(render_text_image(pc_text));
+  int x = pc_text->pos.x;
+  const int y = pc_text->pos.y + pc_text->dim.h;
+
+  COND_PRET_LT0(render_number(small_digits, pc_ms, x, y, 0));
+  x += number_width(small_digits, pc_ms);
+  pc_ms_text.pos = (Point2D) {x, y};
+  COND_PRET_LT0(render_text_image(&pc_ms_text));
+  x += pc_ms_text.dim.w;
+
+  COND_PRET_LT0(render_number(small_digits, pc_rate/10, x, y, 0));
+  x += number_width(small_digits, pc_rate/10);
+  pc_dot_text.pos = (Point2D) {x, y};
+  COND_PRET_LT0(render_text_image(&pc_dot_text));
+  x += pc_dot_text.dim.w;
+  COND_PRET_LT0(render_number(small_digits, pc_rate%10, x, y, 0));
+  x += number_width(small_digits, pc_rate%10);
+  pc_rate_unit_text.pos = (Point2D) {x, y};
+  return render_text_image(&pc_rate_unit_text);
+}
+
 static int
 render_score(void) {
   COND_PRET_LT0(render_text_image(&score.label_text));
-  COND_PRET_LT0(render_text_image(&score.points_text));
+  COND_PRET_LT0(render_number(medium_digits, shown->board.points,
+    PADDING_PX + panel.geom.w, PADDING_PX, 1));
+  COND_PRET_LT0(render_text_image(&score.level_text));
+  COND_PRET_LT0(render_number(small_digits, board_level(&shown->board),
+    score.level_text.pos.x + score.level_text.dim.w, score.level_text.pos.y,
+    0));
   return 0;
 }
 
@@ -495,22 +1144,45 @@ render_next_piece(void) {
   const int base_y = PADDING_PX*2 + MEDIUM_FONT_SIZE +
     block_rect.h*NUM_PIECE_PARTS;
 
+  const struct BoardPiece *next = &shown->board.next;
   for (int i = 0; i < NUM_PIECE_PARTS; i++) {
-    block_rect.x = base_x + panel.next_piece.blocks[i].x*block_rect.w;
-    block_rect.y = base_y - panel.next_piece.blocks[i].y*block_rect.h;
-    COND_PRET_LT0(render_block(&block_rect, &panel.next_piece.color));
+    block_rect.x = base_x + next->blocks[i].x*block_rect.w;
+    block_rect.y = base_y - next->blocks[i].y*block_rect.h;
+    COND_PRET_LT0(render_block(&block_rect, PIECE_COLORS + next->kind));
   }
 
   return 0;
 }
 
+/**
+ * Counts the frame towards the render stalls. Frames after a pause don't
+ * count: nothing got drawn while paused on purpose.
+ */
+static void
+count_frame(void) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  Uint64 stall = RENDER_STALL_TICKS*SDL_GetPerformanceFrequency()
+    / TICKS_PER_SECOND;
+  if (last_frame && now - last_frame > stall) {
+    render_stalls++;
+  }
+  last_frame = shown->paused ? 0 : now;
+  frames++;
+}
+
 static int
 render(void) {
+  // Replays don't go through update.
+  take_view();
+  count_frame();
+
   SDL_Rect original_viewport;
   SDL_RenderGetViewport(g_rend, &original_viewport);
 
   COND_ERET_LT0(SDL_RenderSetViewport(g_rend, &panel.geom), SDL_GetError());
   COND_PRET_LT0(render_panel_blocks());
+  COND_PRET_LT0(render_hint());
+  COND_PRET_LT0(render_pc_move());
   COND_PRET_LT0(render_falling_piece());
   COND_PRET_LT0(render_panel_border());
 
@@ -518,10 +1190,27 @@ render(void) {
     SDL_GetError());
   COND_PRET_LT0(render_score());
   COND_PRET_LT0(render_next_piece());
+  if (show_hint && hint_depth) {
+    COND_PRET_LT0(render_text_image(hint_texts + hint_depth));
+  }
+  if (show_pc && pc_text_ready) {
+    COND_PRET_LT0(render_pc_text());
+  }
 
+  if (shown->paused) {
+    COND_PRET_LT0(render_text_image(&pause_text));
+    pause_drawn = 1;
+  }
   return 0;
 }
 
+static int
+is_dirty(void) {
+  // Commands the simulation hasn't got to yet may still change the view.
+  return !shown->paused || !pause_drawn
+    || ring_published(&command_ring) != shown->commands_done;
+}
+
 int
 init_game(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_) {
   g_rend = g_rend_;
@@ -560,24 +1249,81 @@ init_game(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_) {
   COND_EGOTO_LT0(
     init_text_image(&score.label_text, font, "Pts", g_rend, &DEFAULT_FG_COLOR),
     e_cleanup, 0);
+  score.label_text.pos = (Point2D) {.x = PADDING_PX, .y = PADDING_PX};
+
+  COND_EGOTO_LT0(init_text_image(&score.level_text, get_small_font(),
+    "Level ", g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+  score.level_text.pos = (Point2D) {
+    .x = PADDING_PX*2 + panel.geom.w,
+    .y = PADDING_PX*3 + MEDIUM_FONT_SIZE
+      + panel.block_dim.h*(NUM_PIECE_PARTS + 1)
+  };
+
+  for (int i = 0; i < 10; i++) {
+    const char text[2] = {'0' + i, '\0'};
+    COND_EGOTO_LT0(init_text_image(medium_digits + i, font, text, g_rend,
+      &DEFAULT_FG_COLOR), e_cleanup, 0);
+    COND_EGOTO_LT0(init_text_image(small_digits + i, get_small_font(), text,
+      g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+  }
+
+  for (int i = 1; i <= BOT_MAX_DEPTH; i++) {
+    char text[30];
+    snprintf(text, sizeof text, "Hint depth %d", i);
+    COND_EGOTO_LT0(init_text_image(hint_texts + i, get_small_font(), text,
+      g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+    hint_texts[i].pos = (Point2D) {
+      .x = score.level_text.pos.x,
+      .y = score.level_text.pos.y + score.level_text.dim.h + PADDING_PX/2
+    };
+  }
+
+  // Leaves a line for the hint.
+  const Point2D pc_pos = {
+    .x = score.level_text.pos.x,
+    .y = score.level_text.pos.y + score.level_text.dim.h + PADDING_PX
+      + SMALL_FONT_SIZE
+  };
+  COND_EGOTO_LT0(init_text_image(&pc_not_found_text, get_small_font(),
+    "No PC", g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+  pc_not_found_text.pos = pc_pos;
+  COND_EGOTO_LT0(init_text_image(&pc_gave_up_text, get_small_font(),
+    "PC gave up", g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+  pc_gave_up_text.pos = pc_pos;
+  for (int i = 0; i <= PC_ASSIST_PIECES; i++) {
+    char text[30];
+    snprintf(text, sizeof text, "PC in %d", i);
+    COND_EGOTO_LT0(init_text_image(pc_found_texts + i, get_small_font(),
+      text, g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+    pc_found_texts[i].pos = pc_pos;
+  }
+  COND_EGOTO_LT0(init_text_image(&pc_ms_text, get_small_font(), "ms ",
+    g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+  COND_EGOTO_LT0(init_text_image(&pc_dot_text, get_small_font(), ".",
+    g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+  COND_EGOTO_LT0(init_text_image(&pc_rate_unit_text, get_small_font(),
+    "M/s", g_rend, &DEFAULT_FG_COLOR), e_cleanup, 0);
+
   COND_EGOTO_LT0(
-    init_text_image(&score.points_text, font, "0", g_rend, &DEFAULT_FG_COLOR),
+    init_text_image(&pause_text, font, "Paused", g_rend, &DEFAULT_FG_COLOR),
     e_cleanup, 0);
-
-  score.label_text.pos = (Point2D) {.x = PADDING_PX, .y = PADDING_PX};
-  score.points_text.pos = (Point2D) {
-    .x = PADDING_PX + panel.geom.w - score.points_text.dim.w,
-    .y = PADDING_PX
+  pause_text.pos = (Point2D) {
+    .x = panel.geom.x + panel.geom.w/2 - pause_text.dim.w/2,
+    .y = panel.geom.y + panel.geom.h/2 - pause_text.dim.h/2
   };
 
   block = get_tetris_block_img();
 
+  sim_wake = SDL_CreateSemaphore(0);
+  COND_EGOTO_IF0(sim_wake, e_cleanup, SDL_GetError());
+
   const struct ScreenObject self = {
     .focus = focus,
     .render = render,
     .update = update,
     .handle_event = handle_event,
-    .destroy = destroy
+    .destroy = destroy,
+    .is_dirty = is_dirty
   };
   register_screen(GAME_SCREEN, &self);
 
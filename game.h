@@ -5,8 +5,57 @@
 
 #include "screens.h"
 #include "2D.h"
+#include "replay.h"
 
 int
 init_game(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_);
 
+/**
+ * Turns drawing the falling piece in between cells on or off (it's off to
+ * begin with). When on, it's drawn where it was on the last tick moved
+ * towards where it is now by the time gone by since, which only shows on
+ * displays faster than the ticks. The game itself is the same either way.
+ * Call it before the game screen gets focused.
+ */
+void
+game_set_smooth(int on);
+
+/**
+ * Turns the bot playing live games on or off (it's off to begin with). It
+ * steers each piece to where the hint would put it, through the same
+ * commands as the keyboard. Call it before the game screen gets focused.
+ */
+void
+game_set_autoplay(int on);
+
+/**
+ * Plays a recorded game back instead of a live one, without the keyboard or
+ * the clock: each game_replay_step simulates one tick. *r must stay around
+ * until the replay is done.
+ */
+int
+game_start_replay(const struct Replay *r);
+
+/**
+ * Returns 1 if a tick was simulated, 0 if the recorded game is over and
+ * negative on errors.
+ */
+int
+game_replay_step(void);
+
+/**
+ * Saves the game being played (if there's one going on) so that the next
+ * launch can pick it up with game_resume.
+ */
+int
+game_suspend(void);
+
+/**
+ * Restores the game game_suspend saved, if there's one. Returns 1 if it did,
+ * in which case focusing the game screen goes on with it (paused) instead of
+ * starting a new one.
+ */
+int
+game_resume(void);
+
 #endif
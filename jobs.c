@@ -0,0 +1,116 @@
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "jobs.h"
+
+enum {
+  MAX_POOL_THREADS = 64
+};
+
+struct JobPool {
+  SDL_Thread *threads[MAX_POOL_THREADS];
+  int num_threads;
+
+  SDL_sem *start;
+  SDL_sem *done;
+  SDL_atomic_t quit;
+
+  // Current batch.
+  JobFn fn;
+  void *ctx;
+  int num_jobs;
+  SDL_atomic_t next_job;
+};
+
+static void
+work(struct JobPool *pool) {
+  int i;
+  while ((i = SDL_AtomicAdd(&pool->next_job, 1)) < pool->num_jobs) {
+    pool->fn(pool->ctx, i);
+  }
+}
+
+static int
+worker(void *data) {
+  struct JobPool *pool = data;
+  for (;;) {
+    SDL_SemWait(pool->start);
+    if (SDL_AtomicGet(&pool->quit)) {
+      return 0;
+    }
+    work(pool);
+    SDL_SemPost(pool->done);
+  }
+}
+
+struct JobPool*
+create_job_pool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = SDL_GetCPUCount();
+  }
+  num_threads = SDL_max(1, SDL_min(num_threads, MAX_POOL_THREADS));
+
+  struct JobPool *pool = SDL_calloc(1, sizeof *pool);
+  COND_ERET_IF0(pool, 0, "Out of memory.");
+  pool->num_threads = 1;
+  pool->start = SDL_CreateSemaphore(0);
+  COND_EGOTO_IF0(pool->start, e_cleanup, SDL_GetError());
+  pool->done = SDL_CreateSemaphore(0);
+  COND_EGOTO_IF0(pool->done, e_cleanup, SDL_GetError());
+
+  // Thread 0 is whoever calls run_jobs.
+  for (int i = 1; i < num_threads; i++) {
+    pool->threads[i] = SDL_CreateThread(worker, "job", pool);
+    COND_EGOTO_IF0(pool->threads[i], e_cleanup, SDL_GetError());
+    pool->num_threads++;
+  }
+  return pool;
+
+e_cleanup:
+  destroy_job_pool(pool);
+  return 0;
+}
+
+int
+job_pool_threads(const struct JobPool *pool) {
+  return pool->num_threads;
+}
+
+void
+run_jobs(struct JobPool *pool, JobFn fn, void *ctx, int num_jobs) {
+  pool->fn = fn;
+  pool->ctx = ctx;
+  pool->num_jobs = num_jobs;
+  SDL_AtomicSet(&pool->next_job, 0);
+
+  // No point in waking more threads than there are jobs.
+  int helpers = SDL_min(pool->num_threads - 1, num_jobs - 1);
+  for (int i = 0; i < helpers; i++) {
+    SDL_SemPost(pool->start);
+  }
+  work(pool);
+  for (int i = 0; i < helpers; i++) {
+    SDL_SemWait(pool->done);
+  }
+}
+
+void
+destroy_job_pool(struct JobPool *pool) {
+  if (!pool) {
+    return;
+  }
+  SDL_AtomicSet(&pool->quit, 1);
+  for (int i = 1; i < pool->num_threads; i++) {
+    SDL_SemPost(pool->start);
+  }
+  for (int i = 1; i < pool->num_threads; i++) {
+    SDL_WaitThread(pool->threads[i], 0);
+  }
+  if (pool->start) {
+    SDL_DestroySemaphore(pool->start);
+  }
+  if (pool->done) {
+    SDL_DestroySemaphore(pool->done);
+  }
+  SDL_free(pool);
+}
@@ -0,0 +1,37 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/*
+ * A fixed set of worker threads for splitting a loop across cores. Running a
+ * batch of jobs allocates nothing; the threads sleep between batches.
+ */
+
+struct JobPool;
+
+/**
+ * Runs job number job_i. Jobs of one batch may run in any order and at the
+ * same time, so they should only touch their own share of ctx.
+ */
+typedef void (*JobFn)(void *ctx, int job_i);
+
+/**
+ * num_threads counts the calling thread, which also runs jobs. 0 means one
+ * per CPU. Returns null on failure.
+ */
+struct JobPool*
+create_job_pool(int num_threads);
+
+int
+job_pool_threads(const struct JobPool *pool);
+
+/**
+ * Runs fn(ctx, 0) .. fn(ctx, num_jobs - 1) and returns once all of them are
+ * done. Not reentrant: only one batch at a time per pool.
+ */
+void
+run_jobs(struct JobPool *pool, JobFn fn, void *ctx, int num_jobs);
+
+void
+destroy_job_pool(struct JobPool *pool);
+
+#endif
@@ -0,0 +1,168 @@
+#include <SDL2/SDL.h>
+
+#include "latency.h"
+#include "percentile.h"
+
+/*
+ * Probes go from received to applied to presented. Between two presents
+ * there may be a few applied ones waiting, but one frame never sees more
+ * than MAX_WAITING key presses worth measuring.
+ */
+enum {
+  MAX_WAITING = 64,
+
+  // Deferred probes kept. Must be a power of 2.
+  MAX_DEFERRED = 64
+};
+
+struct Probe {
+  Uint64 queued, polled, applied;
+};
+
+static int enabled;
+static double us_per_count;
+
+// Probe for the event being handled right now.
+static struct Probe current;
+static int have_current;
+
+// Applied probes waiting for the next present.
+static struct Probe waiting[MAX_WAITING];
+static int num_waiting;
+
+// Probes set aside by latency_defer, at their id's slot.
+static struct Probe deferred[MAX_DEFERRED];
+static Uint32 deferred_ids[MAX_DEFERRED];
+static int deferred_used[MAX_DEFERRED];
+
+static Uint32 samples[NUM_LATENCY_STAGES][LATENCY_MAX_SAMPLES];
+static Uint32 num_samples;
+
+void
+latency_enable(void) {
+  enabled = 1;
+  us_per_count = 1e6/SDL_GetPerformanceFrequency();
+}
+
+static Uint32
+to_us(Uint64 from, Uint64 to) {
+  return to > from ? (Uint32) ((to - from)*us_per_count) : 0;
+}
+
+void
+latency_received(const SDL_Event *e) {
+  if (!enabled) {
+    return;
+  }
+  have_current = e->type == SDL_KEYDOWN;
+  if (!have_current) {
+    return;
+  }
+
+  // SDL stamps events in milliseconds from SDL_GetTicks. Convert that to
+  // performance counter time by going back from now.
+  Uint64 now = SDL_GetPerformanceCounter();
+  Uint32 age_ms = SDL_GetTicks() - e->key.timestamp;
+  Uint64 age = (Uint64) age_ms*SDL_GetPerformanceFrequency()/1000;
+  current.queued = age < now ? now - age : now;
+  current.polled = now;
+}
+
+void
+latency_applied(void) {
+  if (!enabled || !have_current) {
+    return;
+  }
+  current.applied = SDL_GetPerformanceCounter();
+  if (num_waiting < MAX_WAITING) {
+    waiting[num_waiting++] = current;
+  }
+  have_current = 0;
+}
+
+void
+latency_defer(Uint32 id) {
+  if (!enabled || !have_current) {
+    return;
+  }
+  Uint32 at = id & (MAX_DEFERRED - 1);
+  // A probe still in the slot waited too long. It's dropped.
+  deferred[at] = current;
+  deferred_ids[at] = id;
+  deferred_used[at] = 1;
+  have_current = 0;
+}
+
+void
+latency_resolve(Uint32 id, Uint64 applied) {
+  Uint32 at = id & (MAX_DEFERRED - 1);
+  if (!enabled || !deferred_used[at] || deferred_ids[at] != id) {
+    return;
+  }
+  deferred_used[at] = 0;
+  if (applied && num_waiting < MAX_WAITING) {
+    waiting[num_waiting] = deferred[at];
+    waiting[num_waiting].applied = applied;
+    num_waiting++;
+  }
+}
+
+void
+latency_handled(void) {
+  have_current = 0;
+}
+
+void
+latency_presented(void) {
+  if (!enabled || !num_waiting) {
+    return;
+  }
+  Uint64 now = SDL_GetPerformanceCounter();
+  for (int i = 0; i < num_waiting; i++) {
+    const struct Probe *p = waiting + i;
+    Uint32 at = num_samples % LATENCY_MAX_SAMPLES;
+    samples[LATENCY_QUEUE][at] = to_us(p->queued, p->polled);
+    samples[LATENCY_APPLY][at] = to_us(p->polled, p->applied);
+    samples[LATENCY_PRESENT][at] = to_us(p->applied, now);
+    samples[LATENCY_TOTAL][at] = to_us(p->queued, now);
+    num_samples++;
+  }
+  num_waiting = 0;
+}
+
+void
+latency_report(struct LatencyReport *r) {
+  static Uint32 sorted[LATENCY_MAX_SAMPLES];
+  Uint32 n = SDL_min(num_samples, (Uint32) LATENCY_MAX_SAMPLES);
+
+  SDL_zerop(r);
+  r->samples = num_samples;
+  if (!n) {
+    return;
+  }
+  for (int s = 0; s < NUM_LATENCY_STAGES; s++) {
+    SDL_memcpy(sorted, samples[s], n*sizeof *sorted);
+    sort_u32(sorted, n);
+    r->p50[s] = percentile(sorted, n, 50);
+    r->p90[s] = percentile(sorted, n, 90);
+    r->p99[s] = percentile(sorted, n, 99);
+    r->max[s] = sorted[n - 1];
+  }
+}
+
+void
+latency_log(void) {
+  static const char *const NAMES[NUM_LATENCY_STAGES] = {
+    "queue", "apply", "present", "total"
+  };
+  struct LatencyReport r;
+  latency_report(&r);
+  if (!r.samples) {
+    return;
+  }
+  SDL_Log("latency: %u key presses (us: p50 / p90 / p99 / max)", r.samples);
+  for (int s = 0; s < NUM_LATENCY_STAGES; s++) {
+    SDL_Log("latency: %8s %7u %7u %7u %7u", NAMES[s], r.p50[s], r.p90[s],
+      r.p99[s], r.max[s]);
+  }
+}
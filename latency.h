@@ -0,0 +1,98 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Input latency probe. Each key press is stamped when SDL queued it, when
+ * the game loop got it out of the queue, when the game applied it and when
+ * the first frame showing its effect was presented. Key presses that didn't
+ * change anything are not counted.
+ *
+ * All the latency_* notifications do nothing until latency_enable is called.
+ */
+
+enum LatencyStage {
+  // SDL queued the event -> the game loop polled it.
+  LATENCY_QUEUE,
+  // Polled -> the game applied it.
+  LATENCY_APPLY,
+  // Applied -> SDL_RenderPresent returned with its effect on screen.
+  LATENCY_PRESENT,
+  // All of the above.
+  LATENCY_TOTAL,
+  NUM_LATENCY_STAGES
+};
+
+enum {
+  // Samples kept per stage. Past that, the oldest ones are overwritten.
+  LATENCY_MAX_SAMPLES = 8192
+};
+
+struct LatencyReport {
+  Uint32 samples;
+  // In microseconds.
+  Uint32 p50[NUM_LATENCY_STAGES];
+  Uint32 p90[NUM_LATENCY_STAGES];
+  Uint32 p99[NUM_LATENCY_STAGES];
+  Uint32 max[NUM_LATENCY_STAGES];
+};
+
+void
+latency_enable(void);
+
+/**
+ * Call with every event, right after polling it.
+ */
+void
+latency_received(const SDL_Event *e);
+
+/**
+ * Call when the last received event changed the game.
+ */
+void
+latency_applied(void);
+
+/**
+ * For events that get applied later on some other thread: sets the last
+ * received one aside under id instead of it being dropped by
+ * latency_handled. Ids are the caller's (a counter is fine); only the last
+ * 64 are kept.
+ */
+void
+latency_defer(Uint32 id);
+
+/**
+ * Tells what became of the event deferred under id: applied is the
+ * performance counter when it got applied, or 0 if it changed nothing. Call
+ * it once the frame about to be presented shows its effect.
+ */
+void
+latency_resolve(Uint32 id, Uint64 applied);
+
+/**
+ * Call after the event passed through the screen. If it wasn't applied by
+ * then, it's dropped.
+ */
+void
+latency_handled(void);
+
+/**
+ * Call right after SDL_RenderPresent.
+ */
+void
+latency_presented(void);
+
+/**
+ * Percentiles of what was measured so far.
+ */
+void
+latency_report(struct LatencyReport *r);
+
+/**
+ * Logs the report, if anything was measured.
+ */
+void
+latency_log(void);
+
+#endif
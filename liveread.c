@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "livestate.h"
+
+enum {
+  // A copy takes well under a microsecond, and the game updates at most a
+  // few hundred times a second, so running into it this many times in a
+  // row means it isn't going to finish.
+  MAX_READ_TRIES = 10000
+};
+
+int
+livestate_open(struct LiveReader *r, const char *name) {
+  r->state = 0;
+  int fd = shm_open(name, O_RDONLY, 0);
+  COND_ERET_LT0(fd, strerror(errno));
+  struct stat st;
+  COND_EGOTO_LT0(fstat(fd, &st), e_cleanup, strerror(errno));
+  COND_EGOTO(st.st_size < (off_t) sizeof *r->state, e_cleanup,
+    "Not a live game state segment.");
+  // Read only: nothing a reader does can change what others see.
+  void *p = mmap(0, sizeof *r->state, PROT_READ, MAP_SHARED, fd, 0);
+  COND_EGOTO(p == MAP_FAILED, e_cleanup, strerror(errno));
+  close(fd);
+
+  r->state = p;
+  COND_EGOTO(memcmp(r->state->magic, LIVE_STATE_MAGIC, 4)
+    || r->state->version != LIVE_STATE_VERSION, e_unmap,
+    "Not a live game state segment, or from another version.");
+  return 0;
+
+e_cleanup:
+  close(fd);
+  return -1;
+
+e_unmap:
+  livestate_close(r);
+  return -1;
+}
+
+Uint32
+livestate_seq(const struct LiveReader *r) {
+  // A plain load: an atomic read-modify-write would fault on a read only
+  // mapping.
+  Uint32 seq = *(const volatile Uint32 *) &r->state->seq;
+  SDL_MemoryBarrierAcquire();
+  return seq;
+}
+
+int
+livestate_read(const struct LiveReader *r, struct LiveGame *out) {
+  for (int i = 0; i < MAX_READ_TRIES; i++) {
+    Uint32 before = livestate_seq(r);
+    if (before & 1) {
+      continue;
+    }
+    SDL_memcpy(out, &r->state->game, sizeof *out);
+    // None of the copy's reads may happen after the check.
+    SDL_MemoryBarrierAcquire();
+    if (*(const volatile Uint32 *) &r->state->seq == before) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void
+livestate_close(struct LiveReader *r) {
+  if (r->state) {
+    munmap((void*) r->state, sizeof *r->state);
+    r->state = 0;
+  }
+}
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "livestate.h"
+
+static struct LiveState *state;
+static char shm_name[64];
+
+/**
+ * Stores v in the sequence number, after everything written before it.
+ */
+static void
+store_seq(Uint32 v) {
+  SDL_MemoryBarrierRelease();
+  *(volatile Uint32 *) &state->seq = v;
+  // And before everything written after it.
+  SDL_MemoryBarrierRelease();
+}
+
+static void
+write_game(const struct LiveGame *g) {
+  Uint32 seq = state->seq;
+  store_seq(seq + 1);
+  SDL_memcpy(&state->game, g, sizeof *g);
+  store_seq(seq + 2);
+}
+
+int
+livestate_start(const char *name) {
+  COND_ERET(strlen(name) >= sizeof shm_name, -1, "Segment name too long.");
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  COND_ERET_LT0(fd, strerror(errno));
+  COND_EGOTO_LT0(ftruncate(fd, sizeof *state), e_cleanup, strerror(errno));
+  void *p = mmap(0, sizeof *state, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  COND_EGOTO(p == MAP_FAILED, e_cleanup, strerror(errno));
+  close(fd);
+
+  state = p;
+  strcpy(shm_name, name);
+  state->version = LIVE_STATE_VERSION;
+  // Left from a game that crashed, it could be odd.
+  state->seq &= ~1u;
+  struct LiveGame g = {0};
+  g.falling_kind = g.next_kind = NO_PIECE;
+  write_game(&g);
+  // Last, so readers only recognize the segment once it makes sense.
+  SDL_MemoryBarrierRelease();
+  SDL_memcpy(state->magic, LIVE_STATE_MAGIC, sizeof state->magic);
+  return 0;
+
+e_cleanup:
+  close(fd);
+  shm_unlink(name);
+  return -1;
+}
+
+void
+livestate_publish(const struct Board *b, Uint32 tick, enum LiveStatus status) {
+  if (!state) {
+    return;
+  }
+  struct LiveGame g;
+  g.tick = tick;
+  g.points = b->points;
+  g.lines = b->lines;
+  g.pieces = b->pieces;
+  SDL_memcpy(g.rows, b->rows, sizeof g.rows);
+  SDL_memcpy(g.cells, b->cells, sizeof g.cells);
+  if (board_is_falling(b)) {
+    board_piece_cells(&b->falling, g.falling_cells);
+    g.falling_kind = b->falling.kind;
+    g.falling_rotation = b->falling.rotation;
+  }
+  else {
+    SDL_zero(g.falling_cells);
+    g.falling_kind = NO_PIECE;
+    g.falling_rotation = 0;
+  }
+  g.next_kind = b->next.kind;
+  g.level = board_level(b);
+  g.status = status;
+  SDL_zero(g.reserved);
+  write_game(&g);
+}
+
+void
+livestate_stop(void) {
+  if (!state) {
+    return;
+  }
+  struct LiveGame g = state->game;
+  g.status = LIVE_CLOSED;
+  write_game(&g);
+  munmap(state, sizeof *state);
+  state = 0;
+  shm_unlink(shm_name);
+}
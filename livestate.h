@@ -0,0 +1,123 @@
+#ifndef LIVESTATE_H
+#define LIVESTATE_H
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+
+/*
+ * The game being played, in a POSIX shared memory segment, for other
+ * programs on the same machine (stream overlays, coaching tools, loggers) to
+ * look at. The game writes it on every change; readers map the segment read
+ * only and never talk to the game, so there can be any number of them and
+ * nothing they do slows it down.
+ *
+ * The segment is a struct LiveState, guarded by a sequence lock: the writer
+ * makes seq odd, updates game, then makes seq even again. A reader copies
+ * game out and keeps the copy only if seq was the same even number before
+ * and after. livestate_read does that; the reader side (liveread.c) is also
+ * built on its own as libtetrislive.a (make live).
+ */
+
+enum {
+  LIVE_STATE_VERSION = 1
+};
+
+static const char LIVE_STATE_MAGIC[4] = {'T', 'L', 'I', 'V'};
+
+enum LiveStatus {
+  // The game screen isn't showing a game (yet).
+  LIVE_NO_GAME,
+  LIVE_PLAYING,
+  LIVE_PAUSED,
+  LIVE_GAME_OVER,
+  // The game exited. Nothing will change anymore.
+  LIVE_CLOSED
+};
+
+/**
+ * Only fixed size fields, laid out without padding, so programs built
+ * elsewhere see the same thing.
+ */
+struct LiveGame {
+  // Ticks (1/TICKS_PER_SECOND s) simulated since the game started.
+  Uint32 tick;
+  Uint32 points, lines, pieces;
+  // As in struct Board.
+  Uint16 rows[PANEL_ROWS];
+  Uint8 cells[PANEL_ROWS][PANEL_COLS];
+  // Cell indexes (y*PANEL_COLS + x) of the falling piece's blocks, if there
+  // is one.
+  Uint8 falling_cells[NUM_PIECE_PARTS];
+  // Kinds are NO_PIECE when there's nothing there.
+  Sint8 falling_kind, falling_rotation, next_kind;
+  Uint8 level;
+  // A LiveStatus.
+  Uint8 status;
+  Uint8 reserved[3];
+};
+
+struct LiveState {
+  char magic[4];
+  Uint32 version;
+  // Odd while the writer is halfway through an update. Only ever read
+  // through livestate_seq.
+  Uint32 seq;
+  Uint32 reserved;
+  struct LiveGame game;
+};
+
+struct LiveReader {
+  const struct LiveState *state;
+};
+
+/*
+ * Writer side (livestate.c), for the game.
+ */
+
+/**
+ * Creates (or takes over) the segment called name, like "/tetris".
+ */
+int
+livestate_start(const char *name);
+
+/**
+ * Writes b out. Only one thread may call it at a time. A no-op if the
+ * segment wasn't started.
+ */
+void
+livestate_publish(const struct Board *b, Uint32 tick, enum LiveStatus status);
+
+/**
+ * Marks the state LIVE_CLOSED and removes the segment's name. Readers that
+ * have it mapped still see the last state.
+ */
+void
+livestate_stop(void);
+
+/*
+ * Reader side (liveread.c).
+ */
+
+int
+livestate_open(struct LiveReader *r, const char *name);
+
+/**
+ * Copies the current state to out. Returns 1, or 0 if the writer kept
+ * changing it (or died halfway through) for as long as it tried. Any
+ * thread can call it, any number of them at once.
+ */
+int
+livestate_read(const struct LiveReader *r, struct LiveGame *out);
+
+/**
+ * Goes up by 2 on every update, so readers can poll it to tell whether
+ * there's anything new before copying.
+ */
+Uint32
+livestate_seq(const struct LiveReader *r);
+
+void
+livestate_close(struct LiveReader *r);
+
+#endif
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "error.h"
+#include "livestate.h"
+
+/*
+ * Stress test for the live game state segment: many reader threads copying
+ * it out as fast as they can while it's written, each checking every copy
+ * it gets for signs of a torn read.
+ *
+ * Usage: livestress [-r READERS] [-s SECONDS] [NAME]
+ *
+ * With NAME, it reads the segment of a running game (./main --live-state
+ * NAME) and checks that the rows and cells agree. Without it, it makes a
+ * segment of its own and writes it as fast as it can from the main thread,
+ * with boards that tell exactly what every byte should be, which is much
+ * harder on the readers than a game is.
+ */
+
+enum {
+  MAX_READERS = 64,
+  DEFAULT_READERS = 16,
+  DEFAULT_SECONDS = 5
+};
+
+static const char *const OWN_NAME = "/tetris-livestress";
+
+struct Reader {
+  struct LiveReader live;
+  int own;
+  Uint64 reads, updates, gave_up, torn;
+};
+
+static SDL_atomic_t done;
+
+/**
+ * Cell (y, x) of the boards the stress writer makes for tick.
+ */
+static Uint8
+own_cell(Uint32 tick, int y, int x) {
+  return (tick + y*3 + x) % (NUM_DIFFERENT_PIECES + 1);
+}
+
+static void
+make_own_board(struct Board *b, Uint32 tick) {
+  SDL_zerop(b);
+  for (int y = 0; y < PANEL_ROWS; y++) {
+    for (int x = 0; x < PANEL_COLS; x++) {
+      b->cells[y][x] = own_cell(tick, y, x);
+      if (b->cells[y][x]) {
+        b->rows[y] |= 1 << x;
+      }
+    }
+  }
+  b->falling.kind = NO_PIECE;
+  b->next.kind = tick % NUM_DIFFERENT_PIECES;
+  b->points = tick;
+  b->lines = tick*7;
+  b->pieces = ~tick & 0xFFFFFF;
+}
+
+static int
+consistent(const struct LiveGame *g, int own) {
+  for (int y = 0; y < PANEL_ROWS; y++) {
+    for (int x = 0; x < PANEL_COLS; x++) {
+      if (!g->cells[y][x] != !(g->rows[y] & 1 << x)) {
+        return 0;
+      }
+      if (own && g->cells[y][x] != own_cell(g->tick, y, x)) {
+        return 0;
+      }
+    }
+  }
+  return !own || (g->points == g->tick && g->lines == g->tick*7
+    && g->pieces == (~g->tick & 0xFFFFFF)
+    && g->next_kind == (Sint8) (g->tick % NUM_DIFFERENT_PIECES));
+}
+
+static int
+read_loop(void *arg) {
+  struct Reader *r = arg;
+  Uint32 last_seq = 0;
+  while (!SDL_AtomicGet(&done)) {
+    struct LiveGame g;
+    Uint32 seq = livestate_seq(&r->live);
+    if (!livestate_read(&r->live, &g)) {
+      r->gave_up++;
+      continue;
+    }
+    r->reads++;
+    r->updates += seq != last_seq;
+    last_seq = seq;
+    r->torn += !consistent(&g, r->own);
+  }
+  return 0;
+}
+
+static void
+usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [-r READERS (1 to %d)] [-s SECONDS] [NAME]\n",
+    prog, MAX_READERS);
+}
+
+static void
+print_errors(void) {
+  struct ErrorInfo *err = get_error();
+  for (struct ErrorInfo *e = err; e; e = e->next) {
+    fprintf(stderr, "%s\n", e->msg.data ? e->msg.data : "(empty)");
+  }
+  if (err) {
+    free_error(err);
+  }
+  free_error(0);
+}
+
+int
+main(int argc, char *argv[]) {
+  int num_readers = DEFAULT_READERS;
+  int seconds = DEFAULT_SECONDS;
+  int i = 1;
+  for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+    if (!strcmp(argv[i], "-r")) {
+      num_readers = atoi(argv[i+1]);
+    }
+    else if (!strcmp(argv[i], "-s")) {
+      seconds = atoi(argv[i+1]);
+    }
+    else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (num_readers < 1 || num_readers > MAX_READERS || seconds < 1
+      || argc - i > 1)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  int own = i == argc;
+  const char *name = own ? OWN_NAME : argv[i];
+
+  struct Board b;
+  if (own) {
+    make_own_board(&b, 0);
+    if (livestate_start(name) < 0) {
+      print_errors();
+      return EXIT_FAILURE;
+    }
+    livestate_publish(&b, 0, LIVE_PLAYING);
+  }
+
+  // Each reader maps the segment on its own, as separate programs would.
+  static struct Reader readers[MAX_READERS];
+  SDL_Thread *threads[MAX_READERS];
+  int num_threads = 0;
+  int ret = EXIT_FAILURE;
+  for (int k = 0; k < num_readers; k++) {
+    readers[k].own = own;
+    if (livestate_open(&readers[k].live, name) < 0) {
+      print_errors();
+      goto cleanup;
+    }
+  }
+  for (; num_threads < num_readers; num_threads++) {
+    threads[num_threads] = SDL_CreateThread(read_loop, "livereader",
+      readers + num_threads);
+    if (!threads[num_threads]) {
+      fprintf(stderr, "%s\n", SDL_GetError());
+      goto cleanup;
+    }
+  }
+
+  Uint64 freq = SDL_GetPerformanceFrequency();
+  Uint64 start = SDL_GetPerformanceCounter();
+  Uint64 end = start + seconds*freq;
+  Uint32 writes = 0;
+  Uint64 write_counts = 0;
+  if (own) {
+    for (Uint32 tick = 1; SDL_GetPerformanceCounter() < end; tick++) {
+      make_own_board(&b, tick);
+      Uint64 t = SDL_GetPerformanceCounter();
+      livestate_publish(&b, tick, LIVE_PLAYING);
+      write_counts += SDL_GetPerformanceCounter() - t;
+      writes++;
+    }
+  }
+  else {
+    SDL_Delay(seconds*1000);
+  }
+  ret = 0;
+
+cleanup:
+  SDL_AtomicSet(&done, 1);
+  Uint64 reads = 0, updates = 0, gave_up = 0, torn = 0;
+  for (int k = 0; k < num_threads; k++) {
+    SDL_WaitThread(threads[k], 0);
+    reads += readers[k].reads;
+    updates += readers[k].updates;
+    gave_up += readers[k].gave_up;
+    torn += readers[k].torn;
+  }
+  for (int k = 0; k < num_readers; k++) {
+    livestate_close(&readers[k].live);
+  }
+  if (own) {
+    livestate_stop();
+  }
+  if (ret != 0) {
+    return ret;
+  }
+
+  printf("%d readers, %d s: %llu reads (%.0f/s each), %llu updates seen, "
+    "%llu gave up, %llu torn\n", num_readers, seconds,
+    (unsigned long long) reads, (double) reads/num_readers/seconds,
+    (unsigned long long) updates, (unsigned long long) gave_up,
+    (unsigned long long) torn);
+  if (own) {
+    printf("writer: %u updates, %.0f ns each\n", writes,
+      writes ? write_counts*1e9/freq/writes : 0.0);
+  }
+  return torn ? EXIT_FAILURE : 0;
+}
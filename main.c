@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -9,17 +11,45 @@
 #include "assets.h"
 #include "error.h"
 #include "text_image.h"
+#include "text_cache.h"
 #include "screens.h"
 #include "menu.h"
 #include "game.h"
 #include "scores.h"
 #include "music.h"
+#include "spectate.h"
+#include "livestate.h"
+#include "tournament.h"
+#include "stats.h"
+#include "replay.h"
+#include "export.h"
+#include "latency.h"
+#include "bot.h"
+#include "pcsolve.h"
+#include "sfx.h"
+#include "memtrack.h"
 
 #include "xSDL.h"
 
 enum {
   WIN_WIDTH = 540,
-  WIN_HEIGHT = 640
+  WIN_HEIGHT = 640,
+
+  // Longest the game loop sleeps waiting for events while nothing needs to
+  // be redrawn. Events still wake it up right away.
+  IDLE_WAIT_MS = 500,
+
+  // The latency benchmark sends a synthetic key press every this many frames.
+  BENCH_FRAMES_PER_PRESS = 3,
+
+  // Frames on the game screen before it counts as steady gameplay, which
+  // shouldn't allocate anything.
+  STEADY_WARMUP_FRAMES = 60,
+
+  // The soak test draws a frame about this often, as vsync would, and logs
+  // how memory is doing every SOAK_REPORT_S.
+  SOAK_FRAME_MS = 16,
+  SOAK_REPORT_S = 60
 };
 
 static const char *WIN_TITLE = "Tetris";
@@ -30,28 +60,158 @@ static PixelDim2D screen_size;
 static struct ScreenObject all_screens[NUM_SCREENS];
 static struct ScreenObject *current;
 
+// Command line options. 0 means "not asked for".
+static int spectate_port;
+static const char *live_state_name;
+static int watch_port, watch_count;
+static const char *export_file, *export_dest;
+static int export_index;
+static enum ExportFormat export_format;
+// What the software renderer draws into when running without a window.
+static SDL_Surface *headless_surface;
+static int latency_probe, latency_bench_presses;
+// 1 for --smooth, 0 for --no-smooth, -1 to go by the display.
+static int smooth_option = -1;
+static int audio_buffer = MUSIC_DEFAULT_BUFFER;
+static int mem_track, mem_strict;
+static double soak_hours;
+
+// Frames in a row on the game screen so far, for telling steady gameplay.
+static Uint32 game_frames;
+
+/**
+ * Tells the text cache how many real pixels the window has per logical one
+ * now, so text gets rasterized for that.
+ */
+static void
+update_scale(void) {
+  int w, h;
+  if (SDL_GetRendererOutputSize(rend, &w, &h) < 0) {
+    return;
+  }
+  text_cache_set_scale(SDL_min(w/(double) WIN_WIDTH, h/(double) WIN_HEIGHT));
+}
+
 static int
 init_video(void) {
   window = SDL_CreateWindow(WIN_TITLE, SDL_WINDOWPOS_UNDEFINED,
-    SDL_WINDOWPOS_UNDEFINED, WIN_WIDTH, WIN_HEIGHT, SDL_WINDOW_SHOWN);
+    SDL_WINDOWPOS_UNDEFINED, WIN_WIDTH, WIN_HEIGHT,
+    SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
   COND_ERET_IF0(window, -1, SDL_GetError());
+  SDL_SetWindowMinimumSize(window, WIN_WIDTH/2, WIN_HEIGHT/2);
 
   rend = SDL_CreateRenderer(window, -1,
     SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
   COND_ERET_IF0(rend, -1, SDL_GetError());
+  // Screens lay everything out in WIN_WIDTH x WIN_HEIGHT, whatever size the
+  // window is. SDL scales it (keeping the aspect, with bars around it if it
+  // has to) and maps mouse coordinates back.
+  COND_ERET_LT0(SDL_RenderSetLogicalSize(rend, WIN_WIDTH, WIN_HEIGHT),
+    SDL_GetError());
+
+  // The game simulates 60 ticks per second. Drawing in between them only
+  // shows on displays faster than that.
+  int smooth = smooth_option;
+  if (smooth < 0) {
+    SDL_DisplayMode mode;
+    smooth = !SDL_GetWindowDisplayMode(window, &mode)
+      && mode.refresh_rate > 60;
+  }
+  game_set_smooth(smooth);
 
   return 0;
 }
 
+static int
+init_watch(SDL_Renderer *rend_, const PixelDim2D *screen_dim_) {
+  return init_tournament(rend_, screen_dim_, watch_port, watch_count);
+}
+
+/**
+ * Screens get initialized the first time they're needed, or earlier while
+ * the menu sits idle. Until then, this is all that's known about them.
+ */
+struct ScreenSlot {
+  const char *name;
+  int (*init)(SDL_Renderer *rend_, const PixelDim2D *screen_dim_);
+  int ready;
+};
+
+static struct ScreenSlot screen_slots[NUM_SCREENS] = {
+  [MENU_SCREEN] = {"menu", init_menu, 0},
+  [GAME_SCREEN] = {"game", init_game, 0},
+  [SCORES_SCREEN] = {"scores", init_scores, 0},
+  [TOURNAMENT_SCREEN] = {"tournament", init_watch, 0}
+};
+
+static double
+elapsed_ms(Uint64 start) {
+  return (SDL_GetPerformanceCounter() - start)*1000.0
+    / SDL_GetPerformanceFrequency();
+}
+
+static int
+prepare_screen(const enum ScreenId which) {
+  struct ScreenSlot *slot = screen_slots + which;
+  if (slot->ready) {
+    return 0;
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  COND_PRET_LT0(slot->init(rend, &screen_size));
+  slot->ready = 1;
+  SDL_Log("screens: %s init took %.2f ms", slot->name, elapsed_ms(start));
+  return 0;
+}
+
+/**
+ * Initializes at most one screen that isn't ready yet. It's called on frames
+ * the menu had nothing else to do, so that going to another screen later
+ * doesn't have to wait for it. Returns 1 if it initialized one, 0 if there
+ * was nothing left to do.
+ */
+static int
+prewarm_screen(void) {
+  for (int i = 0; i < NUM_SCREENS; i++) {
+    if (i == TOURNAMENT_SCREEN && !watch_count) {
+      continue;
+    }
+    if (!screen_slots[i].ready) {
+      COND_PRET_LT0(prepare_screen((enum ScreenId) i));
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int
+focus_current(void) {
+  Uint64 start = SDL_GetPerformanceCounter();
+  COND_PRET_LT0(current->focus());
+  SDL_Log("screens: %s focus took %.2f ms",
+    screen_slots[current - all_screens].name, elapsed_ms(start));
+  return 0;
+}
+
 static int
 init_screens(void) {
   screen_size.w = WIN_WIDTH;
   screen_size.h = WIN_HEIGHT;
 
-  COND_PRET_LT0(init_menu(rend, &screen_size));
-  COND_PRET_LT0(init_game(rend, &screen_size));
-  COND_PRET_LT0(init_scores(rend, &screen_size));
-  current = all_screens + MENU_SCREEN;
+  // Only the first screen is needed before the first frame.
+  enum ScreenId first = watch_count ? TOURNAMENT_SCREEN : MENU_SCREEN;
+  if (!watch_count) {
+    // A game left going on last time picks up where it was.
+    int resumed = game_resume();
+    if (resumed < 0) {
+      // Better a new game than none.
+      free_error(0);
+    }
+    else if (resumed) {
+      first = GAME_SCREEN;
+    }
+  }
+  COND_PRET_LT0(prepare_screen(first));
+  current = all_screens + first;
   return 0;
 }
 
@@ -63,9 +223,244 @@ init(void) {
   COND_ERET_IF0((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == IMG_INIT_PNG, -1,
     IMG_GetError());
   COND_PRET_LT0(init_assets(rend));
-  COND_PRET_LT0(init_music());
+  // Before any text is made, so it's made at the right scale to begin with.
+  update_scale();
+  COND_PRET_LT0(init_music(audio_buffer));
+  COND_PRET_LT0(init_sfx(audio_buffer));
+  COND_PRET_LT0(init_stats());
+  COND_PRET_LT0(init_bot());
+  COND_PRET_LT0(init_pc_assist());
   COND_PRET_LT0(init_screens());
+  if (spectate_port) {
+    COND_PRET_LT0(spectate_start(spectate_port));
+  }
+  if (live_state_name) {
+    COND_PRET_LT0(livestate_start(live_state_name));
+  }
+
+  return 0;
+}
 
+/**
+ * Sets up rendering without a window: the software renderer drawing into
+ * headless_surface.
+ */
+static int
+init_headless(void) {
+  headless_surface = SDL_CreateRGBSurfaceWithFormat(0, WIN_WIDTH, WIN_HEIGHT,
+    32, SDL_PIXELFORMAT_RGBA32);
+  COND_ERET_IF0(headless_surface, -1, SDL_GetError());
+  rend = SDL_CreateSoftwareRenderer(headless_surface);
+  COND_ERET_IF0(rend, -1, SDL_GetError());
+
+  COND_ERET_LT0(TTF_Init(), TTF_GetError());
+  COND_ERET_IF0((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == IMG_INIT_PNG, -1,
+    IMG_GetError());
+  COND_PRET_LT0(init_assets(rend));
+  screen_size.w = WIN_WIDTH;
+  screen_size.h = WIN_HEIGHT;
+  return 0;
+}
+
+/**
+ * Plays replay number export_index of export_file back without a window,
+ * drawing each tick with the software renderer and handing the frames to the
+ * exporter. The output only depends on the replay, never on timing.
+ */
+static int
+export_replay(void) {
+  struct Replay r;
+  int ret = -1;
+
+  COND_PRET_LT0(replay_load(export_file, export_index, &r));
+  COND_PGOTO_LT0(init_headless(), out);
+  COND_PGOTO_LT0(prepare_screen(GAME_SCREEN), out);
+  COND_PGOTO_LT0(export_start(export_format, export_dest, WIN_WIDTH,
+    WIN_HEIGHT), out);
+
+  struct ScreenObject *game = all_screens + GAME_SCREEN;
+  SDL_Texture *bg = get_bg_img();
+  int more;
+  COND_PGOTO_LT0(game_start_replay(&r), finish);
+  while ((more = game_replay_step()) > 0) {
+    COND_EGOTO_LT0(SDL_RenderCopy(rend, bg, 0, 0), finish, SDL_GetError());
+    COND_PGOTO_LT0(game->render(), finish);
+    SDL_RenderPresent(rend);
+
+    Uint8 *pixels = export_acquire_frame();
+    COND_EGOTO_IF0(pixels, finish, "No frame to export into.");
+    COND_EGOTO_LT0(SDL_LockSurface(headless_surface), finish, SDL_GetError());
+    for (int y = 0; y < WIN_HEIGHT; y++) {
+      memcpy(pixels + y*WIN_WIDTH*4,
+        (Uint8 *) headless_surface->pixels + y*headless_surface->pitch,
+        WIN_WIDTH*4);
+    }
+    SDL_UnlockSurface(headless_surface);
+    export_submit_frame();
+  }
+  COND_PGOTO_LT0(more, finish);
+  ret = 0;
+
+finish:
+  if (export_finish() < 0) {
+    ret = -1;
+  }
+out:
+  replay_free(&r);
+  return ret;
+}
+
+/**
+ * Plays the game without a window, feeding it latency_bench_presses
+ * synthetic key presses through the SDL event queue, and logs how long they
+ * took to show up. That's the part of the latency that's up to this program,
+ * without the display's.
+ */
+static int
+latency_bench(void) {
+  static const SDL_Keycode KEYS[] = {SDLK_LEFT, SDLK_UP, SDLK_RIGHT, SDLK_UP};
+  enum {
+    NUM_KEYS = sizeof KEYS/sizeof *KEYS
+  };
+
+  COND_PRET_LT0(init_headless());
+  COND_PRET_LT0(prepare_screen(GAME_SCREEN));
+  latency_enable();
+
+  struct ScreenObject *game = all_screens + GAME_SCREEN;
+  SDL_Texture *bg = get_bg_img();
+  struct LatencyReport r = {0};
+  for (Uint32 frame = 0; r.samples < (Uint32) latency_bench_presses; frame++) {
+    // Game over goes back to the menu. Keep playing instead.
+    if (current != game) {
+      current = game;
+      COND_PRET_LT0(focus_current());
+    }
+    if (frame % BENCH_FRAMES_PER_PRESS == 0) {
+      SDL_Event press = {0};
+      press.type = SDL_KEYDOWN;
+      press.key.timestamp = SDL_GetTicks();
+      press.key.keysym.sym = KEYS[frame/BENCH_FRAMES_PER_PRESS % NUM_KEYS];
+      COND_ERET_LT0(SDL_PushEvent(&press), SDL_GetError());
+    }
+
+    SDL_Event e;
+    while (SDL_PollEvent(&e)) {
+      latency_received(&e);
+      COND_PRET_LT0(current->handle_event(&e));
+      latency_handled();
+    }
+    COND_PRET_LT0(current->update());
+    COND_ERET_LT0(SDL_RenderCopy(rend, bg, 0, 0), SDL_GetError());
+    COND_PRET_LT0(current->render());
+    SDL_RenderPresent(rend);
+    latency_presented();
+    latency_report(&r);
+  }
+  return 0;
+}
+
+/**
+ * Ends a frame for the allocation accounting. It was one of steady gameplay
+ * if it was on the game screen from start to end, past the first few.
+ */
+static int
+end_frame(const struct ScreenObject *frame_screen) {
+  memtrack_enter(MEM_MAIN);
+  game_frames = current == frame_screen
+    && current == all_screens + GAME_SCREEN ? game_frames + 1 : 0;
+  return memtrack_end_frame(game_frames > STEADY_WARMUP_FRAMES);
+}
+
+/**
+ * Least squares line through (x, y) samples, kept as running sums.
+ */
+struct Trend {
+  double n, sx, sxx, sy, sxy;
+};
+
+static void
+trend_add(struct Trend *t, double x, double y) {
+  t->n++;
+  t->sx += x;
+  t->sxx += x*x;
+  t->sy += y;
+  t->sxy += x*y;
+}
+
+static double
+trend_slope(const struct Trend *t) {
+  double d = t->n*t->sxx - t->sx*t->sx;
+  return t->n < 2 || d == 0 ? 0 : (t->n*t->sxy - t->sx*t->sy)/d;
+}
+
+/**
+ * Has the bot play game after game without a window for soak_hours, at
+ * about the frame rate of a display, logging how memory is doing every
+ * SOAK_REPORT_S: what's allocated, and what the process holds on to besides
+ * (allocator overhead and fragmentation, mostly). At the end, it logs how
+ * fast both grew, from the least squares line through those samples. Steady
+ * memory use shows as a growth of about 0.
+ */
+static int
+soak(void) {
+  COND_PRET_LT0(init_headless());
+  COND_PRET_LT0(init_bot());
+  COND_PRET_LT0(prepare_screen(GAME_SCREEN));
+  game_set_autoplay(1);
+
+  struct ScreenObject *game = all_screens + GAME_SCREEN;
+  SDL_Texture *bg = get_bg_img();
+  Uint64 freq = SDL_GetPerformanceFrequency();
+  Uint64 start = SDL_GetPerformanceCounter();
+  Uint64 end = start + (Uint64) (soak_hours*3600*freq);
+  Uint64 next_report = start + SOAK_REPORT_S*freq;
+  struct Trend live = {0}, held = {0};
+  Uint32 games = 0;
+  for (Uint64 now = start; now < end; now = SDL_GetPerformanceCounter()) {
+    // Game over goes back to the menu. Start another game instead.
+    if (current != game) {
+      current = game;
+      COND_PRET_LT0(focus_current());
+      games++;
+    }
+
+    const struct ScreenObject *frame_screen = current;
+    memtrack_enter(MEM_EVENTS);
+    SDL_Event e;
+    while (SDL_PollEvent(&e)) {
+      COND_PRET_LT0(current->handle_event(&e));
+    }
+    memtrack_enter(MEM_UPDATE);
+    COND_PRET_LT0(current->update());
+    memtrack_enter(MEM_RENDER);
+    COND_ERET_LT0(SDL_RenderCopy(rend, bg, 0, 0), SDL_GetError());
+    COND_PRET_LT0(current->render());
+    SDL_RenderPresent(rend);
+    COND_PRET_LT0(end_frame(frame_screen));
+    SDL_Delay(SOAK_FRAME_MS);
+
+    if (now < next_report) {
+      continue;
+    }
+    next_report += SOAK_REPORT_S*freq;
+    struct MemStats s;
+    memtrack_get_stats(&s);
+    Uint64 resident = memtrack_resident();
+    double hours = (double) (now - start)/freq/3600;
+    trend_add(&live, hours, s.total.live_bytes);
+    if (resident) {
+      trend_add(&held, hours, (double) resident - s.total.live_bytes);
+    }
+    SDL_Log("soak: %.1f min, %u games: %.3f MB live in %llu blocks, "
+      "%.1f MB resident; %llu of %llu steady frames allocated", hours*60,
+      games, s.total.live_bytes/1e6, (unsigned long long) s.total.live_blocks,
+      resident/1e6, (unsigned long long) s.steady_allocating,
+      (unsigned long long) s.steady_frames);
+  }
+  SDL_Log("soak: %u games in %.2f h. Live memory grew %+.1f KB/h, resident "
+    "memory besides it %+.1f KB/h (%.0f samples).", games, soak_hours,
+    trend_slope(&live)/1e3, trend_slope(&held)/1e3, live.n);
   return 0;
 }
 
@@ -73,21 +468,66 @@ static int
 game_loop(void) {
   SDL_assert(current);
   play_new();
-  COND_PRET_LT0(current->focus());
+  COND_PRET_LT0(focus_current());
   SDL_Texture *bg = get_bg_img();
 
+  int idle = 0;
+  // Window events (exposed, restored, ...) may have wiped what was shown.
+  int redraw = 1;
+
   for (;;) {
+    const struct ScreenObject *frame_screen = current;
+    memtrack_enter(MEM_EVENTS);
     SDL_Event e;
-    while (SDL_PollEvent(&e)) {
+    int num_events = 0;
+    int have_event = idle ? SDL_WaitEventTimeout(&e, IDLE_WAIT_MS)
+      : SDL_PollEvent(&e);
+    for (; have_event; have_event = SDL_PollEvent(&e)) {
       if (e.type == SDL_QUIT) {
+        if (current == all_screens + GAME_SCREEN) {
+          COND_PRET_LT0(game_suspend());
+        }
         return 0;
       }
+      if (e.type == SDL_WINDOWEVENT) {
+        redraw = 1;
+        if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+          update_scale();
+        }
+      }
+      latency_received(&e);
       COND_PRET_LT0(current->handle_event(&e));
+      latency_handled();
+      num_events++;
     }
+    memtrack_enter(MEM_UPDATE);
     COND_PRET_LT0(current->update());
-    COND_ERET_LT0(SDL_RenderCopy(rend, bg, 0, 0), SDL_GetError());
-    COND_PRET_LT0(current->render());
-    SDL_RenderPresent(rend);
+    // Text rasterized again for a new window size shows up as it's ready.
+    int rescaling = text_cache_update();
+    if (rescaling) {
+      redraw = 1;
+      game_frames = 0;
+    }
+
+    int dirty = !current->is_dirty || current->is_dirty();
+    if (dirty || redraw) {
+      memtrack_enter(MEM_RENDER);
+      COND_ERET_LT0(SDL_RenderCopy(rend, bg, 0, 0), SDL_GetError());
+      COND_PRET_LT0(current->render());
+      SDL_RenderPresent(rend);
+      latency_presented();
+      redraw = 0;
+    }
+
+    COND_PRET_LT0(end_frame(frame_screen));
+
+    int prewarmed = 0;
+    if (!num_events && current == all_screens + MENU_SCREEN) {
+      prewarmed = prewarm_screen();
+      COND_PRET_LT0(prewarmed);
+    }
+    idle = !prewarmed && !rescaling && current->is_dirty
+      && !current->is_dirty();
   }
 
   return 0;
@@ -130,16 +570,33 @@ report_error(void) {
 
 static void
 cleanup(void) {
+  latency_log();
+  spectate_stop();
+  livestate_stop();
+  destroy_stats();
+  destroy_bot();
+  destroy_pc_assist();
+  destroy_sfx();
+  destroy_music();
   for (int i = 0; i < NUM_SCREENS; i++) {
     if (all_screens[i].destroy) {
       all_screens[i].destroy();
     }
   }
+  destroy_text_cache();
   xSDL_DestroyRenderer(&rend);
   xSDL_DestroyWindow(&window);
+  if (headless_surface) {
+    SDL_FreeSurface(headless_surface);
+    headless_surface = 0;
+  }
   TTF_Quit();
   IMG_Quit();
   SDL_Quit();
+  // Whatever is still live by now leaked.
+  if (memtrack_installed()) {
+    memtrack_log();
+  }
 }
 
 static void
@@ -164,22 +621,136 @@ change_screen(const enum ScreenId which) {
   const int screen_i = (int) which;
   SDL_assert(screen_i >= 0);
   SDL_assert(screen_i < NUM_SCREENS);
+  COND_PGOTO_LT0(prepare_screen(which), err);
   current = all_screens + screen_i;
   if (which == GAME_SCREEN) {
     play_new();
   }
-  COND_PGOTO_LT0(current->focus(), err);
+  COND_PGOTO_LT0(focus_current(), err);
   return;
 
 err:
   error_quit();
 }
 
+static int
+parse_args(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--spectate") && i+1 < argc) {
+      spectate_port = atoi(argv[++i]);
+      COND_ERET(spectate_port <= 0 || spectate_port > 65535, -1,
+        "--spectate expects a port number.");
+    }
+    else if (!strcmp(argv[i], "--live-state") && i+1 < argc) {
+      live_state_name = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--watch") && i+2 < argc) {
+      watch_port = atoi(argv[++i]);
+      watch_count = atoi(argv[++i]);
+      COND_ERET(watch_port <= 0 || watch_count <= 0
+        || watch_port + watch_count > 65536, -1,
+        "--watch expects a first port and how many ports to watch.");
+    }
+    else if (!strcmp(argv[i], "--export") && i+4 < argc) {
+      export_file = argv[++i];
+      export_index = atoi(argv[++i]);
+      const char *format = argv[++i];
+      export_dest = argv[++i];
+      if (!strcmp(format, "raw")) {
+        export_format = EXPORT_RAW;
+      }
+      else if (!strcmp(format, "png")) {
+        export_format = EXPORT_PNG;
+      }
+      else if (!strcmp(format, "pipe")) {
+        export_format = EXPORT_PIPE;
+      }
+      else {
+        COND_ERET(1, -1, "--export formats are raw, png and pipe.");
+      }
+    }
+    else if (!strcmp(argv[i], "--audio-buffer") && i+1 < argc) {
+      audio_buffer = atoi(argv[++i]);
+      COND_ERET(audio_buffer < 64 || audio_buffer > 8192
+        || (audio_buffer & (audio_buffer - 1)), -1,
+        "--audio-buffer expects frames per buffer, a power of 2 from 64 to "
+        "8192.");
+    }
+    else if (!strcmp(argv[i], "--smooth")) {
+      smooth_option = 1;
+    }
+    else if (!strcmp(argv[i], "--no-smooth")) {
+      smooth_option = 0;
+    }
+    else if (!strcmp(argv[i], "--latency")) {
+      latency_probe = 1;
+    }
+    else if (!strcmp(argv[i], "--latency-bench") && i+1 < argc) {
+      latency_bench_presses = atoi(argv[++i]);
+      COND_ERET(latency_bench_presses <= 0, -1,
+        "--latency-bench expects how many key presses to send.");
+    }
+    else if (!strcmp(argv[i], "--mem-track")) {
+      mem_track = 1;
+    }
+    else if (!strcmp(argv[i], "--mem-strict")) {
+      mem_track = mem_strict = 1;
+    }
+    else if (!strcmp(argv[i], "--soak") && i+1 < argc) {
+      soak_hours = atof(argv[++i]);
+      COND_ERET(soak_hours <= 0, -1,
+        "--soak expects how many hours to play for.");
+      mem_track = 1;
+    }
+    else if (!strcmp(argv[i], "--hint") && i+2 < argc) {
+      int budget_us = atoi(argv[++i]);
+      int depth = atoi(argv[++i]);
+      COND_ERET(budget_us <= 0 || depth <= 0 || depth > BOT_MAX_DEPTH, -1,
+        "--hint expects a time budget per frame in microseconds and a "
+        "search depth (1 to 3).");
+      bot_configure(budget_us, depth);
+    }
+    else {
+      COND_ERET(1, -1,
+        "Usage: main [--spectate PORT] [--live-state NAME] "
+        "[--watch FIRST_PORT COUNT] "
+        "[--export REPLAY_FILE INDEX raw|png|pipe DEST] [--latency] "
+        "[--latency-bench PRESSES] [--hint BUDGET_US DEPTH] "
+        "[--smooth|--no-smooth] [--audio-buffer FRAMES] "
+        "[--mem-track] [--mem-strict] [--soak HOURS]");
+    }
+  }
+  return 0;
+}
+
 int
 main(int argc, char *argv[]) {
-  (void) argc;
-  (void) argv;
-
+  COND_PGOTO_LT0(parse_args(argc, argv), err);
+  if (mem_track) {
+    COND_PGOTO_LT0(memtrack_install(), err);
+    memtrack_set_strict(mem_strict);
+  }
+  if (soak_hours > 0) {
+    COND_EGOTO_LT0(SDL_Init(SDL_INIT_EVENTS), err, SDL_GetError());
+    COND_PGOTO_LT0(soak(), err);
+    cleanup();
+    return 0;
+  }
+  if (export_file) {
+    COND_EGOTO_LT0(SDL_Init(0), err, SDL_GetError());
+    COND_PGOTO_LT0(export_replay(), err);
+    cleanup();
+    return 0;
+  }
+  if (latency_bench_presses) {
+    COND_EGOTO_LT0(SDL_Init(SDL_INIT_EVENTS), err, SDL_GetError());
+    COND_PGOTO_LT0(latency_bench(), err);
+    cleanup();
+    return 0;
+  }
+  if (latency_probe) {
+    latency_enable();
+  }
   COND_PGOTO_LT0(init(), err);
   COND_PGOTO_LT0(game_loop(), err);
   cleanup();
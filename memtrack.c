@@ -0,0 +1,290 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "memtrack.h"
+
+static const char *const SUBSYSTEM_NAMES[NUM_MEM_SUBSYSTEMS] = {
+  [MEM_MAIN] = "main",
+  [MEM_EVENTS] = "events",
+  [MEM_UPDATE] = "update",
+  [MEM_RENDER] = "render",
+  [MEM_THREADS] = "threads",
+  [MEM_ERRORS] = "errors",
+  [MEM_TTABLE] = "ttable"
+};
+
+/*
+ * Every block starts with this, so freeing it knows how big it was and whose
+ * it was. The union keeps what comes after it aligned for anything.
+ */
+union BlockHeader {
+  struct {
+    size_t size;
+    Uint8 subsystem;
+  } info;
+  long double align_;
+  void *align_ptr_;
+};
+
+enum {
+  HEADER_SIZE = sizeof (union BlockHeader)
+};
+
+// What SDL used before the hooks, which do the actual allocating. They're
+// the C library's unless SDL was built with something else.
+static SDL_malloc_func real_malloc = malloc;
+static SDL_calloc_func real_calloc = calloc;
+static SDL_realloc_func real_realloc = realloc;
+static SDL_free_func real_free = free;
+static int installed;
+
+static SDL_threadID main_thread;
+// Only the main thread reads or writes it.
+static enum MemSubsystem main_subsystem = MEM_MAIN;
+
+// Guards everything below. Allocations come from any thread, and they're
+// short enough for a spin lock.
+static SDL_SpinLock lock;
+static struct MemCounts counts[NUM_MEM_SUBSYSTEMS], total;
+// What the main thread allocated during the frame so far, by subsystem, and
+// what every other thread did.
+static Uint64 frame_allocs[NUM_MEM_SUBSYSTEMS], frame_thread_allocs;
+static Uint64 frames, steady_frames, steady_allocating, max_frame_allocs;
+static Uint64 steady_thread_allocs;
+static int strict;
+
+static void
+add(struct MemCounts *c, size_t size) {
+  c->allocs++;
+  c->bytes += size;
+  c->live_bytes += size;
+  c->live_blocks++;
+  if (c->live_bytes > c->peak_bytes) {
+    c->peak_bytes = c->live_bytes;
+  }
+}
+
+static void
+take(struct MemCounts *c, size_t size) {
+  c->frees++;
+  c->live_bytes -= size;
+  c->live_blocks--;
+}
+
+static void
+count_alloc(enum MemSubsystem s, size_t size) {
+  int on_main = SDL_ThreadID() == main_thread;
+  SDL_AtomicLock(&lock);
+  add(counts + s, size);
+  add(&total, size);
+  if (on_main) {
+    frame_allocs[s]++;
+  }
+  else {
+    frame_thread_allocs++;
+  }
+  SDL_AtomicUnlock(&lock);
+}
+
+static void
+count_free(enum MemSubsystem s, size_t size) {
+  SDL_AtomicLock(&lock);
+  take(counts + s, size);
+  take(&total, size);
+  SDL_AtomicUnlock(&lock);
+}
+
+static enum MemSubsystem
+current_subsystem(void) {
+  return SDL_ThreadID() == main_thread ? main_subsystem : MEM_THREADS;
+}
+
+static void*
+alloc(enum MemSubsystem s, size_t n, size_t size, int zero) {
+  if (size && n > ((size_t) -1 - HEADER_SIZE)/size) {
+    return 0;
+  }
+  size *= n;
+  union BlockHeader *h = zero ? real_calloc(1, HEADER_SIZE + size)
+    : real_malloc(HEADER_SIZE + size);
+  if (!h) {
+    return 0;
+  }
+  h->info.size = size;
+  h->info.subsystem = s;
+  count_alloc(s, size);
+  return h + 1;
+}
+
+static void* SDLCALL
+hook_malloc(size_t size) {
+  return alloc(current_subsystem(), 1, size, 0);
+}
+
+static void* SDLCALL
+hook_calloc(size_t n, size_t size) {
+  return alloc(current_subsystem(), n, size, 1);
+}
+
+static void* SDLCALL
+hook_realloc(void *p, size_t size) {
+  if (!p) {
+    return hook_malloc(size);
+  }
+  if (size > (size_t) -1 - HEADER_SIZE) {
+    return 0;
+  }
+  union BlockHeader *h = (union BlockHeader *) p - 1;
+  size_t old_size = h->info.size;
+  enum MemSubsystem old = h->info.subsystem;
+  h = real_realloc(h, HEADER_SIZE + size);
+  if (!h) {
+    return 0;
+  }
+  // Counted as freeing the old block and allocating a new one, since that's
+  // what it may well have done.
+  enum MemSubsystem s = current_subsystem();
+  h->info.size = size;
+  h->info.subsystem = s;
+  count_free(old, old_size);
+  count_alloc(s, size);
+  return h + 1;
+}
+
+static void SDLCALL
+hook_free(void *p) {
+  if (p) {
+    union BlockHeader *h = (union BlockHeader *) p - 1;
+    count_free(h->info.subsystem, h->info.size);
+    real_free(h);
+  }
+}
+
+int
+memtrack_install(void) {
+  SDL_assert(!installed);
+  main_thread = SDL_ThreadID();
+  SDL_GetMemoryFunctions(&real_malloc, &real_calloc, &real_realloc,
+    &real_free);
+  COND_ERET_LT0(SDL_SetMemoryFunctions(hook_malloc, hook_calloc,
+    hook_realloc, hook_free), SDL_GetError());
+  installed = 1;
+  return 0;
+}
+
+int
+memtrack_installed(void) {
+  return installed;
+}
+
+enum MemSubsystem
+memtrack_enter(enum MemSubsystem s) {
+  enum MemSubsystem old = main_subsystem;
+  main_subsystem = s;
+  return old;
+}
+
+void*
+memtrack_malloc(enum MemSubsystem s, size_t size) {
+  return alloc(s, 1, size, 0);
+}
+
+void
+memtrack_free(void *p) {
+  hook_free(p);
+}
+
+void
+memtrack_set_strict(int on) {
+  strict = on;
+}
+
+int
+memtrack_end_frame(int steady) {
+  Uint64 n = 0;
+  int worst = 0;
+  SDL_AtomicLock(&lock);
+  for (int i = 0; i < NUM_MEM_SUBSYSTEMS; i++) {
+    n += frame_allocs[i];
+    if (frame_allocs[i] > frame_allocs[worst]) {
+      worst = i;
+    }
+  }
+  SDL_memset(frame_allocs, 0, sizeof frame_allocs);
+  if (steady) {
+    steady_thread_allocs += frame_thread_allocs;
+  }
+  frame_thread_allocs = 0;
+  frames++;
+  steady_frames += steady != 0;
+  steady_allocating += steady && n;
+  if (n > max_frame_allocs) {
+    max_frame_allocs = n;
+  }
+  SDL_AtomicUnlock(&lock);
+
+  if (strict && steady && n) {
+    char msg[100];
+    snprintf(msg, sizeof msg, "A frame of steady gameplay allocated %llu "
+      "times (mostly %s).", (unsigned long long) n, SUBSYSTEM_NAMES[worst]);
+    COND_ERET(1, -1, msg);
+  }
+  return 0;
+}
+
+void
+memtrack_get_stats(struct MemStats *stats) {
+  SDL_AtomicLock(&lock);
+  SDL_memcpy(stats->subsystems, counts, sizeof counts);
+  stats->total = total;
+  stats->frames = frames;
+  stats->steady_frames = steady_frames;
+  stats->steady_allocating = steady_allocating;
+  stats->max_frame_allocs = max_frame_allocs;
+  stats->steady_thread_allocs = steady_thread_allocs;
+  SDL_AtomicUnlock(&lock);
+}
+
+Uint64
+memtrack_resident(void) {
+#ifdef __linux__
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f) {
+    return 0;
+  }
+  unsigned long size, resident;
+  int got = fscanf(f, "%lu %lu", &size, &resident);
+  fclose(f);
+  return got == 2 ? (Uint64) resident*sysconf(_SC_PAGESIZE) : 0;
+#else
+  return 0;
+#endif
+}
+
+void
+memtrack_log(void) {
+  struct MemStats s;
+  memtrack_get_stats(&s);
+  for (int i = 0; i <= NUM_MEM_SUBSYSTEMS; i++) {
+    const struct MemCounts *c = i < NUM_MEM_SUBSYSTEMS ? s.subsystems + i
+      : &s.total;
+    SDL_Log("mem: %-7s %8llu allocs %8llu frees, %.1f MB allocated, "
+      "%.3f MB live in %llu blocks, %.3f MB at most",
+      i < NUM_MEM_SUBSYSTEMS ? SUBSYSTEM_NAMES[i] : "total",
+      (unsigned long long) c->allocs, (unsigned long long) c->frees,
+      c->bytes/1e6, c->live_bytes/1e6, (unsigned long long) c->live_blocks,
+      c->peak_bytes/1e6);
+  }
+  SDL_Log("mem: %llu frames, at most %llu allocs in one; %llu of %llu "
+    "steady frames allocated, other threads %llu times during them",
+    (unsigned long long) s.frames, (unsigned long long) s.max_frame_allocs,
+    (unsigned long long) s.steady_allocating,
+    (unsigned long long) s.steady_frames,
+    (unsigned long long) s.steady_thread_allocs);
+}
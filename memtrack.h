@@ -0,0 +1,117 @@
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+/*
+ * Allocation accounting. Once memtrack_install hooks SDL's memory functions,
+ * everything allocated through SDL_malloc (SDL, SDL_ttf, SDL_image,
+ * SDL_mixer and this program's own SDL_malloc calls) is counted, and so is
+ * everything allocated through memtrack_malloc, hooked or not.
+ *
+ * Allocations are counted by subsystem. The ones made through
+ * memtrack_malloc say which one they're for. The ones made through SDL go
+ * to whatever the main thread said it's doing (memtrack_enter), or to
+ * MEM_THREADS when another thread makes them.
+ *
+ * The game loop calls memtrack_end_frame once per frame. In strict mode,
+ * that fails if the main thread allocated anything during a frame of steady
+ * gameplay, where it shouldn't. Other threads (the music decoder opening
+ * its next track, say) are allowed to, and are counted apart.
+ */
+
+enum MemSubsystem {
+  // Main thread, outside of the frame loop: starting up, screens getting
+  // initialized or focused, shutting down.
+  MEM_MAIN,
+  MEM_EVENTS,
+  MEM_UPDATE,
+  MEM_RENDER,
+  // Any thread but the main one: the simulation, music decoding, jobs...
+  MEM_THREADS,
+  MEM_ERRORS,
+  MEM_TTABLE,
+  NUM_MEM_SUBSYSTEMS
+};
+
+struct MemCounts {
+  Uint64 allocs, frees;
+  // Allocated in total, still allocated (in how many blocks), and the most
+  // that was ever allocated at once.
+  Uint64 bytes, live_bytes, live_blocks, peak_bytes;
+};
+
+struct MemStats {
+  struct MemCounts subsystems[NUM_MEM_SUBSYSTEMS];
+  struct MemCounts total;
+  Uint64 frames;
+  // Frames of steady gameplay, and how many of them the main thread
+  // allocated anything in.
+  Uint64 steady_frames, steady_allocating;
+  // Most allocations the main thread made in a single frame.
+  Uint64 max_frame_allocs;
+  // Allocations other threads made during steady frames.
+  Uint64 steady_thread_allocs;
+};
+
+/**
+ * Hooks SDL's memory functions. Has to come before anything else calls into
+ * SDL, since what was allocated before can't be freed through the hooks.
+ */
+int
+memtrack_install(void);
+
+int
+memtrack_installed(void);
+
+/**
+ * Says what the main thread is doing, for the allocations SDL makes on it
+ * from now on. Returns what it was doing before. Only for the main thread.
+ */
+enum MemSubsystem
+memtrack_enter(enum MemSubsystem s);
+
+/**
+ * malloc and free that count what they do under subsystem s. Blocks from
+ * memtrack_malloc must be freed with memtrack_free, and nothing else.
+ */
+void*
+memtrack_malloc(enum MemSubsystem s, size_t size);
+
+void
+memtrack_free(void *p);
+
+/**
+ * Strict mode makes memtrack_end_frame fail on steady frames that allocate.
+ */
+void
+memtrack_set_strict(int on);
+
+/**
+ * Ends a frame. steady tells whether it was one of steady gameplay. Returns
+ * -1 in strict mode if it was and the main thread allocated anything during
+ * it.
+ */
+int
+memtrack_end_frame(int steady);
+
+void
+memtrack_get_stats(struct MemStats *stats);
+
+/**
+ * Resident set size of the process, in bytes, or 0 if the system doesn't
+ * tell. Compared with what's allocated, it shows how much the allocator
+ * holds on to that nothing uses: fragmentation, mostly.
+ */
+Uint64
+memtrack_resident(void);
+
+/**
+ * Logs the counts of every subsystem.
+ */
+void
+memtrack_log(void);
+
+#endif
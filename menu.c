@@ -17,6 +17,8 @@ enum {
 static struct Dim2D screen_dim;
 static struct TextImage title, new_game, scores;
 static SDL_Renderer *g_rend;
+// Nothing here changes by itself, so only focusing needs a redraw.
+static int dirty;
 
 static void
 destroy(void) {
@@ -47,14 +49,21 @@ update(void) {
 
 static int
 focus(void) {
+  dirty = 1;
   return 0;
 }
 
+static int
+is_dirty(void) {
+  return dirty;
+}
+
 static int
 render(void) {
   COND_PRET_LT0(render_text_image(&title));
   COND_PRET_LT0(render_text_image(&new_game));
   COND_PRET_LT0(render_text_image(&scores));
+  dirty = 0;
   return 0;
 }
 
@@ -90,7 +99,8 @@ init_menu(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_) {
     .handle_event = handle_event,
     .update = update,
     .render = render,
-    .focus = focus
+    .focus = focus,
+    .is_dirty = is_dirty
   };
   register_screen(MENU_SCREEN, &self);
 
@@ -0,0 +1,184 @@
+#include <SDL2/SDL.h>
+
+#include "xSDL.h"
+#include "error.h"
+#include "assets.h"
+#include "screens.h"
+#include "board.h"
+#include "delta.h"
+#include "multiview.h"
+
+enum {
+  // Below this many pixels per block, the block texture is just noise.
+  MIN_TEXTURED_BLOCK_PX = 8,
+
+  // Space between boards, in blocks.
+  BOARD_GAP_BLOCKS = 1,
+
+  // Every cell of every board, plus every falling piece (which, on a feed
+  // that makes sense, only ever covers empty cells).
+  MAX_QUADS = MAX_BOARDS*(PANEL_ROWS*PANEL_COLS + NUM_PIECE_PARTS),
+  VERTS_PER_QUAD = 4,
+  INDICES_PER_QUAD = 6
+};
+
+static const SDL_Color BOARD_BG_COLOR = {0, 0, 0, 255};
+static const SDL_Color BOARD_BORDER_COLOR = {255, 255, 255, 255};
+
+static SDL_Renderer *g_rend;
+static SDL_Texture *block;
+
+// Layout, as computed by layout_multiview.
+static int laid_out_boards;
+static int block_px;
+static SDL_Rect board_rects[MAX_BOARDS];
+
+// Batch storage. The indices never change, so they're filled once.
+static SDL_Vertex verts[MAX_QUADS*VERTS_PER_QUAD];
+static int indices[MAX_QUADS*INDICES_PER_QUAD];
+
+static Uint64 render_ticks;
+static Uint32 frames;
+
+int
+init_multiview(SDL_Renderer *rend) {
+  g_rend = rend;
+  block = get_tetris_block_img();
+
+  for (int q = 0; q < MAX_QUADS; q++) {
+    int *idx = indices + q*INDICES_PER_QUAD;
+    int v = q*VERTS_PER_QUAD;
+    idx[0] = v;
+    idx[1] = v + 1;
+    idx[2] = v + 2;
+    idx[3] = v;
+    idx[4] = v + 2;
+    idx[5] = v + 3;
+  }
+  return 0;
+}
+
+void
+layout_multiview(int num_boards, const SDL_Rect *area) {
+  SDL_assert(num_boards > 0 && num_boards <= MAX_BOARDS);
+
+  // Try every column count and keep the one giving the biggest blocks.
+  const int board_w = PANEL_COLS + BOARD_GAP_BLOCKS;
+  const int board_h = PANEL_ROWS + BOARD_GAP_BLOCKS;
+  int best_cols = 1;
+  int best_px = 0;
+  for (int cols = 1; cols <= num_boards; cols++) {
+    int rows = (num_boards + cols - 1)/cols;
+    int px = SDL_min(area->w/(cols*board_w), area->h/(rows*board_h));
+    if (px > best_px) {
+      best_px = px;
+      best_cols = cols;
+    }
+  }
+
+  block_px = SDL_max(best_px, 1);
+  laid_out_boards = num_boards;
+
+  const int rows = (num_boards + best_cols - 1)/best_cols;
+  const int cell_w = block_px*board_w;
+  const int cell_h = block_px*board_h;
+  const int offset_x = area->x + (area->w - best_cols*cell_w)/2;
+  const int offset_y = area->y + (area->h - rows*cell_h)/2;
+
+  for (int i = 0; i < num_boards; i++) {
+    board_rects[i] = (SDL_Rect) {
+      .x = offset_x + (i%best_cols)*cell_w + block_px*BOARD_GAP_BLOCKS/2,
+      .y = offset_y + (i/best_cols)*cell_h + block_px*BOARD_GAP_BLOCKS/2,
+      .w = block_px*PANEL_COLS,
+      .h = block_px*PANEL_ROWS
+    };
+  }
+}
+
+/**
+ * Adds a block of the given kind to the batch, unless the batch is full or
+ * the kind isn't one (the boards come from the network).
+ */
+static void
+put_quad(int *quads, const SDL_Rect *board, int cell, Uint8 kind) {
+  if (*quads >= MAX_QUADS || kind < 1 || kind > NUM_DIFFERENT_PIECES) {
+    return;
+  }
+  SDL_Vertex *v = verts + *quads*VERTS_PER_QUAD;
+  (*quads)++;
+
+  // Remembering that rows grow from bottom -> up.
+  const float x0 = board->x + (cell%PANEL_COLS)*block_px;
+  const float y0 = board->y + (PANEL_ROWS - 1 - cell/PANEL_COLS)*block_px;
+  const float x1 = x0 + block_px;
+  const float y1 = y0 + block_px;
+  const SDL_Color c = PIECE_COLORS[kind - 1];
+
+  v[0] = (SDL_Vertex) {{x0, y0}, c, {0, 0}};
+  v[1] = (SDL_Vertex) {{x1, y0}, c, {1, 0}};
+  v[2] = (SDL_Vertex) {{x1, y1}, c, {1, 1}};
+  v[3] = (SDL_Vertex) {{x0, y1}, c, {0, 1}};
+}
+
+static int
+batch_blocks(const struct DeltaBoard *boards, int num_boards) {
+  int quads = 0;
+  for (int b = 0; b < num_boards; b++) {
+    const struct DeltaBoard *board = boards + b;
+    const Uint8 *cells = &board->cells[0][0];
+    for (int c = 0; c < PANEL_ROWS*PANEL_COLS; c++) {
+      if (cells[c]) {
+        put_quad(&quads, board_rects + b, c, cells[c]);
+      }
+    }
+    if (board->piece_kind) {
+      for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+        if (board->piece[i] < PANEL_ROWS*PANEL_COLS) {
+          put_quad(&quads, board_rects + b, board->piece[i],
+            board->piece_kind);
+        }
+      }
+    }
+  }
+  return quads;
+}
+
+int
+render_multiview(const struct DeltaBoard *boards, int num_boards) {
+  SDL_assert(num_boards <= laid_out_boards);
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  COND_ERET_LT0(xSDL_SetRenderDrawColor(g_rend, &BOARD_BG_COLOR),
+    SDL_GetError());
+  COND_ERET_LT0(SDL_RenderFillRects(g_rend, board_rects, num_boards),
+    SDL_GetError());
+
+  int quads = batch_blocks(boards, num_boards);
+  if (quads > 0) {
+    SDL_Texture *tex = block_px >= MIN_TEXTURED_BLOCK_PX ? block : 0;
+    COND_ERET_LT0(SDL_RenderGeometry(g_rend, tex, verts,
+      quads*VERTS_PER_QUAD, indices, quads*INDICES_PER_QUAD),
+      SDL_GetError());
+  }
+
+  COND_ERET_LT0(xSDL_SetRenderDrawColor(g_rend, &BOARD_BORDER_COLOR),
+    SDL_GetError());
+  COND_ERET_LT0(SDL_RenderDrawRects(g_rend, board_rects, num_boards),
+    SDL_GetError());
+
+  render_ticks += SDL_GetPerformanceCounter() - start;
+  frames++;
+  return 0;
+}
+
+void
+destroy_multiview(void) {
+  if (frames > 0) {
+    SDL_Log("multiview: %u frames, %.1f us per frame submitting %d boards",
+      (unsigned) frames,
+      1e6*render_ticks/SDL_GetPerformanceFrequency()/frames,
+      laid_out_boards);
+  }
+  frames = 0;
+  render_ticks = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include <SDL2/SDL.h>
+
+#include "delta.h"
+
+/*
+ * Draws many boards on one screen (for tournament displays). All blocks of
+ * all boards go to the renderer in a single SDL_RenderGeometry call that
+ * shares the block texture. When blocks get too small for the texture to
+ * show, they're drawn as flat colored quads instead.
+ */
+
+enum {
+  MAX_BOARDS = 64
+};
+
+int
+init_multiview(SDL_Renderer *rend);
+
+/**
+ * Arranges num_boards boards in a grid filling *area. Only needs to be called
+ * again if either changes.
+ */
+void
+layout_multiview(int num_boards, const SDL_Rect *area);
+
+int
+render_multiview(const struct DeltaBoard *boards, int num_boards);
+
+void
+destroy_multiview(void);
+
+#endif
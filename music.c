@@ -1,24 +1,384 @@
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 
 #include "xSDL.h"
 #include "error.h"
+#include "assets.h"
+#include "bytes.h"
 #include "music.h"
+#include "ring.h"
+
+/*
+ * The music is a playlist: music1.wav up to musicN.wav (N is NUM_SONGS),
+ * whichever of them are there. A decoder thread reads them a block at a
+ * time, converts the samples to the device's format and queues them on a
+ * ring the audio thread plays from (through Mix_HookMusic). Each track goes
+ * straight into the next one, with no gap. When a new game starts or the
+ * level calls for another track, the decoder crossfades into it. However
+ * long the tracks are, the memory used is the ring and a read buffer, and
+ * opening them happens on the decoder thread, never on a frame.
+ *
+ * Without any of those files, music.flac loops through SDL_mixer instead.
+ */
+
+enum {
+  // Samples (not frames) queued for the audio thread: about 370 ms of 44.1
+  // kHz stereo. Must be a power of 2.
+  RING_SAMPLES = 1 << 15,
+
+  // Most samples the decoder makes at a time.
+  BLOCK_SAMPLES = 2048,
+
+  // Most bytes read from a track at a time.
+  READ_BYTES = 8192,
+
+  CROSSFADE_MS = 1500,
+
+  // Levels each track is for: levels 0 to 2 get the first one, and so on.
+  LEVELS_PER_TRACK = 3,
+
+  // Out of MIX_MAX_VOLUME.
+  VOLUME = 30,
+
+  MAX_PATH = 32
+};
+
+struct Track {
+  SDL_RWops *file;
+  SDL_AudioStream *conv;
+  // Bytes of samples left in the file, and how many make a frame.
+  Uint32 data_left;
+  int frame_size;
+  int index;
+};
 
 static Mix_Music *music;
 
+static char paths[NUM_SONGS][MAX_PATH];
+static int num_tracks;
+static int freq, channels;
+
+// Samples from the decoder (producer) to the audio thread (consumer).
+static Sint16 samples[RING_SAMPLES];
+static struct Ring ring = {.size = RING_SAMPLES};
+// Posted by the audio thread whenever it took samples off the ring.
+static SDL_sem *room;
+
+static SDL_Thread *decoder;
+static SDL_atomic_t running;
+// What play_new and music_set_level ask for: the track to go to, and how
+// many times to start over.
+static SDL_atomic_t wanted_track, restarts;
+// Set while the decoder has something to play, so an empty ring means the
+// audio thread ran out.
+static SDL_atomic_t playing;
+static Uint32 underruns;
+
+// Decoder side: the track playing and, during a crossfade, the one coming
+// in, fade_frames into it.
+static struct Track current, incoming;
+static int fade_frames;
+// BLOCK_SAMPLES rounded down to whole frames, which is all the converters
+// hand out.
+static int block_samples;
+static Uint8 read_buf[READ_BYTES];
+static Sint16 block[BLOCK_SAMPLES], incoming_block[BLOCK_SAMPLES];
+
+/**
+ * SDL audio format of WAV samples, or 0 if they're a kind it can't
+ * convert.
+ */
+static Uint16
+wav_format(int tag, int bits) {
+  // PCM, or WAVE_FORMAT_EXTENSIBLE (assumed to be PCM too).
+  if (tag == 1 || tag == 0xFFFE) {
+    switch (bits) {
+      case 8:
+        return AUDIO_U8;
+      case 16:
+        return AUDIO_S16LSB;
+      case 32:
+        return AUDIO_S32LSB;
+    }
+  }
+  // IEEE float.
+  if (tag == 3 && bits == 32) {
+    return AUDIO_F32LSB;
+  }
+  return 0;
+}
+
+static void
+close_track(struct Track *t) {
+  if (t->file) {
+    SDL_RWclose(t->file);
+  }
+  if (t->conv) {
+    SDL_FreeAudioStream(t->conv);
+  }
+  SDL_zerop(t);
+}
+
+/**
+ * Opens track i and reads its header, leaving the file at its samples.
+ * Returns -1 if it's not there or not a WAV file it can play.
+ */
+static int
+open_track(struct Track *t, int i) {
+  SDL_zerop(t);
+  t->index = i;
+  t->file = SDL_RWFromFile(paths[i], "rb");
+  if (!t->file) {
+    goto fail;
+  }
+  Uint8 header[12];
+  if (SDL_RWread(t->file, header, sizeof header, 1) != 1
+      || SDL_memcmp(header, "RIFF", 4) || SDL_memcmp(header + 8, "WAVE", 4))
+  {
+    goto fail;
+  }
+
+  Uint16 format = 0;
+  int src_channels = 0, src_freq = 0;
+  for (;;) {
+    Uint8 chunk[8];
+    if (SDL_RWread(t->file, chunk, sizeof chunk, 1) != 1) {
+      goto fail;
+    }
+    Uint32 size = get_u32(chunk + 4);
+    if (!SDL_memcmp(chunk, "data", 4)) {
+      t->data_left = size;
+      break;
+    }
+    Sint64 skip = size + (size & 1);
+    if (!SDL_memcmp(chunk, "fmt ", 4)) {
+      Uint8 fmt[16];
+      if (size < sizeof fmt || SDL_RWread(t->file, fmt, sizeof fmt, 1) != 1) {
+        goto fail;
+      }
+      src_channels = get_u16(fmt + 2);
+      src_freq = get_u32(fmt + 4);
+      format = wav_format(get_u16(fmt), get_u16(fmt + 14));
+      t->frame_size = src_channels*(get_u16(fmt + 14)/8);
+      skip -= sizeof fmt;
+    }
+    if (SDL_RWseek(t->file, skip, RW_SEEK_CUR) < 0) {
+      goto fail;
+    }
+  }
+  if (!format || src_channels <= 0 || src_freq <= 0) {
+    goto fail;
+  }
+  // SDL_AudioStreamPut only takes whole frames.
+  t->data_left -= t->data_left % t->frame_size;
+
+  t->conv = SDL_NewAudioStream(format, src_channels, src_freq, AUDIO_S16SYS,
+    channels, freq);
+  if (!t->conv) {
+    goto fail;
+  }
+  return 0;
+
+fail:
+  // This runs on the decoder thread, which can't touch the error stack.
+  SDL_Log("music: can't play %s", paths[i]);
+  close_track(t);
+  return -1;
+}
+
+/**
+ * Decodes up to n samples of t into out. Fewer means the track is over.
+ */
+static int
+read_track(struct Track *t, Sint16 *out, int n) {
+  int bytes = n*sizeof *out;
+  const Uint32 max_read = READ_BYTES - READ_BYTES % t->frame_size;
+  while (t->file && SDL_AudioStreamAvailable(t->conv) < bytes) {
+    Uint32 want = SDL_min(t->data_left, max_read);
+    size_t got = want ? SDL_RWread(t->file, read_buf, 1, want) : 0;
+    got -= got % t->frame_size;
+    if (got > 0) {
+      SDL_AudioStreamPut(t->conv, read_buf, (int) got);
+      t->data_left -= got;
+    }
+    if (!got || !t->data_left) {
+      // What's left in the converter comes out now.
+      SDL_AudioStreamFlush(t->conv);
+      SDL_RWclose(t->file);
+      t->file = 0;
+    }
+  }
+  int got = SDL_AudioStreamGet(t->conv, out, bytes);
+  return got > 0 ? got/(int) sizeof *out : 0;
+}
+
+/**
+ * Decodes n samples of t into out, going on with the next tracks of the
+ * playlist as they end. Returns fewer only if none of them can play.
+ */
+static int
+read_gapless(struct Track *t, Sint16 *out, int n) {
+  int done = 0, empty = 0;
+  while (done < n && t->conv) {
+    int got = read_track(t, out + done, n - done);
+    done += got;
+    empty = got ? 0 : empty + 1;
+    if (done < n) {
+      int i = t->index;
+      close_track(t);
+      if (empty > num_tracks) {
+        // A whole round of tracks without a sample.
+        break;
+      }
+      for (int k = 1; k <= num_tracks; k++) {
+        if (open_track(t, (i + k) % num_tracks) == 0) {
+          break;
+        }
+      }
+    }
+  }
+  SDL_memset(out + done, 0, (n - done)*sizeof *out);
+  return done;
+}
+
+/**
+ * Makes the next block_samples samples, crossfading from the current track
+ * to the incoming one if there is one.
+ */
+static void
+decode_block(void) {
+  read_gapless(&current, block, block_samples);
+  if (!incoming.conv) {
+    return;
+  }
+  read_gapless(&incoming, incoming_block, block_samples);
+  const int fade_len = freq*CROSSFADE_MS/1000;
+  for (int i = 0; i < block_samples; i += channels) {
+    int in = SDL_min(fade_frames, fade_len);
+    for (int c = 0; c < channels; c++) {
+      // 64 bits: a full scale sample times a fade of over a second in
+      // frames doesn't fit in an int.
+      block[i+c] = (Sint16) (((Sint64) block[i+c]*(fade_len - in)
+        + (Sint64) incoming_block[i+c]*in)/fade_len);
+    }
+    fade_frames++;
+  }
+  if (fade_frames >= fade_len) {
+    close_track(&current);
+    current = incoming;
+    SDL_zero(incoming);
+  }
+}
+
+static int
+decode(void *unused) {
+  (void) unused;
+  int restarts_seen = 0, wanted_seen = 0;
+  while (SDL_AtomicGet(&running)) {
+    int restart = SDL_AtomicGet(&restarts);
+    int wanted = SDL_AtomicGet(&wanted_track);
+    // A crossfade at a time. Another request waits for it to finish.
+    if (!incoming.conv
+        && (restart != restarts_seen || wanted != wanted_seen))
+    {
+      restarts_seen = restart;
+      wanted_seen = wanted;
+      if (open_track(&incoming, wanted) == 0) {
+        fade_frames = 0;
+      }
+    }
+    SDL_AtomicSet(&playing, current.conv || incoming.conv);
+
+    unsigned space;
+    unsigned head = ring_reserve(&ring, &space);
+    if (!SDL_AtomicGet(&playing) || space < (unsigned) block_samples) {
+      SDL_SemWaitTimeout(room, 100);
+      continue;
+    }
+    decode_block();
+    for (int i = 0; i < block_samples; i++) {
+      samples[ring_slot(&ring, head + i)] = block[i];
+    }
+    ring_publish(&ring, head, block_samples);
+  }
+  close_track(&current);
+  close_track(&incoming);
+  return 0;
+}
+
+/**
+ * Mix_HookMusic callback, on the audio thread: plays what's on the ring.
+ */
+static void
+play_ring(void *unused, Uint8 *stream, int len) {
+  (void) unused;
+  Sint16 *out = (Sint16*) stream;
+  int n = len/(int) sizeof *out;
+  unsigned queued;
+  unsigned tail = ring_peek(&ring, &queued);
+  int take = SDL_min(n, (int) queued);
+  for (int i = 0; i < take; i++) {
+    out[i] = samples[ring_slot(&ring, tail + i)]*VOLUME/MIX_MAX_VOLUME;
+  }
+  SDL_memset(out + take, 0, (n - take)*sizeof *out);
+  if (take < n && SDL_AtomicGet(&playing)) {
+    underruns++;
+  }
+  ring_release(&ring, tail, take);
+  SDL_SemPost(room);
+}
+
+static void
+find_tracks(void) {
+  num_tracks = 0;
+  for (int i = 1; i <= NUM_SONGS; i++) {
+    snprintf(paths[num_tracks], MAX_PATH, "music%d.wav", i);
+    SDL_RWops *f = SDL_RWFromFile(paths[num_tracks], "rb");
+    if (f) {
+      SDL_RWclose(f);
+      num_tracks++;
+    }
+  }
+}
+
+static int
+start_decoder(void) {
+  room = SDL_CreateSemaphore(0);
+  COND_ERET_IF0(room, -1, SDL_GetError());
+  SDL_AtomicSet(&running, 1);
+  decoder = SDL_CreateThread(decode, "music", 0);
+  COND_ERET_IF0(decoder, -1, SDL_GetError());
+  Mix_HookMusic(play_ring, 0);
+  return 0;
+}
+
 int
-init_music(void) {
-  COND_EGOTO_IF0(
-    (Mix_Init(MIX_INIT_FLAC) & MIX_INIT_FLAC) == MIX_INIT_FLAC,
+init_music(int buffer_frames) {
+  COND_EGOTO_LT0(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, buffer_frames),
     e_cleanup, Mix_GetError());
+  Uint16 format;
+  COND_EGOTO_IF0(Mix_QuerySpec(&freq, &format, &channels), e_cleanup,
+    Mix_GetError());
+
+  find_tracks();
+  block_samples = BLOCK_SAMPLES - BLOCK_SAMPLES % channels;
+  if (num_tracks && format == AUDIO_S16SYS) {
+    SDL_Log("music: a playlist of %d tracks", num_tracks);
+    COND_PGOTO_LT0(start_decoder(), e_cleanup);
+    return 0;
+  }
+  num_tracks = 0;
 
-  COND_EGOTO_LT0(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048),
+  COND_EGOTO_IF0(
+    (Mix_Init(MIX_INIT_FLAC) & MIX_INIT_FLAC) == MIX_INIT_FLAC,
     e_cleanup, Mix_GetError());
 
   music = Mix_LoadMUS("music.flac");
   COND_EGOTO_IF0(music, e_cleanup, Mix_GetError());
 
-  Mix_VolumeMusic(30);
+  Mix_VolumeMusic(VOLUME);
   return 0;
 
 e_cleanup:
@@ -28,6 +388,14 @@ e_cleanup:
 
 int
 play_new(void) {
+  if (decoder) {
+    // The decoder crossfades into the first track.
+    SDL_AtomicSet(&wanted_track, 0);
+    SDL_AtomicAdd(&restarts, 1);
+    SDL_SemPost(room);
+    return 0;
+  }
+
   /*
    * Yes, the SDL_mixer API is weird... FadeOutMusic returns 0 on failure (and
    * 1 on success), and FadeInMusic returns negative on failure (and 0 on
@@ -41,8 +409,28 @@ play_new(void) {
   return 0;
 }
 
+void
+music_set_level(int level) {
+  if (decoder) {
+    SDL_AtomicSet(&wanted_track, level/LEVELS_PER_TRACK % num_tracks);
+  }
+}
+
 void
 destroy_music(void) {
+  if (decoder) {
+    // The audio thread stops reading the ring before the decoder goes.
+    Mix_HookMusic(0, 0);
+    SDL_AtomicSet(&running, 0);
+    SDL_SemPost(room);
+    SDL_WaitThread(decoder, 0);
+    decoder = 0;
+    SDL_Log("music: %u underruns", underruns);
+  }
+  if (room) {
+    SDL_DestroySemaphore(room);
+    room = 0;
+  }
   xMix_FreeMusic(&music);
   Mix_Quit();
 }
@@ -1,12 +1,30 @@
 #ifndef MUSIC_H
 #define MUSIC_H
 
+enum {
+  // Frames per audio buffer, unless asked otherwise: about 12 ms at 44.1
+  // kHz. Sound effects can't start sooner than a buffer after they're
+  // played.
+  MUSIC_DEFAULT_BUFFER = 512
+};
+
+/**
+ * Opens the audio device, with buffer_frames frames (a power of 2) per
+ * buffer, and loads the music.
+ */
 int
-init_music(void);
+init_music(int buffer_frames);
 
 int
 play_new(void);
 
+/**
+ * Levels get tracks of their own: switching to another one crossfades into
+ * it. Only with a playlist; music.flac plays on regardless.
+ */
+void
+music_set_level(int level);
+
 void
 destroy_music(void);
 
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "pcsolve.h"
+
+/*
+ * Perfect clear solver for a single position, on all cores.
+ *
+ * Usage: pcclear [-t THREADS] [-n MAX_NODES] PIECES [ROW ...]
+ *
+ * PIECES and ROWs are as in a puzzle file (see pc_parse), e.g.
+ *
+ *   pcclear LJOIOLJTSZ
+ *
+ * looks for a perfect clear from an empty board with those 10 pieces. Prints
+ * the moves (kind, rotation and column of each piece's box), then how long
+ * it took and how many positions per second got searched.
+ */
+
+static const char *const RESULT_NAMES[] = {
+  "No perfect clear", "Perfect clear", "Gave up"
+};
+
+static void
+usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [-t THREADS] [-n MAX_NODES] PIECES [ROW ...]\n",
+    prog);
+}
+
+int
+main(int argc, char *argv[]) {
+  int threads = 0;
+  Uint64 max_nodes = PC_DEFAULT_MAX_NODES;
+  int i = 1;
+  for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+    if (!strcmp(argv[i], "-t")) {
+      threads = atoi(argv[i+1]);
+    }
+    else if (!strcmp(argv[i], "-n")) {
+      max_nodes = strtoull(argv[i+1], 0, 10);
+    }
+    else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  Uint16 rows[PANEL_ROWS];
+  Sint8 queue[PC_MAX_PIECES];
+  int num_pieces = pc_parse(argv + i, argc - i, rows, queue);
+  if (num_pieces < 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  struct PcSolver *solver = create_pc_solver(threads);
+  if (!solver) {
+    fputs("Out of memory.\n", stderr);
+    return EXIT_FAILURE;
+  }
+  struct Board b;
+  board_reset(&b, 1);
+  board_set_rows(&b, rows, NUM_DIFFERENT_PIECES + 1);
+  struct PcResult result;
+  pc_solve(solver, &b, queue, num_pieces, max_nodes, 0, &result);
+
+  printf("%s", RESULT_NAMES[result.status]);
+  if (result.status == PC_FOUND) {
+    printf(" in %d:", result.num_moves);
+    for (int j = 0; j < result.num_moves; j++) {
+      const struct BoardPiece *m = result.moves + j;
+      printf(" %c%d:%d", pc_piece_letter(m->kind), m->rotation,
+        m->relative.x);
+    }
+  }
+  printf("\n%.3f ms, %llu positions (%.0f/s) on %d threads\n", result.ms,
+    (unsigned long long) result.nodes,
+    result.ms > 0 ? result.nodes*1000.0/result.ms : 0.0,
+    pc_solver_threads(solver));
+
+  destroy_pc_solver(solver);
+  return result.status == PC_FOUND ? 0 : 2;
+}
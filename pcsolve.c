@@ -0,0 +1,406 @@
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "board.h"
+#include "jobs.h"
+#include "ttable.h"
+#include "pcsolve.h"
+
+enum {
+  // Box positions tried in each rotation: PLACE_MIN_X to PANEL_COLS - 1.
+  NUM_XS = PANEL_COLS - PLACE_MIN_X,
+  NUM_PLACEMENTS = 4*NUM_XS,
+
+  // Pieces whose placements make up the jobs: NUM_PLACEMENTS^2 jobs is
+  // plenty to keep every core busy until the end.
+  SPLIT_PIECES = 2,
+
+  // How often (in positions) a job adds to the node count and checks
+  // whether it should stop.
+  NODES_PER_CHECK = 1024
+};
+
+static const char PIECE_LETTERS[NUM_DIFFERENT_PIECES + 1] = "IOSZLJT";
+
+// What a search is doing, in PcSolver.state.
+enum {
+  SEARCHING,
+  STOP_FOUND,
+  STOP_GAVE_UP
+};
+
+struct PcSolver {
+  struct JobPool *pool;
+  // Positions no solution was found from, by hash and pieces placed.
+  struct TTable *table;
+  Uint64 num_searches;
+
+  // The search going on.
+  struct Board start;
+  Sint8 queue[PC_MAX_PIECES];
+  int num_pieces;
+  int split;
+  Uint64 salt;
+  Uint64 max_nodes;
+  SDL_atomic_t *cancel;
+  SDL_atomic_t state;
+  // Positions searched, in NODES_PER_CHECK units (so an int lasts).
+  SDL_atomic_t node_blocks;
+  Uint64 leftover_nodes;
+  SDL_SpinLock leftover_lock;
+  struct PcResult *result;
+};
+
+/**
+ * One job's way down the tree.
+ */
+struct Path {
+  // Placement numbers the first split pieces are limited to.
+  int forced[SPLIT_PIECES];
+  struct BoardPiece moves[PC_MAX_PIECES];
+  int nodes;
+};
+
+struct PcSolver*
+create_pc_solver(int num_threads) {
+  struct PcSolver *s = SDL_calloc(1, sizeof *s);
+  COND_ERET_IF0(s, 0, "Out of memory.");
+  s->pool = create_job_pool(num_threads);
+  COND_EGOTO_IF0(s->pool, e_cleanup, 0);
+  s->table = tt_create(PC_TTABLE_BYTES);
+  COND_EGOTO_IF0(s->table, e_cleanup, 0);
+  return s;
+
+e_cleanup:
+  destroy_pc_solver(s);
+  return 0;
+}
+
+void
+destroy_pc_solver(struct PcSolver *s) {
+  if (!s) {
+    return;
+  }
+  destroy_job_pool(s->pool);
+  tt_destroy(s->table);
+  SDL_free(s);
+}
+
+int
+pc_solver_threads(const struct PcSolver *s) {
+  return job_pool_threads(s->pool);
+}
+
+static int
+count_bits(unsigned x) {
+  int n = 0;
+  for (; x; x &= x - 1) {
+    n++;
+  }
+  return n;
+}
+
+static int
+should_stop(struct PcSolver *s) {
+  return SDL_AtomicGet(&s->state) != SEARCHING
+    || (s->cancel && SDL_AtomicGet(s->cancel));
+}
+
+/**
+ * Counts the positions path searched since the last check. Returns whether
+ * the search should stop.
+ */
+static int
+check_nodes(struct PcSolver *s, struct Path *path) {
+  int blocks = SDL_AtomicAdd(&s->node_blocks, 1) + 1;
+  path->nodes -= NODES_PER_CHECK;
+  if ((Uint64) blocks*NODES_PER_CHECK >= s->max_nodes) {
+    SDL_AtomicCAS(&s->state, SEARCHING, STOP_GAVE_UP);
+  }
+  return should_stop(s);
+}
+
+static int
+found(struct PcSolver *s, const struct Path *path, int num_moves) {
+  // Only the first job to get here gets to write the result.
+  if (SDL_AtomicCAS(&s->state, SEARCHING, STOP_FOUND)) {
+    SDL_memcpy(s->result->moves, path->moves,
+      num_moves*sizeof *path->moves);
+    s->result->num_moves = num_moves;
+  }
+  return 1;
+}
+
+/**
+ * Searches on from *b, with i pieces placed. Returns 1 if a solution was
+ * found (by this job or another one), 0 if there's none from here and -1 if
+ * the search stopped before finding out.
+ */
+static int
+search(struct PcSolver *s, struct Path *path, const struct Board *b, int i) {
+  int height = board_stack_height(b);
+  // Starting from an empty board, the goal is to clear it once again.
+  if (!height && i) {
+    return found(s, path, i);
+  }
+  if (i == s->num_pieces) {
+    return 0;
+  }
+  if (++path->nodes == NODES_PER_CHECK && check_nodes(s, path)) {
+    return -1;
+  }
+
+  // Every row up to the top of the stack has to be completed, with 4 cells
+  // a piece.
+  int filled = 0;
+  for (int y = 0; y < height; y++) {
+    filled += count_bits(b->rows[y]);
+  }
+  if (height*PANEL_COLS - filled > NUM_PIECE_PARTS*(s->num_pieces - i)) {
+    return 0;
+  }
+
+  // Placing pieces in another order often leads to the same stack, so
+  // positions without a solution are remembered. Not while the job is only
+  // trying some of the placements, though.
+  int first = 0, last = NUM_PLACEMENTS;
+  Uint64 key = (b->hash + (Uint64) i*0x9E3779B97F4A7C15ull) ^ s->salt;
+  float unused;
+  if (i < s->split) {
+    first = path->forced[i];
+    last = first + 1;
+  }
+  else if (tt_probe(s->table, key, 0, &unused)) {
+    return 0;
+  }
+
+  int kind = s->queue[i];
+  for (int j = first; j < last; j++) {
+    int rotation = j/NUM_XS;
+    if (kind == PIECE_O && rotation) {
+      // Same as rotation 0.
+      continue;
+    }
+    int x = j % NUM_XS + PLACE_MIN_X;
+    struct Board after;
+    if (board_place(b, kind, rotation, x, &after) < 0) {
+      continue;
+    }
+    // board_place fixed the piece, but it's still in falling.
+    path->moves[i] = after.falling;
+    path->moves[i].kind = kind;
+    int res = search(s, path, &after, i + 1);
+    if (res) {
+      return res;
+    }
+  }
+
+  if (i >= s->split) {
+    tt_store(s->table, key, 0, 0);
+  }
+  return 0;
+}
+
+static void
+search_job(void *ctx, int job_i) {
+  struct PcSolver *s = ctx;
+  if (should_stop(s)) {
+    return;
+  }
+  struct Path path;
+  for (int i = 0; i < s->split; i++, job_i /= NUM_PLACEMENTS) {
+    path.forced[i] = job_i % NUM_PLACEMENTS;
+  }
+  path.nodes = 0;
+  search(s, &path, &s->start, 0);
+
+  SDL_AtomicLock(&s->leftover_lock);
+  s->leftover_nodes += path.nodes;
+  SDL_AtomicUnlock(&s->leftover_lock);
+}
+
+void
+pc_solve(struct PcSolver *s, const struct Board *b, const Sint8 *queue,
+         int num_pieces, Uint64 max_nodes, SDL_atomic_t *cancel,
+         struct PcResult *result)
+{
+  SDL_assert(num_pieces >= 1);
+  num_pieces = SDL_min(num_pieces, PC_MAX_PIECES);
+  s->start = *b;
+  SDL_memcpy(s->queue, queue, num_pieces*sizeof *queue);
+  s->num_pieces = num_pieces;
+  s->split = SDL_min(num_pieces, SPLIT_PIECES);
+  // Entries from other searches could be about other pieces.
+  s->salt = ++s->num_searches*0xD6E8FEB86659FD93ull;
+  tt_new_search(s->table);
+  s->max_nodes = max_nodes;
+  s->cancel = cancel;
+  SDL_AtomicSet(&s->state, SEARCHING);
+  SDL_AtomicSet(&s->node_blocks, 0);
+  s->leftover_nodes = 0;
+  s->result = result;
+  result->num_moves = 0;
+
+  int num_jobs = 1;
+  for (int i = 0; i < s->split; i++) {
+    num_jobs *= NUM_PLACEMENTS;
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  run_jobs(s->pool, search_job, s, num_jobs);
+  result->ms = (SDL_GetPerformanceCounter() - start)*1000.0
+    / SDL_GetPerformanceFrequency();
+
+  switch (SDL_AtomicGet(&s->state)) {
+    case STOP_FOUND:
+      result->status = PC_FOUND;
+      break;
+    case SEARCHING:
+      // Every job ran out of placements to try.
+      result->status = should_stop(s) ? PC_GAVE_UP : PC_NOT_FOUND;
+      break;
+    default:
+      result->status = PC_GAVE_UP;
+      break;
+  }
+  result->nodes = (Uint64) SDL_AtomicGet(&s->node_blocks)*NODES_PER_CHECK
+    + s->leftover_nodes;
+}
+
+int
+pc_parse(char *const *words, int num_words, Uint16 rows[PANEL_ROWS],
+         Sint8 queue[PC_MAX_PIECES])
+{
+  if (num_words < 1 || num_words > PANEL_ROWS + 1) {
+    return -1;
+  }
+  int n = 0;
+  for (const char *c = words[0]; *c; c++) {
+    const char *letter = SDL_strchr(PIECE_LETTERS, *c);
+    if (!letter || n == PC_MAX_PIECES) {
+      return -1;
+    }
+    queue[n++] = letter - PIECE_LETTERS;
+  }
+
+  SDL_memset(rows, 0, PANEL_ROWS*sizeof *rows);
+  for (int y = 0; y < num_words - 1; y++) {
+    char *end;
+    unsigned long row = strtoul(words[y + 1], &end, 16);
+    if (*end || end == words[y + 1] || row > FULL_ROW) {
+      return -1;
+    }
+    rows[y] = row;
+  }
+  return n ? n : -1;
+}
+
+char
+pc_piece_letter(int kind) {
+  return PIECE_LETTERS[kind];
+}
+
+/*
+ * The assist. One search thread lives as long as the assist does, and waits
+ * for searches on assist_wake. It only touches assist_result until it sets
+ * assist_done, and the main thread only reads it after. It posts assist_idle
+ * after every search it was woken up for.
+ */
+
+static struct PcSolver *assist_solver;
+static SDL_Thread *assist_thread;
+static SDL_sem *assist_wake, *assist_idle;
+static SDL_atomic_t assist_quit;
+static SDL_atomic_t assist_cancel;
+static SDL_atomic_t assist_done;
+// Whether the thread was woken up for a search whose assist_idle wasn't
+// waited for yet. Only the main thread uses it.
+static int assist_busy;
+static struct Board assist_board;
+static Sint8 assist_queue[PC_MAX_PIECES];
+static int assist_pieces;
+static struct PcResult assist_result;
+
+static int
+assist_main(void *unused) {
+  (void) unused;
+  for (;;) {
+    SDL_SemWait(assist_wake);
+    if (SDL_AtomicGet(&assist_quit)) {
+      return 0;
+    }
+    pc_solve(assist_solver, &assist_board, assist_queue, assist_pieces,
+      PC_DEFAULT_MAX_NODES, &assist_cancel, &assist_result);
+    SDL_AtomicSet(&assist_done, 1);
+    SDL_SemPost(assist_idle);
+  }
+}
+
+int
+init_pc_assist(void) {
+  // Leaves a core for the game. The search thread runs jobs as well.
+  assist_solver = create_pc_solver(SDL_max(1, SDL_GetCPUCount() - 1));
+  COND_ERET_IF0(assist_solver, -1, 0);
+  assist_wake = SDL_CreateSemaphore(0);
+  COND_ERET_IF0(assist_wake, -1, SDL_GetError());
+  assist_idle = SDL_CreateSemaphore(0);
+  COND_ERET_IF0(assist_idle, -1, SDL_GetError());
+  SDL_AtomicSet(&assist_quit, 0);
+  assist_thread = SDL_CreateThread(assist_main, "pcsolve", 0);
+  COND_ERET_IF0(assist_thread, -1, SDL_GetError());
+  return 0;
+}
+
+void
+destroy_pc_assist(void) {
+  pc_assist_stop();
+  if (assist_thread) {
+    SDL_AtomicSet(&assist_quit, 1);
+    SDL_SemPost(assist_wake);
+    SDL_WaitThread(assist_thread, 0);
+    assist_thread = 0;
+  }
+  if (assist_wake) {
+    SDL_DestroySemaphore(assist_wake);
+    assist_wake = 0;
+  }
+  if (assist_idle) {
+    SDL_DestroySemaphore(assist_idle);
+    assist_idle = 0;
+  }
+  destroy_pc_solver(assist_solver);
+  assist_solver = 0;
+}
+
+void
+pc_assist_stop(void) {
+  if (assist_busy) {
+    SDL_AtomicSet(&assist_cancel, 1);
+    SDL_SemWait(assist_idle);
+    assist_busy = 0;
+  }
+  SDL_AtomicSet(&assist_done, 0);
+}
+
+int
+pc_assist_start(const struct Board *b, int num_pieces) {
+  SDL_assert(board_is_falling(b));
+  pc_assist_stop();
+  if (!assist_thread) {
+    return 0;
+  }
+
+  assist_board = *b;
+  assist_pieces = SDL_min(num_pieces, PC_MAX_PIECES);
+  board_upcoming(b, assist_queue, assist_pieces);
+  SDL_AtomicSet(&assist_cancel, 0);
+  assist_busy = 1;
+  SDL_SemPost(assist_wake);
+  return 0;
+}
+
+const struct PcResult*
+pc_assist_result(void) {
+  return SDL_AtomicGet(&assist_done) ? &assist_result : 0;
+}
@@ -0,0 +1,121 @@
+#ifndef PCSOLVE_H
+#define PCSOLVE_H
+
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+
+/*
+ * Perfect clear solver: finds placements for a known sequence of pieces
+ * that leave the board empty, each piece dropped straight down from the top
+ * (no hold).
+ *
+ * A search is split in jobs by the placements of its first two pieces, and
+ * the jobs spread over a job pool. Each job searches depth first. They share
+ * a transposition table of the positions no solution was found from, and
+ * all of them stop as soon as one finds a solution.
+ */
+
+enum {
+  PC_MAX_PIECES = 16,
+  PC_DEFAULT_MAX_NODES = 50*1000*1000,
+
+  // Bytes of transposition table per solver.
+  PC_TTABLE_BYTES = 8 << 20
+};
+
+enum PcStatus {
+  PC_NOT_FOUND,
+  PC_FOUND,
+  // Ran out of nodes or was cancelled: there may still be a solution.
+  PC_GAVE_UP
+};
+
+struct PcResult {
+  enum PcStatus status;
+  // Where each piece of the solution ends up, in order.
+  struct BoardPiece moves[PC_MAX_PIECES];
+  int num_moves;
+  // Positions searched, and how long that took.
+  Uint64 nodes;
+  double ms;
+};
+
+struct PcSolver;
+
+/**
+ * num_threads is as in create_job_pool (0 is one per CPU). Returns null on
+ * errors.
+ */
+struct PcSolver*
+create_pc_solver(int num_threads);
+
+void
+destroy_pc_solver(struct PcSolver *s);
+
+int
+pc_solver_threads(const struct PcSolver *s);
+
+/**
+ * Looks for a perfect clear of *b using the first pieces of queue, up to
+ * num_pieces of them (which must be at least 1). The falling piece on *b is
+ * ignored: queue[0] is the first one placed. Gives up after max_nodes
+ * positions, or once *cancel (if not null) is set from some other thread.
+ *
+ * A solver runs one search at a time.
+ */
+void
+pc_solve(struct PcSolver *s, const struct Board *b, const Sint8 *queue,
+         int num_pieces, Uint64 max_nodes, SDL_atomic_t *cancel,
+         struct PcResult *result);
+
+/**
+ * Reads a position and pieces in the format the puzzle and pcclear tools
+ * take: a word with the pieces (letters out of IOSZLJT), then the rows from
+ * the bottom up, each a hex mask of its filled columns (bit 0 is the leftmost
+ * one). Missing rows are empty. Returns how many pieces there are, or -1 if
+ * the words aren't a puzzle.
+ */
+int
+pc_parse(char *const *words, int num_words, Uint16 rows[PANEL_ROWS],
+         Sint8 queue[PC_MAX_PIECES]);
+
+char
+pc_piece_letter(int kind);
+
+/*
+ * In-game assist: one search at a time on a thread of its own, so the game
+ * keeps going while it runs. The thread is started once, by init_pc_assist,
+ * and waits in between searches.
+ */
+
+int
+init_pc_assist(void);
+
+void
+destroy_pc_assist(void);
+
+/**
+ * Starts looking for a perfect clear from *b with its falling piece and the
+ * ones that come after it (up to num_pieces). Cancels the search going on,
+ * if any.
+ */
+int
+pc_assist_start(const struct Board *b, int num_pieces);
+
+/**
+ * Cancels the search going on, if any, and waits for it to stop.
+ */
+void
+pc_assist_stop(void);
+
+/**
+ * The result of the last search, or null if it's still going on (or none
+ * was started).
+ */
+const struct PcResult*
+pc_assist_result(void);
+
+#endif
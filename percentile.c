@@ -0,0 +1,19 @@
+#include <stdlib.h>
+
+#include "percentile.h"
+
+static int
+compare_u32(const void *a, const void *b) {
+  Uint32 x = *(const Uint32 *) a, y = *(const Uint32 *) b;
+  return (x > y) - (x < y);
+}
+
+void
+sort_u32(Uint32 *values, Uint32 n) {
+  qsort(values, n, sizeof *values, compare_u32);
+}
+
+Uint32
+percentile(const Uint32 *sorted, Uint32 n, int p) {
+  return sorted[(Uint64) (n - 1)*p/100];
+}
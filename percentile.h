@@ -0,0 +1,19 @@
+#ifndef PERCENTILE_H
+#define PERCENTILE_H
+
+#include <SDL2/SDL.h>
+
+/**
+ * Sorts the n values, smallest first, for percentile to pick from.
+ */
+void
+sort_u32(Uint32 *values, Uint32 n);
+
+/**
+ * The p-th percentile (0 to 100) of the n > 0 sorted values: the one p% of
+ * the way from the smallest to the largest.
+ */
+Uint32
+percentile(const Uint32 *sorted, Uint32 n, int p);
+
+#endif
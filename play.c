@@ -0,0 +1,260 @@
+#include <SDL2/SDL.h>
+
+#include "bytes.h"
+#include "error.h"
+#include "play.h"
+
+enum PlayTimer {
+  TIMER_SPAWN,
+  TIMER_GRAVITY,
+  TIMER_LOCK
+};
+
+static Uint32
+gravity(const struct Play *p) {
+  return board_gravity(board_level(&p->board));
+}
+
+static int
+grounded(const struct Play *p) {
+  return board_drop_distance(&p->board) == 0;
+}
+
+/**
+ * Sets the gravity timer off for when what the piece fell since
+ * gravity_tick adds up to a row.
+ */
+static void
+schedule_gravity(struct Play *p) {
+  Uint32 g = gravity(p);
+  p->gravity_tick = p->tick;
+  p->gravity_timer = tw_schedule(&p->timers,
+    (GRAVITY_ONE - p->gravity_acc + g - 1)/g, TIMER_GRAVITY);
+}
+
+static void
+start_lock_delay(struct Play *p) {
+  tw_cancel(&p->timers, p->lock_timer);
+  p->lock_timer = tw_schedule(&p->timers, LOCK_DELAY_TICKS, TIMER_LOCK);
+}
+
+/**
+ * The lock resets run out for good only while the piece stays as low as
+ * it's been.
+ */
+static void
+note_lowest(struct Play *p) {
+  int y = p->board.falling.relative.y;
+  if (y < p->lowest) {
+    p->lowest = y;
+    p->lock_resets = 0;
+  }
+}
+
+static void
+lock(struct Play *p, struct PlayEvents *ev) {
+  tw_cancel(&p->timers, p->gravity_timer);
+  tw_cancel(&p->timers, p->lock_timer);
+  p->gravity_timer = p->lock_timer = TW_NONE;
+  ev->locked = 1;
+  ev->piece = p->board.falling;
+  board_fixate(&p->board, &ev->lock);
+  tw_schedule(&p->timers, ENTRY_DELAY_TICKS
+    + (ev->lock.lines ? LINE_CLEAR_DELAY_TICKS : 0), TIMER_SPAWN);
+}
+
+static void
+spawn(struct Play *p, struct PlayEvents *ev) {
+  if (board_spawn(&p->board) < 0) {
+    // It doesn't fit where pieces show up: the stack reached the top.
+    p->over = 1;
+    ev->game_over = 1;
+    return;
+  }
+  ev->spawned = 1;
+  p->gravity_acc = 0;
+  p->lock_resets = 0;
+  p->lowest = p->board.falling.relative.y;
+  schedule_gravity(p);
+}
+
+static void
+fall(struct Play *p, struct PlayEvents *ev) {
+  p->gravity_timer = TW_NONE;
+  // Gravity may add up to many rows at once (past 1G).
+  p->gravity_acc += gravity(p)*(p->tick - p->gravity_tick);
+  int rows = p->gravity_acc/GRAVITY_ONE;
+  p->gravity_acc %= GRAVITY_ONE;
+  ev->dropped += board_drop(&p->board, rows);
+  note_lowest(p);
+  if (grounded(p)) {
+    p->gravity_acc = 0;
+    if (!tw_pending(&p->timers, p->lock_timer)) {
+      start_lock_delay(p);
+    }
+  }
+  else {
+    schedule_gravity(p);
+  }
+}
+
+static void
+lock_delay_over(struct Play *p, struct PlayEvents *ev) {
+  p->lock_timer = TW_NONE;
+  if (grounded(p)) {
+    lock(p, ev);
+  }
+  else {
+    schedule_gravity(p);
+  }
+}
+
+/**
+ * After the piece moved or turned: on the ground, it stops falling and the
+ * lock delay starts (or starts over, if there are resets left); in the air,
+ * it falls.
+ */
+static void
+moved(struct Play *p) {
+  note_lowest(p);
+  if (grounded(p)) {
+    tw_cancel(&p->timers, p->gravity_timer);
+    p->gravity_timer = TW_NONE;
+    p->gravity_acc = 0;
+    if (!tw_pending(&p->timers, p->lock_timer)) {
+      start_lock_delay(p);
+    }
+    else if (p->lock_resets < MAX_LOCK_RESETS) {
+      p->lock_resets++;
+      start_lock_delay(p);
+    }
+  }
+  else {
+    tw_cancel(&p->timers, p->lock_timer);
+    p->lock_timer = TW_NONE;
+    if (!tw_pending(&p->timers, p->gravity_timer)) {
+      schedule_gravity(p);
+    }
+  }
+}
+
+void
+play_reset(struct Play *p, Uint32 seed) {
+  board_reset(&p->board, seed);
+  tw_reset(&p->timers);
+  p->tick = 0;
+  p->gravity_acc = p->gravity_tick = 0;
+  p->gravity_timer = p->lock_timer = TW_NONE;
+  p->lock_resets = 0;
+  p->lowest = 0;
+  p->over = 0;
+  tw_schedule(&p->timers, 1, TIMER_SPAWN);
+}
+
+int
+play_input(struct Play *p, enum InputAction action, struct PlayEvents *ev) {
+  SDL_zerop(ev);
+  if (p->over || !board_is_falling(&p->board)) {
+    return 0;
+  }
+
+  int done = 0;
+  switch (action) {
+    case INPUT_DOWN:
+      if (!board_move(&p->board, 0, -1)) {
+        lock(p, ev);
+        return 1;
+      }
+      // Falling starts over from the row it got to.
+      tw_cancel(&p->timers, p->gravity_timer);
+      p->gravity_timer = TW_NONE;
+      p->gravity_acc = 0;
+      done = 1;
+      break;
+    case INPUT_LEFT:
+      done = board_move(&p->board, -1, 0);
+      break;
+    case INPUT_RIGHT:
+      done = board_move(&p->board, 1, 0);
+      break;
+    case INPUT_ROTATE:
+    case INPUT_ROTATE_CCW:
+      done = board_rotate(&p->board, action == INPUT_ROTATE ? 1 : -1);
+      break;
+    case NUM_INPUT_ACTIONS:
+      break;
+  }
+  if (done) {
+    moved(p);
+  }
+  return done;
+}
+
+void
+play_tick(struct Play *p, struct PlayEvents *ev) {
+  SDL_zerop(ev);
+  if (p->over) {
+    return;
+  }
+  p->tick++;
+  tw_advance(&p->timers);
+  int event;
+  while ((event = tw_pop(&p->timers)) >= 0) {
+    switch (event) {
+      case TIMER_SPAWN:
+        spawn(p, ev);
+        break;
+      case TIMER_GRAVITY:
+        fall(p, ev);
+        break;
+      case TIMER_LOCK:
+        lock_delay_over(p, ev);
+        break;
+    }
+  }
+}
+
+Uint32
+play_gravity_acc(const struct Play *p) {
+  if (!tw_pending(&p->timers, p->gravity_timer)) {
+    return p->gravity_acc;
+  }
+  return SDL_min(p->gravity_acc + gravity(p)*(p->tick - p->gravity_tick),
+    (Uint32) GRAVITY_ONE - 1);
+}
+
+void
+play_save(const struct Play *p, Uint8 *out) {
+  board_save(&p->board, out);
+  out += BOARD_SAVE_SIZE;
+  out = put_u32(out, p->tick);
+  out = put_u32(out, p->gravity_acc);
+  out = put_u32(out, p->gravity_tick);
+  out = put_u32(out, p->gravity_timer);
+  out = put_u32(out, p->lock_timer);
+  out = put_u32(out, p->lock_resets);
+  out = put_u32(out, p->lowest);
+  out = put_u32(out, p->over);
+  tw_save(&p->timers, out);
+}
+
+int
+play_load(struct Play *p, const Uint8 *in) {
+  struct Play l;
+  COND_PRET_LT0(board_load(&l.board, in));
+  in += BOARD_SAVE_SIZE;
+  l.tick = get_u32(in);
+  l.gravity_acc = get_u32(in + 4);
+  l.gravity_tick = get_u32(in + 8);
+  l.gravity_timer = (Sint32) get_u32(in + 12);
+  l.lock_timer = (Sint32) get_u32(in + 16);
+  l.lock_resets = get_u32(in + 20);
+  l.lowest = (Sint32) get_u32(in + 24);
+  l.over = get_u32(in + 28);
+  COND_ERET(tw_load(&l.timers, in + 32) < 0 || l.timers.now != l.tick
+    || l.gravity_acc >= GRAVITY_ONE || l.gravity_tick > l.tick
+    || l.lock_resets < 0 || l.lock_resets > MAX_LOCK_RESETS
+    || l.over < 0 || l.over > 1, -1, "Bad saved game.");
+  *p = l;
+  return 0;
+}
@@ -0,0 +1,104 @@
+#ifndef PLAY_H
+#define PLAY_H
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "replay.h"
+#include "timerwheel.h"
+
+/*
+ * A game over time: the board, plus the timers that say when things happen
+ * to it, advanced a tick (1/TICKS_PER_SECOND s) at a time. Everything timed
+ * goes through the timer wheel: gravity pulling the piece down, the lock
+ * delay once it lands, and the entry delay before the next piece shows up
+ * (longer after clearing lines).
+ *
+ * A piece on the ground locks LOCK_DELAY_TICKS after landing. Moving or
+ * rotating it starts the delay over, up to MAX_LOCK_RESETS times, which
+ * gets reset when the piece gets lower than it ever was. Soft dropping it
+ * when it's on the ground locks it right away.
+ *
+ * The game screen and the corpus tool both play games through here, so a
+ * replay comes out the same wherever it's played. A Play has no pointers,
+ * so copying it is a snapshot to roll back to.
+ */
+
+enum {
+  LOCK_DELAY_TICKS = 30,
+  MAX_LOCK_RESETS = 15,
+  ENTRY_DELAY_TICKS = 6,
+  LINE_CLEAR_DELAY_TICKS = 12,
+
+  // Bytes play_save writes: the board, 8 u32 and the timers.
+  PLAY_SAVE_SIZE = BOARD_SAVE_SIZE + 8*4 + TW_SAVE_SIZE
+};
+
+struct Play {
+  struct Board board;
+  struct TimerWheel timers;
+  // Ticks simulated since the game started.
+  Uint32 tick;
+  // Fraction of a row the falling piece had fallen on gravity_tick, in
+  // GRAVITY_ONE units. See play_gravity_acc for what it's at now.
+  Uint32 gravity_acc, gravity_tick;
+  int gravity_timer, lock_timer;
+  int lock_resets;
+  // Lowest the falling piece's box got.
+  int lowest;
+  int over;
+};
+
+/**
+ * What happened on a tick or input.
+ */
+struct PlayEvents {
+  // Rows gravity pulled the falling piece down.
+  int dropped;
+  // A piece locked: the piece as it was, and what it did.
+  int locked;
+  struct BoardPiece piece;
+  struct LockResult lock;
+  int spawned;
+  int game_over;
+};
+
+/**
+ * Starts a new game. The first piece shows up on the first tick.
+ */
+void
+play_reset(struct Play *p, Uint32 seed);
+
+/**
+ * Applies a player input. Returns whether it changed anything.
+ */
+int
+play_input(struct Play *p, enum InputAction action, struct PlayEvents *ev);
+
+/**
+ * Advances the game a tick, firing whatever timers are due then.
+ */
+void
+play_tick(struct Play *p, struct PlayEvents *ev);
+
+/**
+ * Fraction of a row the falling piece has fallen by now, in GRAVITY_ONE
+ * units.
+ */
+Uint32
+play_gravity_acc(const struct Play *p);
+
+/**
+ * Writes everything about *p, PLAY_SAVE_SIZE bytes, to out.
+ */
+void
+play_save(const struct Play *p, Uint8 *out);
+
+/**
+ * Sets *p up as play_save wrote in. Returns -1 if in doesn't make sense as a
+ * game (and then *p is left as it was).
+ */
+int
+play_load(struct Play *p, const Uint8 *in);
+
+#endif
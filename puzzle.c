@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "jobs.h"
+#include "pcsolve.h"
+
+/*
+ * Puzzle verifier. Reads positions and piece sequences and finds out, on all
+ * cores, whether each position can be cleared completely using the pieces in
+ * order (no hold), each dropped straight down from the top.
+ *
+ * Usage: puzzle FILE|- [THREADS]
+ *
+ * One puzzle per line, as pc_parse reads them: the pieces, then the rows of
+ * the position from the bottom up as hex masks. Blank lines and lines
+ * starting with # are skipped. For example, an O filling a 2 by 2 gap in the
+ * middle of the two bottom rows:
+ *
+ *   O 3cf 3cf
+ *
+ * The file is read a batch at a time, so it can be as long as it needs to be.
+ * Prints a line per puzzle, in file order: the line number, the result, how
+ * many pieces the solution used, the time and positions it took, and the
+ * solution (kind, rotation and column of each piece's box).
+ *
+ * Puzzles are solved one per thread at a time. For a single hard one,
+ * pcclear puts all the threads on it.
+ */
+
+enum {
+  MAX_LINE = 512,
+
+  // Puzzles read and solved at a time.
+  BATCH_SIZE = 1024
+};
+
+static const char *const RESULT_NAMES[] = {"unsolvable", "solved", "gave up"};
+
+struct Puzzle {
+  long line;
+  Uint16 rows[PANEL_ROWS];
+  Sint8 pieces[PC_MAX_PIECES];
+  int num_pieces;
+  struct PcResult result;
+};
+
+/**
+ * Workers pull puzzles off the batch one at a time, so a hard one doesn't
+ * hold up the easy ones behind it. Each has a single threaded solver of its
+ * own.
+ */
+struct Batch {
+  struct Puzzle *puzzles;
+  int num_puzzles;
+  SDL_atomic_t next;
+  struct PcSolver **solvers;
+};
+
+static void
+solve_job(void *ctx, int job_i) {
+  struct Batch *batch = ctx;
+  int i;
+  while ((i = SDL_AtomicAdd(&batch->next, 1)) < batch->num_puzzles) {
+    struct Puzzle *p = batch->puzzles + i;
+    struct Board b;
+    board_reset(&b, 1);
+    // No piece left those blocks, so they get a kind of their own.
+    board_set_rows(&b, p->rows, NUM_DIFFERENT_PIECES + 1);
+    pc_solve(batch->solvers[job_i], &b, p->pieces, p->num_pieces,
+      PC_DEFAULT_MAX_NODES, 0, &p->result);
+  }
+}
+
+/**
+ * Returns 1 if the line had a puzzle, 0 if there's nothing on it and -1 if
+ * it's not one.
+ */
+static int
+parse_puzzle(char *line, struct Puzzle *p) {
+  static const char *const SPACE = " \t\r\n";
+  char *words[PANEL_ROWS + 2];
+  int num_words = 0;
+  for (char *word = strtok(line, SPACE); word; word = strtok(0, SPACE)) {
+    if (num_words == PANEL_ROWS + 2) {
+      return -1;
+    }
+    words[num_words++] = word;
+  }
+  if (!num_words || *words[0] == '#') {
+    return 0;
+  }
+  p->num_pieces = pc_parse(words, num_words, p->rows, p->pieces);
+  return p->num_pieces < 0 ? -1 : 1;
+}
+
+/**
+ * Reads up to BATCH_SIZE puzzles. Returns how many, or -1 on a read error.
+ */
+static int
+read_batch(FILE *in, long *line_num, struct Puzzle *puzzles) {
+  char line[MAX_LINE];
+  int n = 0;
+  while (n < BATCH_SIZE && fgets(line, sizeof line, in)) {
+    ++*line_num;
+    if (!strchr(line, '\n') && !feof(in)) {
+      fprintf(stderr, "line %ld: too long\n", *line_num);
+      // Skip the rest of it.
+      int c;
+      while ((c = getc(in)) != EOF && c != '\n') {
+        continue;
+      }
+      continue;
+    }
+    int parsed = parse_puzzle(line, puzzles + n);
+    if (parsed < 0) {
+      fprintf(stderr, "line %ld: not a puzzle\n", *line_num);
+    }
+    else if (parsed) {
+      puzzles[n++].line = *line_num;
+    }
+  }
+  return ferror(in) ? -1 : n;
+}
+
+static void
+print_puzzle(const struct Puzzle *p) {
+  const struct PcResult *r = &p->result;
+  printf("%6ld %-10s", p->line, RESULT_NAMES[r->status]);
+  if (r->status == PC_FOUND) {
+    printf(" %2d/%-2d", r->num_moves, p->num_pieces);
+  }
+  else {
+    printf(" %2s/%-2d", "-", p->num_pieces);
+  }
+  printf(" %10.3f ms %10llu positions", r->ms, (unsigned long long) r->nodes);
+  for (int i = 0; i < r->num_moves; i++) {
+    const struct BoardPiece *m = r->moves + i;
+    printf(" %c%d:%d", pc_piece_letter(m->kind), m->rotation, m->relative.x);
+  }
+  putchar('\n');
+}
+
+int
+main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s FILE|- [THREADS]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  FILE *in = strcmp(argv[1], "-") ? fopen(argv[1], "r") : stdin;
+  if (!in) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  int ret = EXIT_FAILURE;
+  int num_solvers = 0;
+  struct JobPool *pool = create_job_pool(argc > 2 ? atoi(argv[2]) : 0);
+  struct Batch batch = {0};
+  batch.puzzles = SDL_malloc(BATCH_SIZE*sizeof *batch.puzzles);
+  if (pool) {
+    batch.solvers = SDL_calloc(job_pool_threads(pool),
+      sizeof *batch.solvers);
+  }
+  if (!pool || !batch.puzzles || !batch.solvers) {
+    fputs("Out of memory.\n", stderr);
+    goto cleanup;
+  }
+  for (; num_solvers < job_pool_threads(pool); num_solvers++) {
+    batch.solvers[num_solvers] = create_pc_solver(1);
+    if (!batch.solvers[num_solvers]) {
+      fputs("Out of memory.\n", stderr);
+      goto cleanup;
+    }
+  }
+
+  long line_num = 0;
+  Uint64 total = 0, counts[3] = {0};
+  double total_ms = 0;
+  Uint64 start = SDL_GetPerformanceCounter();
+  while ((batch.num_puzzles = read_batch(in, &line_num, batch.puzzles)) > 0) {
+    SDL_AtomicSet(&batch.next, 0);
+    run_jobs(pool, solve_job, &batch, num_solvers);
+    for (int i = 0; i < batch.num_puzzles; i++) {
+      print_puzzle(batch.puzzles + i);
+      counts[batch.puzzles[i].result.status]++;
+      total_ms += batch.puzzles[i].result.ms;
+    }
+    total += batch.num_puzzles;
+  }
+  if (batch.num_puzzles < 0) {
+    perror(argv[1]);
+    goto cleanup;
+  }
+  double wall_ms = (SDL_GetPerformanceCounter() - start)*1000.0
+    / SDL_GetPerformanceFrequency();
+
+  printf("%llu puzzles: %llu solved, %llu unsolvable, %llu gave up; "
+    "%.1f ms on %d threads (%.1f ms solving)\n",
+    (unsigned long long) total, (unsigned long long) counts[PC_FOUND],
+    (unsigned long long) counts[PC_NOT_FOUND],
+    (unsigned long long) counts[PC_GAVE_UP], wall_ms, num_solvers, total_ms);
+  ret = 0;
+
+cleanup:
+  for (int i = 0; i < num_solvers; i++) {
+    destroy_pc_solver(batch.solvers[i]);
+  }
+  SDL_free(batch.solvers);
+  SDL_free(batch.puzzles);
+  destroy_job_pool(pool);
+  if (in != stdin) {
+    fclose(in);
+  }
+  return ret;
+}
@@ -0,0 +1,213 @@
+#include <SDL2/SDL.h>
+
+#include "bytes.h"
+#include "error.h"
+#include "replay.h"
+
+static Uint32 rec_seed;
+static Uint32 rec_last_tick;
+static Uint32 rec_num_inputs;
+static int rec_size;
+static Uint8 rec_inputs[MAX_REPLAY_INPUTS*MAX_REPLAY_INPUT_SIZE];
+
+void
+replay_record_start(Uint32 seed) {
+  rec_seed = seed;
+  rec_last_tick = 0;
+  rec_num_inputs = 0;
+  rec_size = 0;
+}
+
+void
+replay_record_input(Uint32 tick, enum InputAction action) {
+  if (rec_num_inputs == MAX_REPLAY_INPUTS) {
+    return;
+  }
+  Uint32 delta = tick - rec_last_tick;
+  do {
+    rec_inputs[rec_size] = delta & 0x7F;
+    delta >>= 7;
+    if (delta) {
+      rec_inputs[rec_size] |= 0x80;
+    }
+    rec_size++;
+  } while (delta);
+  rec_inputs[rec_size++] = action;
+  rec_last_tick = tick;
+  rec_num_inputs++;
+}
+
+int
+replay_record_save(Uint8 *out) {
+  Uint8 *p = out;
+  p = put_u32(p, rec_seed);
+  p = put_u32(p, rec_last_tick);
+  p = put_u32(p, rec_num_inputs);
+  p = put_u32(p, rec_size);
+  SDL_memcpy(p, rec_inputs, rec_size);
+  return p - out + rec_size;
+}
+
+int
+replay_record_load(const Uint8 *in, int len) {
+  COND_ERET(len < 4*4, -1, "Saved recording cut short.");
+  Uint32 num_inputs = get_u32(in + 8);
+  Uint32 size = get_u32(in + 12);
+  COND_ERET(num_inputs > MAX_REPLAY_INPUTS || size > sizeof rec_inputs
+    || size != (Uint32) len - 4*4, -1, "Bad saved recording.");
+  rec_seed = get_u32(in);
+  rec_last_tick = get_u32(in + 4);
+  rec_num_inputs = num_inputs;
+  rec_size = size;
+  SDL_memcpy(rec_inputs, in + 4*4, size);
+  return 0;
+}
+
+int
+replay_record_end(Uint32 ticks, int points, int lines, int pieces) {
+  Uint8 header[REPLAY_HEADER_SIZE] = {'T', 'R', 'P', 'L', REPLAY_VERSION};
+  Uint8 *p = header + 5;
+  p = put_u32(p, rec_seed);
+  p = put_u32(p, ticks);
+  p = put_u32(p, points);
+  p = put_u32(p, lines);
+  p = put_u32(p, pieces);
+  p = put_u32(p, rec_num_inputs);
+  put_u32(p, rec_size);
+
+  SDL_RWops *f = SDL_RWFromFile(REPLAY_FILE, "ab");
+  COND_ERET_IF0(f, -1, SDL_GetError());
+  int ok = SDL_RWwrite(f, header, sizeof header, 1) == 1
+    && (rec_size == 0 || SDL_RWwrite(f, rec_inputs, rec_size, 1) == 1);
+  COND_ERET_LT0(SDL_RWclose(f), SDL_GetError());
+  COND_ERET_IF0(ok, -1, SDL_GetError());
+  return 0;
+}
+
+int
+replay_parse_header(const Uint8 *buf, int len, struct ReplayHeader *h) {
+  COND_ERET(len < REPLAY_HEADER_SIZE || SDL_memcmp(buf, "TRPL", 4) != 0
+    || buf[4] != REPLAY_VERSION, -1, "Not a replay.");
+  const Uint8 *p = buf + 5;
+  h->seed = get_u32(p);
+  h->ticks = get_u32(p + 4);
+  h->points = get_u32(p + 8);
+  h->lines = get_u32(p + 12);
+  h->pieces = get_u32(p + 16);
+  h->num_inputs = get_u32(p + 20);
+  h->inputs_size = get_u32(p + 24);
+  COND_ERET(h->num_inputs > MAX_REPLAY_INPUTS
+    || h->inputs_size > MAX_REPLAY_INPUTS*MAX_REPLAY_INPUT_SIZE, -1,
+    "Corrupt replay header.");
+  return REPLAY_HEADER_SIZE;
+}
+
+int
+replay_next_input(const Uint8 *buf, Uint32 size, Uint32 *pos,
+                  struct ReplayInput *in)
+{
+  Uint32 p = *pos;
+  if (p >= size) {
+    return 0;
+  }
+  Uint32 delta = 0;
+  int shift = 0;
+  do {
+    if (p >= size || shift > 28) {
+      return -1;
+    }
+    delta |= (Uint32) (buf[p] & 0x7F) << shift;
+    shift += 7;
+  } while (buf[p++] & 0x80);
+  if (p >= size || buf[p] >= NUM_INPUT_ACTIONS) {
+    return -1;
+  }
+  in->tick += delta;
+  in->action = buf[p++];
+  *pos = p;
+  return 1;
+}
+
+int
+replay_parse_inputs(const struct ReplayHeader *h, const Uint8 *buf,
+                    struct ReplayInput *out)
+{
+  struct ReplayInput in = {0, 0};
+  Uint32 pos = 0;
+  for (Uint32 i = 0; i < h->num_inputs; i++) {
+    COND_ERET(replay_next_input(buf, h->inputs_size, &pos, &in) != 1, -1,
+      "Corrupt replay.");
+    out[i] = in;
+  }
+  return 0;
+}
+
+/**
+ * Reads the header at the current position of f. Returns 0 at the end of
+ * the file, 1 if a header was read and negative on errors.
+ */
+static int
+read_header(SDL_RWops *f, struct ReplayHeader *h) {
+  Uint8 buf[REPLAY_HEADER_SIZE];
+  size_t n = SDL_RWread(f, buf, 1, sizeof buf);
+  if (n == 0) {
+    return 0;
+  }
+  COND_PRET_LT0(replay_parse_header(buf, n, h));
+  return 1;
+}
+
+int
+replay_load(const char *path, int index, struct Replay *r) {
+  r->inputs = 0;
+  SDL_RWops *f = SDL_RWFromFile(path, "rb");
+  COND_ERET_IF0(f, -1, SDL_GetError());
+
+  if (index < 0) {
+    int count = 0;
+    int got;
+    while ((got = read_header(f, &r->header)) > 0) {
+      count++;
+      COND_EGOTO(SDL_RWseek(f, r->header.inputs_size, RW_SEEK_CUR) < 0,
+        e_cleanup, SDL_GetError());
+    }
+    COND_PGOTO_LT0(got, e_cleanup);
+    index += count;
+    COND_EGOTO(index < 0, e_cleanup, "No such game in the replay file.");
+    COND_EGOTO(SDL_RWseek(f, 0, RW_SEEK_SET) < 0, e_cleanup,
+      SDL_GetError());
+  }
+
+  for (int i = 0; ; i++) {
+    int got = read_header(f, &r->header);
+    COND_PGOTO_LT0(got, e_cleanup);
+    COND_EGOTO(got == 0, e_cleanup, "No such game in the replay file.");
+    if (i == index) {
+      break;
+    }
+    COND_EGOTO(SDL_RWseek(f, r->header.inputs_size, RW_SEEK_CUR) < 0,
+      e_cleanup, SDL_GetError());
+  }
+
+  Uint8 *raw = SDL_malloc(r->header.inputs_size + 1);
+  COND_EGOTO_IF0(raw, e_cleanup, "Out of memory.");
+  r->inputs = SDL_malloc((r->header.num_inputs + 1) * sizeof *r->inputs);
+  int ok = r->inputs
+    && SDL_RWread(f, raw, 1, r->header.inputs_size) == r->header.inputs_size
+    && replay_parse_inputs(&r->header, raw, r->inputs) == 0;
+  SDL_free(raw);
+  COND_EGOTO_IF0(ok, e_cleanup, "Couldn't read the replay.");
+  SDL_RWclose(f);
+  return 0;
+
+e_cleanup:
+  SDL_RWclose(f);
+  replay_free(r);
+  return -1;
+}
+
+void
+replay_free(struct Replay *r) {
+  SDL_free(r->inputs);
+  r->inputs = 0;
+}
@@ -0,0 +1,134 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Recorded games. The rules are deterministic given the board's seed, so a
+ * game is its seed plus the inputs and the simulation tick each one happened
+ * on.
+ *
+ * Finished games are appended to REPLAY_FILE. Each one is (little endian):
+ *   "TRPL", version (u8), seed (u32), ticks (u32), points (u32), lines
+ *   (u32), pieces (u32), number of inputs (u32), size of the inputs in bytes
+ *   (u32), then for each input the ticks since the previous one (unsigned
+ *   LEB128 varint) and the action (u8).
+ */
+
+enum {
+  // The simulation advances in fixed steps of 1/TICKS_PER_SECOND s, no
+  // matter how often frames get drawn. That's what makes replays possible.
+  TICKS_PER_SECOND = 60,
+
+  // Bumped whenever the rules change in a way that makes older games play
+  // back differently (2: level based gravity, 3: SRS rotations, 4: lock
+  // delay and entry delay).
+  REPLAY_VERSION = 4,
+  REPLAY_HEADER_SIZE = 4 + 1 + 7*4,
+
+  // Longest game that can be recorded, in inputs.
+  MAX_REPLAY_INPUTS = 1 << 16,
+
+  // Longest an input gets in the file: a varint for the tick delta plus the
+  // action byte.
+  MAX_REPLAY_INPUT_SIZE = 5 + 1,
+
+  // Most replay_record_save can write: seed, last tick, number of inputs and
+  // their size (u32 each), then the inputs as in the file.
+  MAX_RECORDING_SAVE_SIZE = 4*4 + MAX_REPLAY_INPUTS*MAX_REPLAY_INPUT_SIZE
+};
+
+static const char *const REPLAY_FILE = "replays.bin";
+
+enum InputAction {
+  INPUT_LEFT,
+  INPUT_RIGHT,
+  INPUT_ROTATE,
+  INPUT_DOWN,
+  INPUT_ROTATE_CCW,
+  NUM_INPUT_ACTIONS
+};
+
+struct ReplayInput {
+  Uint32 tick;
+  Uint8 action;
+};
+
+struct ReplayHeader {
+  Uint32 seed, ticks, points, lines, pieces, num_inputs, inputs_size;
+};
+
+struct Replay {
+  struct ReplayHeader header;
+  struct ReplayInput *inputs;
+};
+
+/**
+ * Starts recording a new game (dropping whatever was being recorded).
+ */
+void
+replay_record_start(Uint32 seed);
+
+/**
+ * Records that action happened after tick ticks of the game were simulated.
+ */
+void
+replay_record_input(Uint32 tick, enum InputAction action);
+
+/**
+ * Writes the recording going on to out, which has room for
+ * MAX_RECORDING_SAVE_SIZE bytes, so it can go on later (see
+ * replay_record_load). Returns how many bytes it wrote.
+ */
+int
+replay_record_save(Uint8 *out);
+
+/**
+ * Picks up the recording replay_record_save wrote len bytes of. Returns -1
+ * if that doesn't look like one.
+ */
+int
+replay_record_load(const Uint8 *in, int len);
+
+/**
+ * Appends the game being recorded to REPLAY_FILE.
+ */
+int
+replay_record_end(Uint32 ticks, int points, int lines, int pieces);
+
+/**
+ * Parses a header at the start of buf (len bytes). Returns its size or
+ * negative if it's not a valid header.
+ */
+int
+replay_parse_header(const Uint8 *buf, int len, struct ReplayHeader *h);
+
+/**
+ * Decodes the input at *pos of the size bytes of inputs at buf into *in,
+ * which holds the previous one (a zero tick for the first), and moves *pos
+ * past it. Returns 1, 0 at the end of the inputs and -1 if they're corrupt.
+ * It doesn't touch the error stack, so any thread can call it.
+ */
+int
+replay_next_input(const Uint8 *buf, Uint32 size, Uint32 *pos,
+                  struct ReplayInput *in);
+
+/**
+ * Decodes h->inputs_size bytes of inputs into out, which must have room for
+ * h->num_inputs of them.
+ */
+int
+replay_parse_inputs(const struct ReplayHeader *h, const Uint8 *buf,
+                    struct ReplayInput *out);
+
+/**
+ * Loads game number index (0 is the first, negative counts from the end) of
+ * a replay file. Free it with replay_free.
+ */
+int
+replay_load(const char *path, int index, struct Replay *r);
+
+void
+replay_free(struct Replay *r);
+
+#endif
@@ -0,0 +1,22 @@
+#include "ring.h"
+
+extern unsigned
+ring_slot(const struct Ring *r, unsigned i);
+
+extern unsigned
+ring_reserve(struct Ring *r, unsigned *room);
+
+extern void
+ring_publish(struct Ring *r, unsigned head, unsigned n);
+
+extern unsigned
+ring_peek(struct Ring *r, unsigned *n);
+
+extern void
+ring_release(struct Ring *r, unsigned tail, unsigned n);
+
+extern unsigned
+ring_published(struct Ring *r);
+
+extern void
+ring_reset(struct Ring *r);
@@ -0,0 +1,84 @@
+#ifndef RING_H
+#define RING_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Counters of a single producer single consumer ring. The slots are an array
+ * of the user's own, size of them, size a power of 2; the i-th value through
+ * the ring is in slot ring_slot(r, i). Head is only written by the producer
+ * and tail only by the consumer, and the barriers in here make what one side
+ * wrote to the slots visible to the other before the counter it moves.
+ *
+ * A ring that's statically {.size = N} starts out empty.
+ */
+struct Ring {
+  SDL_atomic_t head, tail;
+  unsigned size;
+};
+
+inline unsigned
+ring_slot(const struct Ring *r, unsigned i) {
+  return i & (r->size - 1);
+}
+
+/**
+ * Producer side: returns the index the next value goes at and sets *room to
+ * how many can go from there.
+ */
+inline unsigned
+ring_reserve(struct Ring *r, unsigned *room) {
+  unsigned head = SDL_AtomicGet(&r->head);
+  *room = r->size - (head - (unsigned) SDL_AtomicGet(&r->tail));
+  return head;
+}
+
+/**
+ * Producer side: hands the n values written from head on to the consumer.
+ */
+inline void
+ring_publish(struct Ring *r, unsigned head, unsigned n) {
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&r->head, (int) (head + n));
+}
+
+/**
+ * Consumer side: returns the index of the first value to take and sets *n to
+ * how many there are from there.
+ */
+inline unsigned
+ring_peek(struct Ring *r, unsigned *n) {
+  unsigned tail = SDL_AtomicGet(&r->tail);
+  *n = (unsigned) SDL_AtomicGet(&r->head) - tail;
+  SDL_MemoryBarrierAcquire();
+  return tail;
+}
+
+/**
+ * Consumer side: gives the n slots from tail on back to the producer.
+ */
+inline void
+ring_release(struct Ring *r, unsigned tail, unsigned n) {
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&r->tail, (int) (tail + n));
+}
+
+/**
+ * How many values were ever published.
+ */
+inline unsigned
+ring_published(struct Ring *r) {
+  return SDL_AtomicGet(&r->head);
+}
+
+/**
+ * Empties the ring and starts counting from 0 again. Only while neither side
+ * is using it.
+ */
+inline void
+ring_reset(struct Ring *r) {
+  SDL_AtomicSet(&r->head, 0);
+  SDL_AtomicSet(&r->tail, 0);
+}
+
+#endif
@@ -16,10 +16,14 @@ static const SDL_Color PANEL_BG_COLOR = {0, 0, 0, 255};
 static const SDL_Color PANEL_BORDER_COLOR = {255, 255, 255, 255};
 
 static struct TextImage exit_hint, title;
+// score_texts[i] shows scores[i]. A row without an image still needs to be
+// rasterized.
 static struct TextImage score_texts[NUM_SCORES];
 static int scores[NUM_SCORES];
 static int used_scores = 0;
 static SDL_Renderer *g_rend;
+// Nothing here changes by itself, so only focusing needs a redraw.
+static int dirty;
 static PixelDim2D screen_dim;
 
 static void
@@ -53,19 +57,27 @@ focus(void) {
   char score_chars[SCORE_CHARS_LIMIT];
   TTF_Font *medium_font = get_medium_font();
 
+  // Rows that only moved keep their image. Only new scores get rasterized.
   for (int i = 0; i < used_scores; i++) {
-    destroy_text_image(score_texts + i);
-    snprintf(score_chars, SCORE_CHARS_LIMIT, "%d", scores[i]);
-    COND_PRET_LT0(init_text_image(score_texts + i, medium_font, score_chars,
-      g_rend, &DEFAULT_FG_COLOR));
+    if (!score_texts[i].entry) {
+      snprintf(score_chars, SCORE_CHARS_LIMIT, "%d", scores[i]);
+      COND_PRET_LT0(init_text_image(score_texts + i, medium_font, score_chars,
+        g_rend, &DEFAULT_FG_COLOR));
+    }
     score_texts[i].pos.x = screen_dim.w/2 - score_texts[i].dim.w/2;
     score_texts[i].pos.y = 2*LARGE_FONT_SIZE + PADDING_PX*(i+1) +
       i*MEDIUM_FONT_SIZE;
   }
 
+  dirty = 1;
   return 0;
 }
 
+static int
+is_dirty(void) {
+  return dirty;
+}
+
 static int
 render(void) {
   COND_PRET_LT0(render_text_image(&title));
@@ -75,6 +87,7 @@ render(void) {
     COND_PRET_LT0(render_text_image(score_texts + i));
   }
 
+  dirty = 0;
   return 0;
 }
 
@@ -105,7 +118,8 @@ init_scores(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_) {
     .render = render,
     .update = update,
     .handle_event = handle_event,
-    .destroy = destroy
+    .destroy = destroy,
+    .is_dirty = is_dirty
   };
   register_screen(SCORES_SCREEN, &self);
 
@@ -118,15 +132,26 @@ e_cleanup:
 
 void
 add_score(int score) {
+  // The images move along with their scores, so the new one starts without
+  // an image.
+  struct TextImage text = {0};
   for (int i = 0; i < used_scores; i++) {
     if (scores[i] < score) {
       int aux = scores[i];
       scores[i] = score;
       score = aux;
+
+      struct TextImage aux_text = score_texts[i];
+      score_texts[i] = text;
+      text = aux_text;
     }
   }
   if (used_scores < NUM_SCORES) {
     scores[used_scores] = score;
+    score_texts[used_scores] = text;
     used_scores++;
   }
+  else {
+    destroy_text_image(&text);
+  }
 }
@@ -4,15 +4,29 @@
 #include <SDL2/SDL.h>
 
 #include "2D.h"
+#include "board.h"
 
 enum ScreenId {
-  MENU_SCREEN, GAME_SCREEN, SCORES_SCREEN
+  MENU_SCREEN, GAME_SCREEN, SCORES_SCREEN, TOURNAMENT_SCREEN
 };
 
 static const struct SDL_Color DEFAULT_FG_COLOR = {225, 225, 225, 255};
 
+/**
+ * One color per kind of piece, indexed by piece number.
+ */
+static const struct SDL_Color PIECE_COLORS[NUM_DIFFERENT_PIECES] = {
+  {255, 0,   0,   255},
+  {0,   255, 0,   255},
+  {0,   0,   255, 255},
+  {255, 255, 0,   255},
+  {255, 0,   255, 255},
+  {0,   255, 255, 255},
+  {0,   128, 255, 255}
+};
+
 enum {
-  NUM_SCREENS = 3
+  NUM_SCREENS = 4
 };
 
 struct GameContext {
@@ -25,6 +39,7 @@ typedef int (*ScreenHandleEventFn)(const SDL_Event *e);
 typedef int (*ScreenUpdateFn)(void);
 typedef int (*ScreenRenderFn)(void);
 typedef int (*ScreenFocusFn)(void);
+typedef int (*ScreenIsDirtyFn)(void);
 
 struct ScreenObject {
   ScreenDestroyFn destroy;
@@ -32,6 +47,14 @@ struct ScreenObject {
   ScreenUpdateFn update;
   ScreenRenderFn render;
   ScreenFocusFn focus;
+
+  /**
+   * Optional. Returns whether the screen looks any different from the last
+   * time it was rendered. While it doesn't, the game loop sleeps until an
+   * event comes instead of redrawing the same frame. Screens without it are
+   * redrawn every frame.
+   */
+  ScreenIsDirtyFn is_dirty;
 };
 
 /**
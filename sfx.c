@@ -0,0 +1,278 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#include "error.h"
+#include "percentile.h"
+#include "ring.h"
+#include "sfx.h"
+
+enum {
+  // Must be a power of 2.
+  RING_SIZE = 64,
+
+  // Group tag of the effects' channels.
+  SFX_GROUP = 1,
+
+  // Latency samples kept. Past that, the oldest ones are overwritten.
+  MAX_SAMPLES = 1024
+};
+
+/*
+ * Where each effect comes from and, if its file isn't there, what it
+ * sounds like instead: up to 4 tones (in Hz, 0 ends them) note_ms long
+ * each, fading out.
+ */
+struct Sound {
+  const char *file;
+  int notes[4];
+  int note_ms;
+  double volume;
+};
+
+static const struct Sound SOUNDS[NUM_SFX] = {
+  [SFX_MOVE] = {"sfx_move.wav", {880}, 25, 0.15},
+  [SFX_ROTATE] = {"sfx_rotate.wav", {660, 990}, 20, 0.15},
+  [SFX_LOCK] = {"sfx_lock.wav", {110}, 70, 0.3},
+  [SFX_LINES] = {"sfx_lines.wav", {523, 784}, 60, 0.25},
+  [SFX_TETRIS] = {"sfx_tetris.wav", {523, 659, 784, 1047}, 60, 0.25}
+};
+
+struct Trigger {
+  Uint8 kind;
+  // Performance counter at sfx_play.
+  Uint64 at;
+};
+
+// From the game (producer) to the worker (consumer).
+static struct Trigger triggers[RING_SIZE];
+static struct Ring ring = {.size = RING_SIZE};
+static SDL_sem *wake;
+static SDL_Thread *thread;
+static SDL_atomic_t running;
+
+static Mix_Chunk *chunks[NUM_SFX];
+// Samples of the synthesized chunks, which Mix_QuickLoad_RAW doesn't own.
+static Uint8 *synth_samples[NUM_SFX];
+
+// When the effect each channel got started for was triggered, until the
+// mixer gets to it. Set by the worker before registering on_mix, cleared by
+// on_mix on the audio thread.
+static Uint64 triggered_at[SFX_CHANNELS];
+
+// Trigger to mixed, in microseconds. Audio thread only.
+static Uint32 samples[MAX_SAMPLES];
+static Uint32 num_samples;
+
+static double us_per_count;
+static int buffer_ms;
+// Worker side (stolen voices, triggers with no channel to go to) and
+// producer side (ring full) counts.
+static Uint32 stolen, missed, dropped;
+
+/**
+ * Makes the chunk for s out of its tones, in the device's format. Leaves it
+ * null (the effect stays quiet) if that's not 16 bit samples.
+ */
+static int
+synthesize(const struct Sound *s, Mix_Chunk **chunk, Uint8 **buf) {
+  int freq, channels;
+  Uint16 format;
+  COND_ERET_IF0(Mix_QuerySpec(&freq, &format, &channels), -1,
+    Mix_GetError());
+  if (format != AUDIO_S16SYS) {
+    return 0;
+  }
+
+  int num_notes = 0;
+  while (num_notes < 4 && s->notes[num_notes]) {
+    num_notes++;
+  }
+  int note_frames = freq*s->note_ms/1000;
+  int frames = note_frames*num_notes;
+  Sint16 *out = SDL_malloc(frames*channels*sizeof *out);
+  COND_ERET_IF0(out, -1, "Out of memory.");
+
+  double phase = 0;
+  for (int i = 0; i < frames; i++) {
+    phase += 6.283185307179586*s->notes[i/note_frames]/freq;
+    // Each note fades out, so they don't click into each other.
+    double fade = 1 - (double) (i % note_frames)/note_frames;
+    Sint16 v = (Sint16) (SDL_sin(phase)*fade*s->volume*32767);
+    for (int c = 0; c < channels; c++) {
+      out[i*channels + c] = v;
+    }
+  }
+  *buf = (Uint8*) out;
+  *chunk = Mix_QuickLoad_RAW(*buf, frames*channels*sizeof *out);
+  COND_ERET_IF0(*chunk, -1, Mix_GetError());
+  return 0;
+}
+
+static int
+load_sounds(void) {
+  for (int i = 0; i < NUM_SFX; i++) {
+    // Decoded and converted to the device's format, once.
+    chunks[i] = Mix_LoadWAV(SOUNDS[i].file);
+    if (!chunks[i]) {
+      COND_PRET_LT0(synthesize(SOUNDS + i, chunks + i, synth_samples + i));
+    }
+  }
+  return 0;
+}
+
+/**
+ * Mixer effect on a channel that just got started: notes how long its
+ * trigger took to get mixed. It leaves the samples alone.
+ */
+static void
+on_mix(int channel, void *stream, int len, void *unused) {
+  (void) stream;
+  (void) len;
+  (void) unused;
+  Uint64 at = triggered_at[channel];
+  if (!at) {
+    return;
+  }
+  triggered_at[channel] = 0;
+  Uint64 now = SDL_GetPerformanceCounter();
+  samples[num_samples % MAX_SAMPLES] =
+    now > at ? (Uint32) ((now - at)*us_per_count) : 0;
+  num_samples++;
+}
+
+static void
+start(const struct Trigger *t) {
+  Mix_Chunk *chunk = chunks[t->kind];
+  if (!chunk) {
+    return;
+  }
+  int channel = Mix_GroupAvailable(SFX_GROUP);
+  if (channel < 0) {
+    // All busy: cut off the one that's been playing the longest, it's the
+    // least missed.
+    channel = Mix_GroupOldest(SFX_GROUP);
+    if (channel >= 0) {
+      Mix_HaltChannel(channel);
+      stolen++;
+    } else {
+      // None playing either: one must have just finished.
+      channel = Mix_GroupAvailable(SFX_GROUP);
+    }
+  }
+  if (channel < 0) {
+    missed++;
+    return;
+  }
+  // Whatever on_mix was left from the last time goes, so there's one.
+  Mix_UnregisterAllEffects(channel);
+  triggered_at[channel] = t->at;
+  if (!Mix_RegisterEffect(channel, on_mix, 0, 0)
+      || Mix_PlayChannel(channel, chunk, 0) < 0)
+  {
+    // Nothing to do about it but stay quiet.
+    triggered_at[channel] = 0;
+  }
+}
+
+static int
+worker(void *unused) {
+  (void) unused;
+  while (SDL_AtomicGet(&running)) {
+    SDL_SemWait(wake);
+    unsigned n;
+    unsigned tail = ring_peek(&ring, &n);
+    for (unsigned i = 0; i < n; i++) {
+      start(triggers + ring_slot(&ring, tail + i));
+    }
+    ring_release(&ring, tail, n);
+  }
+  return 0;
+}
+
+int
+init_sfx(int buffer_frames) {
+  us_per_count = 1e6/SDL_GetPerformanceFrequency();
+  int freq, channels;
+  Uint16 format;
+  COND_ERET_IF0(Mix_QuerySpec(&freq, &format, &channels), -1,
+    Mix_GetError());
+  buffer_ms = buffer_frames*1000/freq;
+
+  COND_ERET(Mix_AllocateChannels(SFX_CHANNELS) < SFX_CHANNELS, -1,
+    Mix_GetError());
+  Mix_GroupChannels(0, SFX_CHANNELS - 1, SFX_GROUP);
+  COND_EGOTO_LT0(load_sounds(), e_cleanup, 0);
+
+  wake = SDL_CreateSemaphore(0);
+  COND_EGOTO_IF0(wake, e_cleanup, SDL_GetError());
+  SDL_AtomicSet(&running, 1);
+  thread = SDL_CreateThread(worker, "sfx", 0);
+  COND_EGOTO_IF0(thread, e_cleanup, SDL_GetError());
+  return 0;
+
+e_cleanup:
+  destroy_sfx();
+  return -1;
+}
+
+void
+sfx_play(enum SfxKind kind) {
+  if (!thread) {
+    return;
+  }
+  unsigned room;
+  unsigned head = ring_reserve(&ring, &room);
+  if (!room) {
+    dropped++;
+    return;
+  }
+  triggers[ring_slot(&ring, head)] = (struct Trigger) {
+    .kind = kind,
+    .at = SDL_GetPerformanceCounter()
+  };
+  ring_publish(&ring, head, 1);
+  // Never waits, unlike a lock.
+  SDL_SemPost(wake);
+}
+
+static void
+log_latency(void) {
+  static Uint32 sorted[MAX_SAMPLES];
+  Uint32 n = SDL_min(num_samples, (Uint32) MAX_SAMPLES);
+  if (!n) {
+    return;
+  }
+  SDL_memcpy(sorted, samples, n*sizeof *sorted);
+  sort_u32(sorted, n);
+  SDL_Log("sfx: %u effects, trigger to mixed (us): p50 %u, p90 %u, p99 %u, "
+    "max %u; the %d ms audio buffer comes on top", num_samples,
+    percentile(sorted, n, 50), percentile(sorted, n, 90),
+    percentile(sorted, n, 99), sorted[n - 1], buffer_ms);
+  SDL_Log("sfx: %u voices stolen, %u triggers with no channel, %u triggers "
+    "dropped", stolen, missed, dropped);
+}
+
+void
+destroy_sfx(void) {
+  if (thread) {
+    SDL_AtomicSet(&running, 0);
+    SDL_SemPost(wake);
+    SDL_WaitThread(thread, 0);
+    thread = 0;
+    // Nothing of theirs can be playing when they get freed.
+    Mix_HaltChannel(-1);
+  }
+  if (wake) {
+    SDL_DestroySemaphore(wake);
+    wake = 0;
+  }
+  for (int i = 0; i < NUM_SFX; i++) {
+    if (chunks[i]) {
+      Mix_FreeChunk(chunks[i]);
+      chunks[i] = 0;
+    }
+    SDL_free(synth_samples[i]);
+    synth_samples[i] = 0;
+  }
+  log_latency();
+}
@@ -0,0 +1,51 @@
+#ifndef SFX_H
+#define SFX_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Sound effects. Each one is decoded (or, without its file, synthesized)
+ * once, in the audio device's format, and played on a pool of
+ * SFX_CHANNELS mixer channels of its own. When all of them are busy, the
+ * one playing the longest gets cut off.
+ *
+ * sfx_play only puts the effect on a ring, so it can be called from the
+ * game's simulation thread: no allocation, no locks. A worker thread takes
+ * effects off it and starts them. Music is a separate stream, so effects
+ * never queue behind it.
+ *
+ * How long effects take from sfx_play to getting mixed into the audio
+ * device's buffer is measured, and logged by destroy_sfx. The buffer itself
+ * adds up to its own length on top of that.
+ */
+
+enum SfxKind {
+  SFX_MOVE,
+  SFX_ROTATE,
+  SFX_LOCK,
+  SFX_LINES,
+  SFX_TETRIS,
+  NUM_SFX
+};
+
+enum {
+  SFX_CHANNELS = 8
+};
+
+/**
+ * Call after the audio device got opened (init_music) with buffer_frames
+ * frames per buffer.
+ */
+int
+init_sfx(int buffer_frames);
+
+void
+destroy_sfx(void);
+
+/**
+ * Does nothing if init_sfx wasn't called, or if the ring is full.
+ */
+void
+sfx_play(enum SfxKind kind);
+
+#endif
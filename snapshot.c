@@ -0,0 +1,170 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include "bytes.h"
+#include "error.h"
+#include "snapshot.h"
+
+enum {
+  MAX_PATH = 256
+};
+
+static Uint32 crc_table[256];
+
+/**
+ * CRC-32 as in zlib (reflected, polynomial 0xEDB88320), a byte at a time.
+ */
+Uint32
+snapshot_crc32(const void *data, size_t size) {
+  if (!crc_table[1]) {
+    for (Uint32 i = 0; i < 256; i++) {
+      Uint32 c = i;
+      for (int k = 0; k < 8; k++) {
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      crc_table[i] = c;
+    }
+  }
+  const Uint8 *p = data;
+  Uint32 c = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    c = crc_table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+  }
+  return c ^ 0xFFFFFFFFu;
+}
+
+static int
+write_all(int fd, const void *data, size_t size) {
+  const Uint8 *p = data;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    COND_ERET(n <= 0, -1, strerror(errno));
+    p += n;
+    size -= n;
+  }
+  return 0;
+}
+
+/**
+ * Flushes the directory path is in, so a rename in it is on disk too.
+ */
+static void
+sync_dir(const char *path) {
+  char dir[MAX_PATH];
+  const char *slash = strrchr(path, '/');
+  if (slash) {
+    size_t len = SDL_min((size_t) (slash - path) + 1, sizeof dir - 1);
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+  }
+  else {
+    strcpy(dir, ".");
+  }
+  int fd = open(dir, O_RDONLY);
+  if (fd >= 0) {
+    // Not every file system can; the rename went through anyway.
+    fsync(fd);
+    close(fd);
+  }
+}
+
+int
+snapshot_save(const char *path, Uint32 version, const void *data,
+              Uint32 size)
+{
+  char tmp_path[MAX_PATH];
+  COND_ERET(snprintf(tmp_path, sizeof tmp_path, "%s.tmp", path)
+    >= (int) sizeof tmp_path, -1, "Snapshot path too long.");
+
+  Uint8 header[SNAPSHOT_HEADER_SIZE] = {'T', 'S', 'N', 'P'};
+  Uint8 *p = header + 4;
+  p = put_u32(p, version);
+  p = put_u32(p, size);
+  put_u32(p, snapshot_crc32(data, size));
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  COND_ERET_LT0(fd, strerror(errno));
+  COND_EGOTO_LT0(write_all(fd, header, sizeof header), e_cleanup, 0);
+  COND_EGOTO_LT0(write_all(fd, data, size), e_cleanup, 0);
+  // Without this, the rename could reach the disk before the data does.
+  COND_EGOTO_LT0(fsync(fd), e_cleanup, strerror(errno));
+  COND_EGOTO_LT0(close(fd), e_unlink, strerror(errno));
+  COND_EGOTO_LT0(rename(tmp_path, path), e_unlink, strerror(errno));
+  sync_dir(path);
+  return 0;
+
+e_cleanup:
+  close(fd);
+e_unlink:
+  unlink(tmp_path);
+  return -1;
+}
+
+static int
+read_all(int fd, void *data, size_t size) {
+  Uint8 *p = data;
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    COND_ERET(n < 0, -1, strerror(errno));
+    if (n == 0) {
+      // Cut short.
+      return 0;
+    }
+    p += n;
+    size -= n;
+  }
+  return 1;
+}
+
+int
+snapshot_load(const char *path, Uint32 version, void *data, Uint32 max_size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    COND_ERET(errno != ENOENT, -1, strerror(errno));
+    return 0;
+  }
+
+  int ret = 0;
+  Uint8 header[SNAPSHOT_HEADER_SIZE];
+  int got = read_all(fd, header, sizeof header);
+  COND_EGOTO_LT0(got, e_cleanup, 0);
+  if (!got || memcmp(header, "TSNP", 4) || get_u32(header + 4) != version) {
+    goto done;
+  }
+  Uint32 size = get_u32(header + 8);
+  if (size > max_size) {
+    goto done;
+  }
+  got = read_all(fd, data, size);
+  COND_EGOTO_LT0(got, e_cleanup, 0);
+  if (got && snapshot_crc32(data, size) == get_u32(header + 12)) {
+    ret = size;
+  }
+
+done:
+  close(fd);
+  return ret;
+
+e_cleanup:
+  close(fd);
+  return -1;
+}
+
+int
+snapshot_remove(const char *path) {
+  COND_ERET(unlink(path) < 0 && errno != ENOENT, -1, strerror(errno));
+  return 0;
+}
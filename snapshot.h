@@ -0,0 +1,49 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Snapshot files: a blob of state that has to survive the program going
+ * away. Each file is (little endian):
+ *
+ *   "TSNP"     magic
+ *   u32        version of what's in the blob
+ *   u32        size of the blob
+ *   u32        CRC-32 of the blob
+ *   blob
+ *
+ * Saving writes a temporary file next to the real one, flushes it to disk
+ * and renames it over the real one, so whatever happens halfway through,
+ * the file is either the old snapshot or the new one.
+ */
+
+enum {
+  SNAPSHOT_HEADER_SIZE = 16
+};
+
+int
+snapshot_save(const char *path, Uint32 version, const void *data,
+              Uint32 size);
+
+/**
+ * Reads the blob of the snapshot at path into data. Returns its size, 0 if
+ * there's no snapshot usable there (no file, another version, bigger than
+ * max_size or a bad checksum) and -1 on errors.
+ */
+int
+snapshot_load(const char *path, Uint32 version, void *data, Uint32 max_size);
+
+/**
+ * Deletes the snapshot at path. It not being there is fine.
+ */
+int
+snapshot_remove(const char *path);
+
+/**
+ * CRC-32 (the zlib one) of size bytes at data.
+ */
+Uint32
+snapshot_crc32(const void *data, size_t size);
+
+#endif
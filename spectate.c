@@ -0,0 +1,445 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "board.h"
+#include "bytes.h"
+#include "delta.h"
+#include "ring.h"
+#include "spectate.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+enum {
+  // Must be a power of 2.
+  RING_SIZE = 4096,
+
+  MAX_SPECTATORS = 64,
+  SPECTATOR_BUF_SIZE = 8192,
+
+  // How often the worker wakes up to encode and send what was queued.
+  FLUSH_INTERVAL_MS = 20,
+
+  // A keyframe goes to everyone every so many pieces so spectators that fell
+  // behind (and got their backlog thrown away) can catch up.
+  KEYFRAME_INTERVAL = 16,
+
+  // Event types that only exist between the game and the worker.
+  EV_ROW = 'W',
+  EV_SYNCED = 'Y'
+};
+
+/*
+ * What the game queues for the worker. The type is one of DeltaMsgType or
+ * EV_*. The payload is not the wire format: coalescing moves and keeping the
+ * mirror board is the worker's job.
+ */
+struct SpecEvent {
+  Uint8 type;
+  Uint8 data[7];
+};
+
+struct Spectator {
+  int fd;
+  int synced;
+  int used;
+  // Bytes at the start of out that are what's left of a message partly sent
+  // already. They have to go out before anything else does.
+  int in_flight;
+  Uint8 out[SPECTATOR_BUF_SIZE];
+};
+
+// From the game (producer) to the worker (consumer).
+static struct SpecEvent events[RING_SIZE];
+static struct Ring ring = {.size = RING_SIZE};
+
+// Producer side state.
+static int started;
+static int desynced;
+static int dropped;
+
+// Worker side state.
+static SDL_Thread *thread;
+static SDL_atomic_t running;
+static int listen_fd = -1;
+static struct Spectator spectators[MAX_SPECTATORS];
+static struct DeltaBoard mirror;
+static int pending_dx, pending_dy;
+static Uint64 bytes_out;
+static Uint32 pieces_out;
+
+static int
+push_event(const struct SpecEvent *ev) {
+  unsigned room;
+  unsigned head = ring_reserve(&ring, &room);
+  if (!room) {
+    return -1;
+  }
+  events[ring_slot(&ring, head)] = *ev;
+  ring_publish(&ring, head, 1);
+  return 0;
+}
+
+static void
+notify(const struct SpecEvent *ev) {
+  if (!started || desynced) {
+    return;
+  }
+  if (push_event(ev) < 0) {
+    desynced = 1;
+    dropped++;
+  }
+}
+
+static void
+drop_spectator(struct Spectator *s) {
+  close(s->fd);
+  s->fd = -1;
+}
+
+static void
+queue_to(struct Spectator *s, const Uint8 *msg, int len) {
+  if (s->used + len > SPECTATOR_BUF_SIZE) {
+    // This one isn't keeping up. Throw its backlog away, except for the end
+    // of the message it's in the middle of receiving, and let it catch up
+    // on the next keyframe.
+    s->used = s->in_flight;
+    s->synced = 0;
+    return;
+  }
+  SDL_memcpy(s->out + s->used, msg, len);
+  s->used += len;
+}
+
+static void
+broadcast(const Uint8 *msg, int len) {
+  ERR_IGNORE(delta_apply(&mirror, msg, len));
+  for (int i = 0; i < MAX_SPECTATORS; i++) {
+    if (spectators[i].fd >= 0 && spectators[i].synced) {
+      queue_to(spectators + i, msg, len);
+    }
+  }
+}
+
+static void
+broadcast_keyframe(void) {
+  Uint8 msg[DELTA_MAX_MSG_LEN];
+  int len = delta_put_keyframe(msg, &mirror);
+  for (int i = 0; i < MAX_SPECTATORS; i++) {
+    if (spectators[i].fd >= 0) {
+      spectators[i].synced = 1;
+      queue_to(spectators + i, msg, len);
+    }
+  }
+}
+
+static void
+flush_move(void) {
+  Uint8 msg[DELTA_MAX_MSG_LEN];
+  while (pending_dx || pending_dy) {
+    int dx = SDL_max(DELTA_MOVE_MIN, SDL_min(DELTA_MOVE_MAX, pending_dx));
+    int dy = SDL_max(DELTA_MOVE_MIN, SDL_min(DELTA_MOVE_MAX, pending_dy));
+    broadcast(msg, delta_put_move(msg, dx, dy));
+    pending_dx -= dx;
+    pending_dy -= dy;
+  }
+}
+
+static void
+encode_event(const struct SpecEvent *ev) {
+  Uint8 msg[DELTA_MAX_MSG_LEN];
+  const Uint8 *d = ev->data;
+
+  if (ev->type == DELTA_MOVE) {
+    pending_dx += (Sint8) d[0];
+    pending_dy += (Sint8) d[1];
+    return;
+  }
+  flush_move();
+
+  switch (ev->type) {
+    case DELTA_NEW_GAME:
+    case DELTA_FIXATE:
+      broadcast(msg, delta_put_simple(msg, ev->type));
+      break;
+    case DELTA_SPAWN:
+      broadcast(msg, delta_put_spawn(msg, d[0], d[1], d + 2));
+      pieces_out++;
+      if (mirror.pieces % KEYFRAME_INTERVAL == 0) {
+        broadcast_keyframe();
+      }
+      break;
+    case DELTA_SHAPE:
+      broadcast(msg, delta_put_shape(msg, d));
+      break;
+    case DELTA_LINES:
+      broadcast(msg, delta_put_lines(msg, get_u32(d)));
+      break;
+    case DELTA_SCORE:
+      broadcast(msg, delta_put_score(msg, get_u32(d)));
+      break;
+    case EV_ROW:
+      for (int j = 0; j < PANEL_COLS; j++) {
+        mirror.cells[d[0]][j] = (d[1 + j/2] >> (j%2 ? 4 : 0)) & 0x0F;
+      }
+      break;
+    case EV_SYNCED:
+      mirror.points = get_u32(d);
+      mirror.piece_kind = 0;
+      broadcast_keyframe();
+      break;
+  }
+}
+
+static void
+drain_events(void) {
+  unsigned n;
+  unsigned tail = ring_peek(&ring, &n);
+  for (unsigned i = 0; i < n; i++) {
+    encode_event(events + ring_slot(&ring, tail + i));
+    // Each slot goes back as soon as it's done with, so the game has room
+    // while the rest get sent.
+    ring_release(&ring, tail + i, 1);
+  }
+  flush_move();
+}
+
+static void
+accept_spectators(void) {
+  int fd;
+  while ((fd = accept(listen_fd, 0, 0)) >= 0) {
+    int slot = -1;
+    for (int i = 0; i < MAX_SPECTATORS && slot < 0; i++) {
+      if (spectators[i].fd < 0) {
+        slot = i;
+      }
+    }
+    if (slot < 0 || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+      close(fd);
+      continue;
+    }
+    struct Spectator *s = spectators + slot;
+    s->fd = fd;
+    s->used = 0;
+    s->in_flight = 0;
+    s->synced = 1;
+    Uint8 msg[DELTA_MAX_MSG_LEN];
+    queue_to(s, msg, delta_put_keyframe(msg, &mirror));
+  }
+}
+
+/**
+ * After n bytes of s->out went out, works out how much of the message they
+ * ended in is still to go.
+ */
+static void
+track_in_flight(struct Spectator *s, int n) {
+  if (n <= s->in_flight) {
+    s->in_flight -= n;
+    return;
+  }
+  int pos = s->in_flight;
+  s->in_flight = 0;
+  while (pos < n) {
+    // Only whole messages get queued, so this always finds one.
+    int len = delta_msg_len(s->out + pos, s->used - pos);
+    if (len <= 0) {
+      break;
+    }
+    if (pos + len > n) {
+      s->in_flight = pos + len - n;
+    }
+    pos += len;
+  }
+}
+
+static void
+send_pending(void) {
+  for (int i = 0; i < MAX_SPECTATORS; i++) {
+    struct Spectator *s = spectators + i;
+    if (s->fd < 0 || s->used == 0) {
+      continue;
+    }
+    ssize_t n = send(s->fd, s->out, s->used, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        drop_spectator(s);
+      }
+      continue;
+    }
+    bytes_out += n;
+    track_in_flight(s, n);
+    s->used -= n;
+    SDL_memmove(s->out, s->out + n, s->used);
+  }
+}
+
+static int
+worker(void *unused) {
+  (void) unused;
+  while (SDL_AtomicGet(&running)) {
+    accept_spectators();
+    drain_events();
+    send_pending();
+    SDL_Delay(FLUSH_INTERVAL_MS);
+  }
+  drain_events();
+  send_pending();
+  return 0;
+}
+
+int
+spectate_start(int port) {
+  SDL_assert(!started);
+
+  for (int i = 0; i < MAX_SPECTATORS; i++) {
+    spectators[i].fd = -1;
+  }
+  delta_reset(&mirror);
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  COND_ERET_LT0(listen_fd, "Couldn't create the spectator socket.");
+
+  int yes = 1;
+  ERR_IGNORE(setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes,
+    sizeof yes));
+
+  struct sockaddr_in addr;
+  SDL_memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  COND_EGOTO_LT0(bind(listen_fd, (struct sockaddr *) &addr, sizeof addr),
+    e_cleanup, "Couldn't bind the spectator port.");
+  COND_EGOTO_LT0(listen(listen_fd, MAX_SPECTATORS), e_cleanup,
+    "Couldn't listen on the spectator port.");
+  COND_EGOTO_LT0(fcntl(listen_fd, F_SETFL, O_NONBLOCK), e_cleanup,
+    "Couldn't make the spectator socket non blocking.");
+
+  SDL_AtomicSet(&running, 1);
+  thread = SDL_CreateThread(worker, "spectate", 0);
+  COND_EGOTO_IF0(thread, e_cleanup, SDL_GetError());
+
+  started = 1;
+  return 0;
+
+e_cleanup:
+  close(listen_fd);
+  listen_fd = -1;
+  return -1;
+}
+
+void
+spectate_stop(void) {
+  if (!started) {
+    return;
+  }
+  SDL_AtomicSet(&running, 0);
+  SDL_WaitThread(thread, 0);
+  thread = 0;
+  for (int i = 0; i < MAX_SPECTATORS; i++) {
+    if (spectators[i].fd >= 0) {
+      drop_spectator(spectators + i);
+    }
+  }
+  close(listen_fd);
+  listen_fd = -1;
+  started = 0;
+  if (pieces_out > 0) {
+    SDL_Log("spectate: %lu bytes sent, %u pieces, %d dropped events",
+      (unsigned long) bytes_out, (unsigned) pieces_out, dropped);
+  }
+}
+
+void
+spectate_new_game(void) {
+  struct SpecEvent ev = {.type = DELTA_NEW_GAME};
+  notify(&ev);
+}
+
+void
+spectate_spawn(int kind, int next_kind, const Uint8 cells[NUM_PIECE_PARTS]) {
+  struct SpecEvent ev = {.type = DELTA_SPAWN};
+  ev.data[0] = kind + 1;
+  ev.data[1] = next_kind + 1;
+  SDL_memcpy(ev.data + 2, cells, NUM_PIECE_PARTS);
+  notify(&ev);
+}
+
+void
+spectate_move(int dx, int dy) {
+  struct SpecEvent ev = {.type = DELTA_MOVE};
+  ev.data[0] = (Uint8) (Sint8) dx;
+  ev.data[1] = (Uint8) (Sint8) dy;
+  notify(&ev);
+}
+
+void
+spectate_shape(const Uint8 cells[NUM_PIECE_PARTS]) {
+  struct SpecEvent ev = {.type = DELTA_SHAPE};
+  SDL_memcpy(ev.data, cells, NUM_PIECE_PARTS);
+  notify(&ev);
+}
+
+void
+spectate_fixate(void) {
+  struct SpecEvent ev = {.type = DELTA_FIXATE};
+  notify(&ev);
+}
+
+void
+spectate_lines(Uint32 row_mask) {
+  struct SpecEvent ev = {.type = DELTA_LINES};
+  put_u32(ev.data, row_mask);
+  notify(&ev);
+}
+
+void
+spectate_score(int points) {
+  struct SpecEvent ev = {.type = DELTA_SCORE};
+  put_u32(ev.data, (Uint32) points);
+  notify(&ev);
+}
+
+int
+spectate_desynced(void) {
+  return started && desynced;
+}
+
+void
+spectate_resync(Uint8 cells[PANEL_ROWS][PANEL_COLS], int points) {
+  if (!started) {
+    return;
+  }
+  unsigned room;
+  ring_reserve(&ring, &room);
+  if (room < PANEL_ROWS + 1) {
+    // Still no room. Try again later.
+    return;
+  }
+
+  for (int i = 0; i < PANEL_ROWS; i++) {
+    struct SpecEvent ev = {.type = EV_ROW};
+    ev.data[0] = i;
+    for (int j = 0; j < PANEL_COLS; j += 2) {
+      ev.data[1 + j/2] = (cells[i][j] & 0x0F) | (cells[i][j+1] & 0x0F) << 4;
+    }
+    ERR_IGNORE(push_event(&ev));
+  }
+  struct SpecEvent ev = {.type = EV_SYNCED};
+  put_u32(ev.data, (Uint32) points);
+  ERR_IGNORE(push_event(&ev));
+  desynced = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+
+/*
+ * Spectator feed. Once started, a local TCP server streams the game being
+ * played to every connected viewer using the format in delta.h.
+ *
+ * The spectate_* notification functions are meant to be called from the game
+ * screen. They only queue a few bytes; encoding and sending happen on a
+ * worker thread. They're no-ops if the feed wasn't started.
+ */
+
+int
+spectate_start(int port);
+
+void
+spectate_stop(void);
+
+void
+spectate_new_game(void);
+
+void
+spectate_spawn(int kind, int next_kind, const Uint8 cells[NUM_PIECE_PARTS]);
+
+void
+spectate_move(int dx, int dy);
+
+void
+spectate_shape(const Uint8 cells[NUM_PIECE_PARTS]);
+
+void
+spectate_fixate(void);
+
+void
+spectate_lines(Uint32 row_mask);
+
+void
+spectate_score(int points);
+
+/**
+ * If the worker falls too far behind, notifications get dropped and the
+ * spectators' view of the board can't be trusted anymore. This tells when
+ * that happened, in which case spectate_resync should be called.
+ */
+int
+spectate_desynced(void);
+
+/**
+ * Sends the whole board over. Cells are 0 for empty and piece kind + 1
+ * otherwise. Call it while there is no falling piece (right before a spawn
+ * is the natural place).
+ */
+void
+spectate_resync(Uint8 cells[PANEL_ROWS][PANEL_COLS], int points);
+
+#endif
@@ -0,0 +1,226 @@
+#include <SDL2/SDL.h>
+
+#include "bytes.h"
+#include "error.h"
+#include "ring.h"
+#include "stats.h"
+
+static const char *STATS_FILE = "stats.bin";
+
+enum {
+  // Finished games waiting for the writer. Must be a power of 2.
+  QUEUE_SIZE = 4,
+  MAX_RECORD_SIZE = 4*4 + 4*2 + STATS_INTERVAL_BUCKETS*2 + 2*2 +
+    STATS_MAX_SAMPLES + STATS_MAX_SAMPLES*4
+};
+
+static struct GameStats game;
+static struct SessionStats session;
+
+// Finished games, from the game (producer) to the writer (consumer).
+static struct GameStats queue[QUEUE_SIZE];
+static struct Ring ring = {.size = QUEUE_SIZE};
+static SDL_sem *queued;
+static SDL_atomic_t quit;
+static SDL_Thread *writer;
+static int dropped;
+static SDL_atomic_t write_failures;
+
+static int
+encode(const struct GameStats *g, Uint8 *out) {
+  Uint8 *p = out;
+  p = put_u32(p, g->end_ms - g->start_ms);
+  p = put_u32(p, g->points);
+  p = put_u32(p, g->pieces);
+  p = put_u32(p, g->inputs);
+  for (int i = 0; i < 4; i++) {
+    p = put_u16(p, g->clears[i]);
+  }
+  for (int i = 0; i < STATS_INTERVAL_BUCKETS; i++) {
+    p = put_u16(p, g->intervals[i]);
+  }
+  p = put_u16(p, g->sample_period);
+  p = put_u16(p, g->num_samples);
+  SDL_memcpy(p, g->heights, g->num_samples);
+  p += g->num_samples;
+  for (int i = 0; i < g->num_samples; i++) {
+    p = put_u32(p, g->scores[i]);
+  }
+  return p - out;
+}
+
+/**
+ * Appends g to the statistics file. This runs on the writer thread, which
+ * can't touch the error stack: failing is logged here.
+ */
+static int
+write_record(const struct GameStats *g) {
+  static Uint8 record[MAX_RECORD_SIZE];
+
+  SDL_RWops *f = SDL_RWFromFile(STATS_FILE, "ab");
+  if (!f) {
+    SDL_Log("stats: can't open %s: %s", STATS_FILE, SDL_GetError());
+    return -1;
+  }
+  if (SDL_RWseek(f, 0, RW_SEEK_END) == 0) {
+    const Uint8 header[] = {'T', 'S', 'T', 'A', STATS_VERSION};
+    SDL_RWwrite(f, header, sizeof header, 1);
+  }
+  int len = encode(g, record);
+  int written = SDL_RWwrite(f, record, len, 1);
+  if (SDL_RWclose(f) < 0 || written != 1) {
+    SDL_Log("stats: can't write %s: %s", STATS_FILE, SDL_GetError());
+    return -1;
+  }
+  return 0;
+}
+
+static int
+write_records(void *unused) {
+  (void) unused;
+  for (;;) {
+    SDL_SemWait(queued);
+    unsigned n;
+    unsigned tail = ring_peek(&ring, &n);
+    if (!n) {
+      // Woken up with nothing to write: it's time to go.
+      SDL_assert(SDL_AtomicGet(&quit));
+      return 0;
+    }
+    // Statistics aren't worth stopping the game for: a record that can't
+    // be written is just lost.
+    if (write_record(queue + ring_slot(&ring, tail)) < 0) {
+      SDL_AtomicAdd(&write_failures, 1);
+    }
+    ring_release(&ring, tail, 1);
+  }
+}
+
+int
+init_stats(void) {
+  queued = SDL_CreateSemaphore(0);
+  COND_ERET_IF0(queued, -1, SDL_GetError());
+  writer = SDL_CreateThread(write_records, "stats", 0);
+  COND_ERET_IF0(writer, -1, SDL_GetError());
+  return 0;
+}
+
+void
+destroy_stats(void) {
+  if (writer) {
+    SDL_AtomicSet(&quit, 1);
+    SDL_SemPost(queued);
+    SDL_WaitThread(writer, 0);
+    writer = 0;
+  }
+  if (queued) {
+    SDL_DestroySemaphore(queued);
+    queued = 0;
+  }
+  if (session.games > 0) {
+    SDL_Log("stats: %u games, %u pieces, %u inputs, best %u, "
+      "clears %u/%u/%u/%u, %d records dropped, %d not written",
+      (unsigned) session.games, (unsigned) session.pieces,
+      (unsigned) session.inputs, (unsigned) session.best_points,
+      (unsigned) session.clears[0], (unsigned) session.clears[1],
+      (unsigned) session.clears[2], (unsigned) session.clears[3], dropped,
+      SDL_AtomicGet(&write_failures));
+  }
+}
+
+void
+stats_game_start(Uint32 now_ms) {
+  SDL_memset(&game, 0, sizeof game);
+  game.start_ms = now_ms;
+  game.last_spawn_ms = now_ms;
+  game.sample_period = 1;
+  game.pieces_to_sample = 1;
+}
+
+void
+stats_spawn(Uint32 now_ms) {
+  Uint32 interval = now_ms - game.last_spawn_ms;
+  int bucket = SDL_min(interval/STATS_INTERVAL_BUCKET_MS,
+    STATS_INTERVAL_BUCKETS - 1);
+  if (game.pieces > 0) {
+    game.intervals[bucket]++;
+  }
+  game.last_spawn_ms = now_ms;
+  game.pieces++;
+}
+
+void
+stats_input(void) {
+  game.inputs++;
+}
+
+/**
+ * Halves the resolution of the samples: keeps every other one and samples
+ * half as often from now on.
+ */
+static void
+decimate_samples(void) {
+  for (int i = 0; i < game.num_samples/2; i++) {
+    game.heights[i] = game.heights[2*i];
+    game.scores[i] = game.scores[2*i];
+  }
+  game.num_samples /= 2;
+  game.sample_period *= 2;
+}
+
+void
+stats_lock(int lines, int points, int stack_height) {
+  if (lines > 0) {
+    game.clears[SDL_min(lines, 4) - 1]++;
+  }
+  game.points += points;
+
+  if (--game.pieces_to_sample > 0) {
+    return;
+  }
+  if (game.num_samples == STATS_MAX_SAMPLES) {
+    decimate_samples();
+  }
+  game.heights[game.num_samples] = stack_height;
+  game.scores[game.num_samples] = game.points;
+  game.num_samples++;
+  game.pieces_to_sample = game.sample_period;
+}
+
+void
+stats_game_end(Uint32 now_ms, int points) {
+  game.end_ms = now_ms;
+  game.points = points;
+
+  session.games++;
+  session.pieces += game.pieces;
+  session.inputs += game.inputs;
+  session.play_ms += game.end_ms - game.start_ms;
+  session.best_points = SDL_max(session.best_points, game.points);
+  for (int i = 0; i < 4; i++) {
+    session.clears[i] += game.clears[i];
+  }
+
+  if (!writer) {
+    return;
+  }
+  unsigned room;
+  unsigned head = ring_reserve(&ring, &room);
+  if (!room) {
+    dropped++;
+    return;
+  }
+  queue[ring_slot(&ring, head)] = game;
+  ring_publish(&ring, head, 1);
+  SDL_SemPost(queued);
+}
+
+const struct GameStats*
+get_game_stats(void) {
+  return &game;
+}
+
+const struct SessionStats*
+get_session_stats(void) {
+  return &session;
+}
@@ -0,0 +1,77 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Per game and per session statistics. The stats_* notifications only touch
+ * fixed size buffers, so they're cheap enough to call from the middle of the
+ * game logic. When a game ends, its record is handed to a writer thread
+ * which appends it to STATS_FILE.
+ *
+ * File format (little endian): "TSTA", version (u8), then one record per
+ * game:
+ *   duration ms (u32), points (u32), pieces (u32), inputs (u32),
+ *   line clears by size (4 x u16: single, double, triple, tetris),
+ *   spawn interval histogram (STATS_INTERVAL_BUCKETS x u16, bucket i counts
+ *   intervals in [i, i+1) * STATS_INTERVAL_BUCKET_MS, last one is open),
+ *   sample period in pieces (u16), number of samples (u16), stack height
+ *   samples (u8 each), score samples (u32 each, taken along with the
+ *   heights).
+ */
+
+enum {
+  STATS_VERSION = 1,
+  STATS_INTERVAL_BUCKETS = 16,
+  STATS_INTERVAL_BUCKET_MS = 100,
+  // Samples kept per game. Long games keep every other sample when this
+  // fills up, so the whole game is still covered.
+  STATS_MAX_SAMPLES = 512
+};
+
+struct GameStats {
+  Uint32 start_ms, end_ms, last_spawn_ms;
+  Uint32 points, pieces, inputs;
+  Uint16 clears[4];
+  Uint16 intervals[STATS_INTERVAL_BUCKETS];
+  Uint16 sample_period, num_samples, pieces_to_sample;
+  Uint8 heights[STATS_MAX_SAMPLES];
+  Uint32 scores[STATS_MAX_SAMPLES];
+};
+
+struct SessionStats {
+  Uint32 games, pieces, inputs, best_points, play_ms;
+  Uint32 clears[4];
+};
+
+int
+init_stats(void);
+
+void
+destroy_stats(void);
+
+void
+stats_game_start(Uint32 now_ms);
+
+void
+stats_spawn(Uint32 now_ms);
+
+/**
+ * Counts a player input that did something (moved or rotated a piece).
+ */
+void
+stats_input(void);
+
+void
+stats_lock(int lines, int points, int stack_height);
+
+void
+stats_game_end(Uint32 now_ms, int points);
+
+const struct GameStats*
+get_game_stats(void);
+
+const struct SessionStats*
+get_session_stats(void);
+
+#endif
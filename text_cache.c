@@ -0,0 +1,490 @@
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "assets.h"
+#include "error.h"
+#include "text_cache.h"
+
+struct TextEntry {
+  SDL_Texture *image;
+  SDL_Renderer *rend;
+  TTF_Font *font;
+  Uint32 color;
+  Uint32 hash;
+  char text[TEXT_CACHE_MAX_LEN];
+  // In logical pixels, and the texture's own.
+  PixelDim2D dim, size;
+  int refs;
+  // Value of use_clock when this entry was last asked for.
+  Uint32 last_use;
+  // What image was rasterized at.
+  double scale;
+  // Bumped whenever the entry gets evicted, so that what got rasterized for
+  // the text it had doesn't end up in it.
+  Uint32 gen;
+  // Allocated on its own, because it didn't fit in the cache.
+  int uncached;
+};
+
+enum {
+  // Scales are rounded to this many steps per 1, so resizing a window a
+  // pixel at a time doesn't rasterize everything over and over.
+  SCALE_STEPS = 4,
+
+  // Fonts that text gets drawn in at most.
+  MAX_FONTS = 8
+};
+
+/**
+ * Copies of fonts at some scale, opened as they're needed.
+ */
+struct FontSet {
+  TTF_Font *fonts[MAX_FONTS], *scaled[MAX_FONTS];
+  int num;
+};
+
+/**
+ * Rasterizing one entry again, at job_scale.
+ */
+struct Rescale {
+  struct TextEntry *e;
+  Uint32 gen;
+  // The entry's font at job_scale, or null if it couldn't be opened.
+  TTF_Font *font;
+  char text[TEXT_CACHE_MAX_LEN];
+  SDL_Color color;
+  SDL_Surface *surface;
+};
+
+enum RescaleState {
+  RESCALE_IDLE,
+  // The rescale thread is rasterizing.
+  RESCALE_RUNNING,
+  // It's done. The textures get swapped in on the drawing thread.
+  RESCALE_DONE
+};
+
+static struct TextEntry entries[TEXT_CACHE_ENTRIES];
+static struct TextCacheStats stats;
+static Uint32 use_clock;
+
+// What new text gets rasterized at, with main_fonts, and what it should be.
+static double scale = 1, wanted_scale = 1;
+static struct FontSet main_fonts;
+
+// The rescale thread only touches these while the state is RESCALE_RUNNING,
+// and the drawing thread only while it isn't.
+static struct Rescale rescales[TEXT_CACHE_ENTRIES];
+static int num_rescales, swapped;
+static double job_scale;
+static struct FontSet job_fonts;
+
+static SDL_Thread *rescale_thread;
+static SDL_sem *rescale_wake;
+static SDL_atomic_t rescale_state, rescale_quit;
+
+static Uint32
+pack_color(const SDL_Color *c) {
+  return (Uint32) c->r << 24 | (Uint32) c->g << 16 | (Uint32) c->b << 8
+    | c->a;
+}
+
+static SDL_Color
+unpack_color(Uint32 c) {
+  return (SDL_Color) {c >> 24, c >> 16 & 0xFF, c >> 8 & 0xFF, c & 0xFF};
+}
+
+// FNV-1a.
+static Uint32
+hash_text(const char *text) {
+  Uint32 h = 2166136261u;
+  for (; *text; text++) {
+    h = (h ^ (Uint8) *text)*16777619u;
+  }
+  return h;
+}
+
+static Uint32
+entry_bytes(const struct TextEntry *e) {
+  return (Uint32) e->size.w*e->size.h*4;
+}
+
+static void
+evict(struct TextEntry *e) {
+  SDL_assert(e->refs == 0);
+  stats.bytes -= entry_bytes(e);
+  stats.entries--;
+  stats.evictions++;
+  SDL_DestroyTexture(e->image);
+  e->image = 0;
+  e->gen++;
+}
+
+/**
+ * Destroys unused textures, least recently used first, until what's cached
+ * fits in the budget again.
+ */
+static void
+trim(void) {
+  while (stats.bytes > TEXT_CACHE_BUDGET) {
+    struct TextEntry *lru = 0;
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+      struct TextEntry *e = entries + i;
+      if (e->image && !e->refs && (!lru || e->last_use < lru->last_use)) {
+        lru = e;
+      }
+    }
+    if (!lru) {
+      // Everything is in use.
+      return;
+    }
+    evict(lru);
+  }
+}
+
+/**
+ * Finds a place for a new entry: an empty one, or else the least recently
+ * used unreferenced one. Returns null if all of them are in use.
+ */
+static struct TextEntry*
+free_entry(void) {
+  struct TextEntry *lru = 0;
+  for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    struct TextEntry *e = entries + i;
+    if (!e->image) {
+      return e;
+    }
+    if (!e->refs && (!lru || e->last_use < lru->last_use)) {
+      lru = e;
+    }
+  }
+  if (lru) {
+    evict(lru);
+  }
+  return lru;
+}
+
+/**
+ * font at s, opened if it wasn't yet. Returns null if it can't be opened.
+ */
+static TTF_Font*
+scaled_font(struct FontSet *set, TTF_Font *font, double s) {
+  for (int i = 0; i < set->num; i++) {
+    if (set->fonts[i] == font) {
+      return set->scaled[i];
+    }
+  }
+  if (set->num == MAX_FONTS) {
+    return 0;
+  }
+  set->fonts[set->num] = font;
+  set->scaled[set->num] = open_scaled_font(font, s);
+  return set->scaled[set->num++];
+}
+
+static void
+close_fonts(struct FontSet *set) {
+  for (int i = 0; i < set->num; i++) {
+    if (set->scaled[i]) {
+      TTF_CloseFont(set->scaled[i]);
+    }
+  }
+  set->num = 0;
+}
+
+static SDL_Texture*
+rasterize(TTF_Font *font,
+          const char *text,
+          SDL_Renderer *rend,
+          const SDL_Color *color,
+          PixelDim2D *dim,
+          PixelDim2D *size)
+{
+  TTF_Font *f = scale == 1 ? 0 : scaled_font(&main_fonts, font, scale);
+  if (!f) {
+    f = font;
+  }
+  SDL_Surface *stext = TTF_RenderText_Solid(f, text, *color);
+  COND_ERET_IF0(stext, 0, TTF_GetError());
+  SDL_Texture *image = SDL_CreateTextureFromSurface(rend, stext);
+  *size = (PixelDim2D) {stext->w, stext->h};
+  SDL_FreeSurface(stext);
+  COND_ERET_IF0(image, 0, SDL_GetError());
+
+  // The layout goes by the size it has in the font as it was asked for.
+  *dim = *size;
+  if (f != font && TTF_SizeText(font, text, &dim->w, &dim->h) < 0) {
+    *dim = (PixelDim2D) {size->w/scale + 0.5, size->h/scale + 0.5};
+  }
+  return image;
+}
+
+struct TextEntry*
+text_cache_get(TTF_Font *font,
+               const char *text,
+               SDL_Renderer *rend,
+               const SDL_Color *color,
+               PixelDim2D *dim)
+{
+  Uint32 hash = hash_text(text);
+  Uint32 packed = pack_color(color);
+  use_clock++;
+
+  for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    struct TextEntry *e = entries + i;
+    if (e->image && e->hash == hash && e->font == font && e->rend == rend
+        && e->color == packed && !strcmp(e->text, text))
+    {
+      stats.hits++;
+      e->refs++;
+      e->last_use = use_clock;
+      *dim = e->dim;
+      return e;
+    }
+  }
+
+  stats.misses++;
+  PixelDim2D size;
+  SDL_Texture *image = rasterize(font, text, rend, color, dim, &size);
+  if (!image) {
+    return 0;
+  }
+
+  int cached = 1;
+  struct TextEntry *e = strlen(text) < TEXT_CACHE_MAX_LEN ? free_entry() : 0;
+  if (!e) {
+    cached = 0;
+    e = SDL_malloc(sizeof *e);
+    if (!e) {
+      SDL_DestroyTexture(image);
+      COND_ERET(1, 0, "Out of memory for text.");
+    }
+  }
+  Uint32 gen = cached ? e->gen : 0;
+  *e = (struct TextEntry) {
+    .image = image,
+    .rend = rend,
+    .font = font,
+    .color = packed,
+    .hash = hash,
+    .dim = *dim,
+    .size = size,
+    .refs = 1,
+    .last_use = use_clock,
+    .scale = scale,
+    .gen = gen,
+    .uncached = !cached
+  };
+  if (cached) {
+    strcpy(e->text, text);
+    stats.entries++;
+    stats.bytes += entry_bytes(e);
+    trim();
+  }
+  return e;
+}
+
+SDL_Texture*
+text_cache_texture(const struct TextEntry *e) {
+  return e->image;
+}
+
+void
+text_cache_release(struct TextEntry *e) {
+  if (!e) {
+    return;
+  }
+  SDL_assert(e->refs > 0);
+  e->refs--;
+  if (e->uncached) {
+    // Nobody else has it.
+    SDL_DestroyTexture(e->image);
+    SDL_free(e);
+    return;
+  }
+  trim();
+}
+
+static int
+rescale_loop(void *arg) {
+  (void) arg;
+  for (;;) {
+    SDL_SemWait(rescale_wake);
+    if (SDL_AtomicGet(&rescale_quit)) {
+      return 0;
+    }
+    SDL_MemoryBarrierAcquire();
+    // Only rendering happens here. Opening and closing fonts isn't safe to
+    // do alongside the drawing thread, so that one does it.
+    for (int i = 0; i < num_rescales; i++) {
+      struct Rescale *r = rescales + i;
+      r->surface = r->font
+        ? TTF_RenderText_Solid(r->font, r->text, r->color) : 0;
+    }
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&rescale_state, RESCALE_DONE);
+  }
+}
+
+/**
+ * Starts rasterizing everything cached that isn't at wanted_scale again, if
+ * there's anything like that and nothing's going on already.
+ */
+static void
+start_rescale(void) {
+  if (SDL_AtomicGet(&rescale_state) != RESCALE_IDLE) {
+    return;
+  }
+  num_rescales = 0;
+  for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    struct TextEntry *e = entries + i;
+    if (e->image && e->scale != wanted_scale) {
+      struct Rescale *r = rescales + num_rescales++;
+      // Fonts of the job's own, even at scale 1: the drawing thread may be
+      // using the others meanwhile. Text in a font that can't be opened
+      // stays as it is.
+      *r = (struct Rescale) {
+        .e = e,
+        .gen = e->gen,
+        .font = scaled_font(&job_fonts, e->font, wanted_scale),
+        .color = unpack_color(e->color),
+        .surface = 0
+      };
+      strcpy(r->text, e->text);
+    }
+  }
+  if (!num_rescales) {
+    // Nothing to do again: new text just gets made at the new scale.
+    if (scale != wanted_scale) {
+      close_fonts(&main_fonts);
+      scale = wanted_scale;
+    }
+    return;
+  }
+
+  if (!rescale_thread) {
+    rescale_wake = SDL_CreateSemaphore(0);
+    rescale_thread = rescale_wake
+      ? SDL_CreateThread(rescale_loop, "textrescale", 0) : 0;
+    if (!rescale_thread) {
+      // The text that's there stays as it is, stretched.
+      SDL_Log("text cache: can't rescale: %s", SDL_GetError());
+      close_fonts(&job_fonts);
+      wanted_scale = scale;
+      return;
+    }
+  }
+  job_scale = wanted_scale;
+  swapped = 0;
+  SDL_AtomicSet(&rescale_state, RESCALE_RUNNING);
+  SDL_SemPost(rescale_wake);
+}
+
+void
+text_cache_set_scale(double s) {
+  s = SDL_max((int) (s*SCALE_STEPS + 0.5), 1)/(double) SCALE_STEPS;
+  if (s != wanted_scale) {
+    wanted_scale = s;
+    start_rescale();
+  }
+}
+
+int
+text_cache_update(void) {
+  switch (SDL_AtomicGet(&rescale_state)) {
+    case RESCALE_IDLE:
+      return 0;
+    case RESCALE_RUNNING:
+      return 1;
+  }
+  SDL_MemoryBarrierAcquire();
+
+  for (int n = 0; swapped < num_rescales && n < TEXT_CACHE_SWAPS_PER_UPDATE;
+       swapped++)
+  {
+    struct Rescale *r = rescales + swapped;
+    struct TextEntry *e = r->e;
+    // Evicted since, maybe for something else.
+    if (e->image && e->gen == r->gen) {
+      SDL_Texture *image = r->surface
+        ? SDL_CreateTextureFromSurface(e->rend, r->surface) : 0;
+      if (image) {
+        stats.bytes -= entry_bytes(e);
+        SDL_DestroyTexture(e->image);
+        e->image = image;
+        e->size = (PixelDim2D) {r->surface->w, r->surface->h};
+        stats.bytes += entry_bytes(e);
+        n++;
+      }
+      // Even if it failed, so it doesn't get tried over and over.
+      e->scale = job_scale;
+    }
+    if (r->surface) {
+      SDL_FreeSurface(r->surface);
+      r->surface = 0;
+    }
+  }
+  if (swapped < num_rescales) {
+    return 1;
+  }
+
+  // New text from now on gets made at the new scale, in the fonts the
+  // rescale thread opened.
+  close_fonts(&main_fonts);
+  main_fonts = job_fonts;
+  job_fonts.num = 0;
+  if (job_scale == 1) {
+    close_fonts(&main_fonts);
+  }
+  scale = job_scale;
+  stats.rescales++;
+  trim();
+  SDL_AtomicSet(&rescale_state, RESCALE_IDLE);
+  // Text made in the meantime, or the scale changed again.
+  start_rescale();
+  return SDL_AtomicGet(&rescale_state) != RESCALE_IDLE;
+}
+
+void
+destroy_text_cache(void) {
+  if (rescale_thread) {
+    SDL_AtomicSet(&rescale_quit, 1);
+    SDL_SemPost(rescale_wake);
+    SDL_WaitThread(rescale_thread, 0);
+    rescale_thread = 0;
+  }
+  if (rescale_wake) {
+    SDL_DestroySemaphore(rescale_wake);
+    rescale_wake = 0;
+  }
+  SDL_AtomicSet(&rescale_quit, 0);
+  SDL_AtomicSet(&rescale_state, RESCALE_IDLE);
+  for (int i = 0; i < num_rescales; i++) {
+    if (rescales[i].surface) {
+      SDL_FreeSurface(rescales[i].surface);
+      rescales[i].surface = 0;
+    }
+  }
+  num_rescales = 0;
+  close_fonts(&job_fonts);
+  close_fonts(&main_fonts);
+
+  SDL_Log("text cache: %u hits, %u misses, %u evictions, %u entries, "
+    "%u bytes, %u rescales", stats.hits, stats.misses, stats.evictions,
+    stats.entries, stats.bytes, stats.rescales);
+  for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    struct TextEntry *e = entries + i;
+    if (e->image) {
+      SDL_assert(e->refs == 0);
+      e->refs = 0;
+      evict(e);
+    }
+  }
+}
+
+const struct TextCacheStats*
+get_text_cache_stats(void) {
+  return &stats;
+}
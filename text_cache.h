@@ -0,0 +1,97 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "2D.h"
+
+/*
+ * Process wide cache of rasterized text, keyed by (renderer, font, text,
+ * color). Texts are shared and reference counted: every text_cache_get has
+ * to be matched by a text_cache_release. Released texts stay cached until
+ * the cache goes over TEXT_CACHE_BUDGET, and then the least recently used
+ * ones are destroyed first.
+ *
+ * Text is laid out in the renderer's logical pixels, but rasterized at the
+ * scale text_cache_set_scale says, so it stays sharp when the window is
+ * bigger than that or the display is hi-DPI. When the scale changes, a
+ * thread of the cache's own rasterizes everything cached again, and the new
+ * textures replace the old ones a few at a time as text_cache_update gets
+ * called, each only once it's ready. Until then, the old ones get drawn
+ * (stretched, so the layout is the same). Texts that didn't fit in the cache
+ * are left at the scale they were made at.
+ */
+
+enum {
+  TEXT_CACHE_ENTRIES = 128,
+  // Longer strings are rasterized every time, without being cached.
+  TEXT_CACHE_MAX_LEN = 64,
+  // Bytes of texture memory (4 per pixel) kept around for unused textures.
+  TEXT_CACHE_BUDGET = 2*1024*1024,
+  // Rasterized again textures that replace old ones per text_cache_update.
+  TEXT_CACHE_SWAPS_PER_UPDATE = 16
+};
+
+struct TextCacheStats {
+  Uint32 hits, misses, evictions;
+  Uint32 entries;
+  Uint32 bytes;
+  // Times everything got rasterized again at a new scale.
+  Uint32 rescales;
+};
+
+struct TextEntry;
+
+/**
+ * Returns the text, and its dimensions (in logical pixels) in *dim. Returns
+ * null on errors.
+ */
+struct TextEntry*
+text_cache_get(TTF_Font *font,
+               const char *text,
+               SDL_Renderer *rend,
+               const SDL_Color *color,
+               PixelDim2D *dim);
+
+/**
+ * The texture to draw the text with right now. It may change after a
+ * text_cache_update.
+ */
+SDL_Texture*
+text_cache_texture(const struct TextEntry *e);
+
+/**
+ * Gives back a text returned by text_cache_get. Null is ignored.
+ */
+void
+text_cache_release(struct TextEntry *e);
+
+/**
+ * Sets how many real pixels text gets per logical pixel (it's 1 to begin
+ * with). With nothing cached yet, it takes effect right away; otherwise, in
+ * the background.
+ */
+void
+text_cache_set_scale(double scale);
+
+/**
+ * Puts in whatever text the background rasterizing got done since the last
+ * call, up to TEXT_CACHE_SWAPS_PER_UPDATE textures. It has to be called on
+ * the thread that draws. Returns 1 while there's rescaling going on (so
+ * frames should keep coming), 0 otherwise.
+ */
+int
+text_cache_update(void);
+
+/**
+ * Destroys every cached texture. It has to be called before the renderer is
+ * destroyed, after all texts were released.
+ */
+void
+destroy_text_cache(void);
+
+const struct TextCacheStats*
+get_text_cache_stats(void);
+
+#endif
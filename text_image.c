@@ -1,10 +1,10 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
-#include "xSDL.h"
 #include "error.h"
 #include "assets.h"
 #include "text_image.h"
+#include "text_cache.h"
 
 int
 render_text_image(struct TextImage *ti) {
@@ -12,8 +12,8 @@ render_text_image(struct TextImage *ti) {
     .x = ti->pos.x, .y = ti->pos.y,
     .w = ti->dim.w, .h = ti->dim.h
   };
-  COND_ERET_LT0(SDL_RenderCopy(ti->rend, ti->image, 0, &region),
-    SDL_GetError());
+  SDL_Texture *image = text_cache_texture(ti->entry);
+  COND_ERET_LT0(SDL_RenderCopy(ti->rend, image, 0, &region), SDL_GetError());
   return 0;
 }
 
@@ -24,20 +24,11 @@ init_text_image(struct TextImage *ti,
                 SDL_Renderer *rend,
                 const SDL_Color *color)
 {
-  ti->image = 0;
-  SDL_Surface *stext = TTF_RenderText_Solid(font, text, *color);
-  COND_EGOTO_IF0(stext, e_cleanup, TTF_GetError());
-  ti->image = SDL_CreateTextureFromSurface(rend, stext);
-  COND_EGOTO_IF0(ti->image, e_cleanup, SDL_GetError());
-  ti->dim = (PixelDim2D) {stext->w, stext->h};
+  ti->entry = text_cache_get(font, text, rend, color, &ti->dim);
+  COND_ERET_IF0(ti->entry, -1, 0);
   ti->pos = (PixelPoint2D) {0, 0};
-  SDL_FreeSurface(stext);
   ti->rend = rend;
   return 0;
-
-e_cleanup:
-  SDL_FreeSurface(stext);
-  return -1;
 }
 
 int
@@ -50,5 +41,6 @@ in_bounds(const struct TextImage *ti, int x, int y) {
 
 void
 destroy_text_image(struct TextImage *ti) {
-  xSDL_DestroyTexture(&ti->image);
+  text_cache_release(ti->entry);
+  ti->entry = 0;
 }
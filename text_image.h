@@ -5,11 +5,13 @@
 #include <SDL2/SDL_ttf.h>
 
 #include "2D.h"
+#include "text_cache.h"
 
 struct TextImage {
   PixelDim2D dim;
   PixelPoint2D pos;
-  SDL_Texture *image;
+  // From the text cache.
+  struct TextEntry *entry;
   SDL_Renderer *rend;
 };
 
@@ -17,9 +19,10 @@ int
 render_text_image(struct TextImage *t);
 
 /**
- * Sets up a text image for you. It'll do the necessary steps to get a texture
- * in ti->image. You're responsible for destroying that texture with
- * SDL_DestroyTexture before destroying the renderer.
+ * Sets up a text image for you. It'll do the necessary steps to get the text
+ * in ti->entry. It comes from the text cache and may be shared with other text
+ * images, so give it back with destroy_text_image. The texture it's drawn
+ * with may change when the text cache rescales.
  *
  * It'll also initialize the dimension values. The position, though, is for the
  * user to setup. This function will zero the position.
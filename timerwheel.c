@@ -0,0 +1,197 @@
+#include <SDL2/SDL.h>
+
+#include "bytes.h"
+#include "timerwheel.h"
+
+/**
+ * Links timer i into the wheel slot its due tick goes in: the lowest level
+ * whose slots still tell it apart from now.
+ */
+static void
+insert(struct TimerWheel *w, int i) {
+  struct TimerSlot *t = w->timers + i;
+  Uint32 delta = t->due - w->now;
+  int level = 0;
+  while (level < TW_LEVELS - 1 && delta >> (TW_SLOT_BITS*(level + 1))) {
+    level++;
+  }
+  int list = level*TW_SLOTS
+    + ((t->due >> (TW_SLOT_BITS*level)) & (TW_SLOTS - 1));
+  t->list = list;
+  t->prev = -1;
+  t->next = w->heads[list];
+  if (t->next >= 0) {
+    w->timers[t->next].prev = i;
+  }
+  w->heads[list] = i;
+}
+
+static void
+unlink_timer(struct TimerWheel *w, int i) {
+  struct TimerSlot *t = w->timers + i;
+  if (t->prev >= 0) {
+    w->timers[t->prev].next = t->next;
+  }
+  else {
+    w->heads[t->list] = t->next;
+  }
+  if (t->next >= 0) {
+    w->timers[t->next].prev = t->prev;
+  }
+}
+
+static void
+free_timer(struct TimerWheel *w, int i) {
+  w->timers[i].active = 0;
+  w->timers[i].gen++;
+}
+
+static int
+timer_index(const struct TimerWheel *w, int id) {
+  if (id < 0) {
+    return -1;
+  }
+  int i = id % TW_MAX_TIMERS;
+  const struct TimerSlot *t = w->timers + i;
+  return t->active && t->gen == (Uint16) (id/TW_MAX_TIMERS) ? i : -1;
+}
+
+void
+tw_reset(struct TimerWheel *w) {
+  SDL_zerop(w);
+  for (int i = 0; i < TW_LEVELS*TW_SLOTS; i++) {
+    w->heads[i] = -1;
+  }
+}
+
+int
+tw_schedule(struct TimerWheel *w, Uint32 delay, int event) {
+  SDL_assert(delay >= 1 && delay <= TW_MAX_DELAY);
+  int i = 0;
+  while (i < TW_MAX_TIMERS && w->timers[i].active) {
+    i++;
+  }
+  if (i == TW_MAX_TIMERS) {
+    return TW_NONE;
+  }
+  struct TimerSlot *t = w->timers + i;
+  t->due = w->now + SDL_min(SDL_max(delay, 1u), (Uint32) TW_MAX_DELAY);
+  t->seq = w->next_seq++;
+  t->event = event;
+  t->active = 1;
+  insert(w, i);
+  return t->gen*TW_MAX_TIMERS + i;
+}
+
+void
+tw_cancel(struct TimerWheel *w, int id) {
+  int i = timer_index(w, id);
+  if (i >= 0) {
+    unlink_timer(w, i);
+    free_timer(w, i);
+  }
+}
+
+int
+tw_pending(const struct TimerWheel *w, int id) {
+  return timer_index(w, id) >= 0;
+}
+
+/**
+ * Moves the timers of a higher level slot down to where they go now.
+ */
+static void
+cascade(struct TimerWheel *w, int level) {
+  int list = level*TW_SLOTS
+    + ((w->now >> (TW_SLOT_BITS*level)) & (TW_SLOTS - 1));
+  int i = w->heads[list];
+  w->heads[list] = -1;
+  while (i >= 0) {
+    int next = w->timers[i].next;
+    insert(w, i);
+    i = next;
+  }
+}
+
+void
+tw_advance(struct TimerWheel *w) {
+  w->now++;
+  // Every level whose slot just changed, from the top down, so timers
+  // cascading from one level can go on to the one below.
+  int top = 0;
+  while (top < TW_LEVELS - 1
+         && !(w->now & ((1u << (TW_SLOT_BITS*(top + 1))) - 1)))
+  {
+    top++;
+  }
+  for (int level = top; level > 0; level--) {
+    cascade(w, level);
+  }
+}
+
+int
+tw_pop(struct TimerWheel *w) {
+  // All the timers in this slot are due now. Which of them came first is
+  // what makes the order the same every time.
+  int best = -1;
+  for (int i = w->heads[w->now & (TW_SLOTS - 1)]; i >= 0;
+       i = w->timers[i].next)
+  {
+    if (best < 0 || (Sint32) (w->timers[i].seq - w->timers[best].seq) < 0) {
+      best = i;
+    }
+  }
+  if (best < 0) {
+    return -1;
+  }
+  int event = w->timers[best].event;
+  unlink_timer(w, best);
+  free_timer(w, best);
+  return event;
+}
+
+void
+tw_save(const struct TimerWheel *w, Uint8 *out) {
+  out = put_u32(out, w->now);
+  out = put_u32(out, w->next_seq);
+  for (int i = 0; i < TW_MAX_TIMERS; i++) {
+    const struct TimerSlot *t = w->timers + i;
+    out = put_u16(out, t->gen);
+    *out++ = t->active;
+    *out++ = t->event;
+    out = put_u32(out, t->due);
+    out = put_u32(out, t->seq);
+  }
+}
+
+int
+tw_load(struct TimerWheel *w, const Uint8 *in) {
+  struct TimerWheel l;
+  tw_reset(&l);
+  l.now = get_u32(in);
+  l.next_seq = get_u32(in + 4);
+  in += 8;
+  for (int i = 0; i < TW_MAX_TIMERS; i++, in += 12) {
+    struct TimerSlot *t = l.timers + i;
+    t->gen = get_u16(in);
+    t->active = in[2];
+    t->event = in[3];
+    t->due = get_u32(in + 4);
+    t->seq = get_u32(in + 8);
+    if (t->active > 1) {
+      return -1;
+    }
+    if (t->active) {
+      // Anything already due would never fire.
+      Uint32 delta = t->due - l.now;
+      if (delta < 1 || delta > TW_MAX_DELAY) {
+        return -1;
+      }
+      // The slots it ends up in can differ from before, but not when it
+      // fires, or in which order.
+      insert(&l, i);
+    }
+  }
+  *w = l;
+  return 0;
+}
@@ -0,0 +1,105 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Hierarchical timer wheel, counting in ticks. Timers live in a fixed array
+ * (nothing gets allocated) and are linked, by index, into lists of the
+ * wheel's slots, so scheduling and cancelling take constant time. Level 0
+ * has a slot per tick for the next TW_SLOTS ticks, level 1 a slot per
+ * TW_SLOTS ticks after that, and so on; whenever level 0 comes around, the
+ * timers of the next level's slot get spread over it.
+ *
+ * Timers due on the same tick fire in the order they were scheduled, so
+ * the same calls always make a wheel fire the same way, which replays rely
+ * on. A wheel has no pointers: copying it is a snapshot, to roll back to or
+ * to write out (tw_save).
+ */
+
+enum {
+  TW_MAX_TIMERS = 16,
+
+  TW_SLOT_BITS = 6,
+  TW_SLOTS = 1 << TW_SLOT_BITS,
+  TW_LEVELS = 4,
+  // About 77 hours at 60 ticks per second.
+  TW_MAX_DELAY = (1 << (TW_SLOT_BITS*TW_LEVELS)) - 1,
+
+  // Not a timer: what tw_schedule returns when all of them are in use.
+  TW_NONE = -1,
+
+  // Bytes tw_save writes: the time and the next sequence number, then for
+  // each timer its generation, whether it's scheduled, its event, its due
+  // tick and sequence number.
+  TW_SAVE_SIZE = 2*4 + TW_MAX_TIMERS*(2 + 1 + 1 + 4 + 4)
+};
+
+struct TimerSlot {
+  Uint32 due;
+  // Order of scheduling, for ties.
+  Uint32 seq;
+  // Bumped every time the slot gets freed, so stale ids don't match.
+  Uint16 gen;
+  Uint8 event;
+  Uint8 active;
+  // Neighbors in the list of the wheel slot it's in, and which one that is.
+  Sint16 prev, next, list;
+};
+
+struct TimerWheel {
+  Uint32 now;
+  Uint32 next_seq;
+  struct TimerSlot timers[TW_MAX_TIMERS];
+  // First timer of each wheel slot, level by level.
+  Sint16 heads[TW_LEVELS*TW_SLOTS];
+};
+
+void
+tw_reset(struct TimerWheel *w);
+
+/**
+ * Schedules event (0 to 255) to fire delay ticks from now (1 to
+ * TW_MAX_DELAY). Returns an id for the timer, or TW_NONE if there's no room
+ * left.
+ */
+int
+tw_schedule(struct TimerWheel *w, Uint32 delay, int event);
+
+/**
+ * Stops timer id from firing. It's fine if it fired already, got cancelled
+ * already, or is TW_NONE.
+ */
+void
+tw_cancel(struct TimerWheel *w, int id);
+
+int
+tw_pending(const struct TimerWheel *w, int id);
+
+/**
+ * Moves the wheel a tick forward. The timers due then come out of tw_pop.
+ */
+void
+tw_advance(struct TimerWheel *w);
+
+/**
+ * Takes the next timer due now off the wheel and returns its event, or -1
+ * if there are none left.
+ */
+int
+tw_pop(struct TimerWheel *w);
+
+/**
+ * Writes the wheel, TW_SAVE_SIZE bytes, to out.
+ */
+void
+tw_save(const struct TimerWheel *w, Uint8 *out);
+
+/**
+ * Sets the wheel up as tw_save wrote it, timer ids included. Returns -1 if
+ * in doesn't make sense as one (and then *w is left as it was).
+ */
+int
+tw_load(struct TimerWheel *w, const Uint8 *in);
+
+#endif
@@ -0,0 +1,185 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <SDL2/SDL.h>
+
+#include "2D.h"
+#include "error.h"
+#include "screens.h"
+#include "delta.h"
+#include "multiview.h"
+#include "tournament.h"
+
+enum {
+  RECONNECT_DELAY_MS = 1000,
+  FEED_BUF_SIZE = 4096
+};
+
+struct Feed {
+  int fd;
+  int port;
+  Uint32 next_attempt_ms;
+  int used;
+  Uint8 buf[FEED_BUF_SIZE];
+};
+
+static struct Feed feeds[MAX_BOARDS];
+static struct DeltaBoard boards[MAX_BOARDS];
+static int num_feeds;
+static SDL_Renderer *g_rend;
+static PixelDim2D screen_dim;
+
+static void
+close_feed(struct Feed *f) {
+  if (f->fd >= 0) {
+    close(f->fd);
+    f->fd = -1;
+  }
+  f->used = 0;
+  f->next_attempt_ms = SDL_GetTicks() + RECONNECT_DELAY_MS;
+}
+
+static void
+destroy(void) {
+  for (int i = 0; i < num_feeds; i++) {
+    close_feed(feeds + i);
+  }
+  destroy_multiview();
+}
+
+static void
+try_connect(struct Feed *f) {
+  f->fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (f->fd < 0 || fcntl(f->fd, F_SETFL, O_NONBLOCK) < 0) {
+    close_feed(f);
+    return;
+  }
+  struct sockaddr_in addr;
+  SDL_memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(f->port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(f->fd, (struct sockaddr *) &addr, sizeof addr) < 0
+      && errno != EINPROGRESS)
+  {
+    close_feed(f);
+  }
+}
+
+/**
+ * Reads whatever arrived on a feed without blocking and applies it to its
+ * board. The feed always starts with a keyframe, so the board is right as
+ * soon as the first message is in.
+ */
+static void
+poll_feed(struct Feed *f, struct DeltaBoard *board) {
+  for (;;) {
+    ssize_t n = recv(f->fd, f->buf + f->used, FEED_BUF_SIZE - f->used, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK
+                   && errno != EINTR && errno != ENOTCONN))
+    {
+      close_feed(f);
+      return;
+    }
+    if (n < 0) {
+      return;
+    }
+    f->used += n;
+
+    int off = 0;
+    int len;
+    while ((len = delta_msg_len(f->buf + off, f->used - off)) > 0
+           && len <= f->used - off)
+    {
+      if (delta_apply(board, f->buf + off, len) < 0) {
+        close_feed(f);
+        return;
+      }
+      off += len;
+    }
+    if (len < 0) {
+      close_feed(f);
+      return;
+    }
+    f->used -= off;
+    SDL_memmove(f->buf, f->buf + off, f->used);
+  }
+}
+
+static int
+handle_event(const SDL_Event *e) {
+  if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_ESCAPE) {
+    change_screen(MENU_SCREEN);
+  }
+  return 0;
+}
+
+static int
+update(void) {
+  Uint32 now_ms = SDL_GetTicks();
+  for (int i = 0; i < num_feeds; i++) {
+    if (feeds[i].fd < 0 && (Sint32) (now_ms - feeds[i].next_attempt_ms) >= 0)
+    {
+      try_connect(feeds + i);
+    }
+    if (feeds[i].fd >= 0) {
+      poll_feed(feeds + i, boards + i);
+    }
+  }
+  return 0;
+}
+
+static int
+focus(void) {
+  return 0;
+}
+
+static int
+render(void) {
+  COND_PRET_LT0(render_multiview(boards, num_feeds));
+  return 0;
+}
+
+int
+init_tournament(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_,
+                int first_port, int num_ports)
+{
+  g_rend = g_rend_;
+  screen_dim = *screen_dim_;
+
+  COND_ERET(num_ports <= 0 || num_ports > MAX_BOARDS, -1,
+    "Bad number of feeds to watch.");
+  num_feeds = num_ports;
+  for (int i = 0; i < num_feeds; i++) {
+    feeds[i].fd = -1;
+    feeds[i].port = first_port + i;
+    feeds[i].used = 0;
+    feeds[i].next_attempt_ms = 0;
+    delta_reset(boards + i);
+  }
+
+  COND_PRET_LT0(init_multiview(g_rend));
+  const SDL_Rect area = {
+    .x = 0, .y = 0,
+    .w = screen_dim.w, .h = screen_dim.h
+  };
+  layout_multiview(num_feeds, &area);
+
+  const struct ScreenObject self = {
+    .focus = focus,
+    .render = render,
+    .update = update,
+    .handle_event = handle_event,
+    .destroy = destroy
+  };
+  register_screen(TOURNAMENT_SCREEN, &self);
+
+  return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <SDL2/SDL.h>
+
+#include "screens.h"
+#include "2D.h"
+
+/**
+ * Sets up the tournament screen: it watches the spectator feeds on ports
+ * first_port .. first_port + num_ports - 1 of this machine and shows all of
+ * those games at once. At most MAX_BOARDS (multiview.h) feeds.
+ */
+int
+init_tournament(SDL_Renderer *g_rend_, const PixelDim2D *screen_dim_,
+                int first_port, int num_ports);
+
+#endif
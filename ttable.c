@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "memtrack.h"
+#include "ttable.h"
+
+struct TTEntry {
+  // key ^ data, so a torn entry doesn't match any key.
+  Uint64 check;
+  // Value (float bits) in the low 32 bits, then depth (8 bits) and the
+  // search it came from (8 bits). 0 means the entry is empty.
+  Uint64 data;
+};
+
+struct TTBucket {
+  struct TTEntry entries[TT_BUCKET_ENTRIES];
+};
+
+struct TTable {
+  struct TTBucket *buckets;
+  Uint64 mask;
+  // What memtrack_malloc returned; buckets is this aligned to 64 bytes.
+  void *memory;
+  Uint8 generation;
+};
+
+enum {
+  CACHE_LINE = 64
+};
+
+// The compiler would reject this array if the bucket didn't fit a line.
+typedef char bucket_fits_cache_line[
+  sizeof (struct TTBucket) == CACHE_LINE ? 1 : -1];
+
+/*
+ * Plain loads and stores could be torn or reordered by the compiler. Each
+ * word is still read and written whole; the check word takes care of the
+ * two of them not matching.
+ */
+static Uint64
+load(const Uint64 *p) {
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static void
+store(Uint64 *p, Uint64 v) {
+  __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+static Uint64
+pack(int depth, float value, Uint8 generation) {
+  Uint32 bits;
+  SDL_memcpy(&bits, &value, sizeof bits);
+  return (Uint64) generation << 40 | (Uint64) (Uint8) (depth + 1) << 32
+    | bits;
+}
+
+static int
+data_depth(Uint64 data) {
+  return (int) (data >> 32 & 0xff) - 1;
+}
+
+static Uint8
+data_generation(Uint64 data) {
+  return (Uint8) (data >> 40);
+}
+
+struct TTable*
+tt_create(size_t bytes) {
+  struct TTable *t = memtrack_malloc(MEM_TTABLE, sizeof *t);
+  COND_ERET_IF0(t, 0, "Out of memory for the transposition table.");
+
+  size_t num_buckets = 1;
+  while (num_buckets*2*sizeof (struct TTBucket) <= bytes) {
+    num_buckets *= 2;
+  }
+  t->memory = memtrack_malloc(MEM_TTABLE,
+    num_buckets*sizeof (struct TTBucket) + CACHE_LINE - 1);
+  if (!t->memory) {
+    memtrack_free(t);
+    COND_ERET(1, 0, "Out of memory for the transposition table.");
+  }
+  t->buckets = (struct TTBucket *) (((size_t) t->memory + CACHE_LINE - 1)
+    & ~(size_t) (CACHE_LINE - 1));
+  t->mask = num_buckets - 1;
+  tt_clear(t);
+  return t;
+}
+
+void
+tt_destroy(struct TTable *t) {
+  if (t) {
+    memtrack_free(t->memory);
+    memtrack_free(t);
+  }
+}
+
+void
+tt_clear(struct TTable *t) {
+  memset(t->buckets, 0, (t->mask + 1)*sizeof (struct TTBucket));
+  t->generation = 0;
+}
+
+void
+tt_new_search(struct TTable *t) {
+  t->generation++;
+}
+
+int
+tt_probe(struct TTable *t, Uint64 key, int depth, float *value) {
+  struct TTBucket *bucket = t->buckets + (key & t->mask);
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    struct TTEntry *e = bucket->entries + i;
+    Uint64 data = load(&e->data);
+    if (data && (load(&e->check) ^ data) == key) {
+      if (data_depth(data) < depth) {
+        return 0;
+      }
+      Uint32 bits = (Uint32) data;
+      SDL_memcpy(value, &bits, sizeof *value);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void
+tt_store(struct TTable *t, Uint64 key, int depth, float value) {
+  struct TTBucket *bucket = t->buckets + (key & t->mask);
+  struct TTEntry *victim = 0;
+  int victim_score = 0;
+
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    struct TTEntry *e = bucket->entries + i;
+    Uint64 data = load(&e->data);
+    if (!data || (load(&e->check) ^ data) == key) {
+      // Empty, or the same position: a deeper result is worth more.
+      if (data && data_depth(data) > depth) {
+        return;
+      }
+      victim = e;
+      break;
+    }
+    // Older searches go first, then shallower results.
+    int score = (data_generation(data) == t->generation)*256
+      + data_depth(data);
+    if (!victim || score < victim_score) {
+      victim = e;
+      victim_score = score;
+    }
+  }
+
+  Uint64 data = pack(depth, value, t->generation);
+  store(&victim->data, data);
+  store(&victim->check, key ^ data);
+}
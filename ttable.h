@@ -0,0 +1,63 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+/*
+ * Transposition table: search results by board hash (see struct Board's
+ * hash), so positions reached through different moves are only searched
+ * once.
+ *
+ * Entries are grouped in buckets of TT_BUCKET_ENTRIES, each bucket one
+ * 64 byte cache line. A key picks a bucket and can go in any entry of it:
+ * when they're all taken, entries from older searches (see
+ * tt_new_search) are replaced first, then the shallowest.
+ *
+ * Any number of threads can probe and store at once without locks. Each
+ * entry is two 64 bit words, the data and the key xor the data, so a torn
+ * entry (half written by one thread, half by another) just doesn't match its
+ * key anymore and reads as a miss.
+ */
+
+enum {
+  TT_BUCKET_ENTRIES = 4
+};
+
+struct TTable;
+
+/**
+ * Makes a table of about bytes bytes (rounded down to a power of 2 number
+ * of buckets). Returns null on errors.
+ */
+struct TTable*
+tt_create(size_t bytes);
+
+void
+tt_destroy(struct TTable *t);
+
+/**
+ * Empties the table.
+ */
+void
+tt_clear(struct TTable *t);
+
+/**
+ * Marks the start of a new search: entries stored from now on are preferred
+ * to older ones when something has to be replaced.
+ */
+void
+tt_new_search(struct TTable *t);
+
+/**
+ * Looks key up. Returns 1 and sets *value if it was stored with at least
+ * the given depth.
+ */
+int
+tt_probe(struct TTable *t, Uint64 key, int depth, float *value);
+
+void
+tt_store(struct TTable *t, Uint64 key, int depth, float value);
+
+#endif
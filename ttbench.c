@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "bot.h"
+#include "ttable.h"
+
+/*
+ * Transposition table benchmark. Plays a game to collect positions, then
+ * runs the bot's search to the given depth on each of them without the
+ * table, with an empty table per position, and with one table kept across
+ * positions (as in the game). Then hammers a small table from several
+ * threads at once and counts entries that came back wrong.
+ *
+ * Usage: ttbench [POSITIONS [DEPTH]]
+ */
+
+enum {
+  MAX_POSITIONS = 1000,
+  STRESS_TABLE_BYTES = 64 << 10,
+  STRESS_OPS = 1 << 21
+};
+
+static struct Board positions[MAX_POSITIONS];
+
+static int
+collect_positions(int n) {
+  struct Board b;
+  board_reset(&b, 12345);
+  bot_configure(0, 1);
+  for (int i = 0; i < n; i++) {
+    if (board_spawn(&b) < 0) {
+      board_reset(&b, 12345 + i);
+      board_spawn(&b);
+    }
+    positions[i] = b;
+    bot_start(&b);
+    if (!bot_best()->depth) {
+      // Nowhere to go: start another game.
+      board_reset(&b, 12345 + i);
+      continue;
+    }
+    b.falling = bot_best()->piece;
+    struct LockResult lock;
+    board_fixate(&b, &lock);
+  }
+  return n;
+}
+
+/**
+ * Searches every position fully. mode 0: no table, 1: emptied for each
+ * position, 2: kept.
+ */
+static void
+run(const char *name, int mode, int n, int depth) {
+  bot_use_ttable(mode != 0);
+  bot_configure(SDL_MAX_UINT32, depth);
+  struct BotStats before = *get_bot_stats();
+
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (int i = 0; i < n; i++) {
+    if (mode == 1) {
+      bot_use_ttable(1);
+    }
+    bot_start(positions + i);
+    while (bot_think()) {
+      continue;
+    }
+  }
+  double ms = (SDL_GetPerformanceCounter() - start)*1000.0
+    / SDL_GetPerformanceFrequency();
+
+  const struct BotStats *after = get_bot_stats();
+  Uint64 probes = after->tt_probes - before.tt_probes;
+  Uint64 hits = after->tt_hits - before.tt_hits;
+  printf("%-14s %8.3f ms/position %12llu positions searched",
+    name, ms/n, (unsigned long long) (after->searched - before.searched));
+  if (probes) {
+    printf("  %5.1f%% hits", 100.0*hits/probes);
+  }
+  putchar('\n');
+}
+
+struct Stress {
+  struct TTable *table;
+  Uint32 seed;
+  Uint64 hits, wrong;
+};
+
+static float
+expected(Uint64 key) {
+  return (float) (key >> 44);
+}
+
+static int
+stress(void *arg) {
+  struct Stress *s = arg;
+  Uint32 x = s->seed;
+  for (int i = 0; i < STRESS_OPS; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    // Few enough keys that threads keep hitting each other's.
+    Uint64 key = (Uint64) (x % 50000 + 1)*0x9E3779B97F4A7C15ull;
+    float value;
+    if (tt_probe(s->table, key, 1, &value)) {
+      s->hits++;
+      s->wrong += value != expected(key);
+    }
+    else {
+      tt_store(s->table, key, 1, expected(key));
+    }
+  }
+  return 0;
+}
+
+static int
+run_stress(void) {
+  enum {
+    MAX_THREADS = 16
+  };
+  int num_threads = SDL_max(2, SDL_min(MAX_THREADS, SDL_GetCPUCount()));
+  struct TTable *table = tt_create(STRESS_TABLE_BYTES);
+  if (!table) {
+    fputs("Out of memory.\n", stderr);
+    return -1;
+  }
+
+  struct Stress s[MAX_THREADS];
+  SDL_Thread *threads[MAX_THREADS];
+  for (int i = 0; i < num_threads; i++) {
+    s[i] = (struct Stress) {table, 2463534242u + i*7919, 0, 0};
+    threads[i] = SDL_CreateThread(stress, "ttstress", s + i);
+    if (!threads[i]) {
+      fprintf(stderr, "%s\n", SDL_GetError());
+      return -1;
+    }
+  }
+  Uint64 hits = 0, wrong = 0;
+  for (int i = 0; i < num_threads; i++) {
+    SDL_WaitThread(threads[i], 0);
+    hits += s[i].hits;
+    wrong += s[i].wrong;
+  }
+  tt_destroy(table);
+
+  printf("stress: %d threads, %llu hits, %llu wrong\n", num_threads,
+    (unsigned long long) hits, (unsigned long long) wrong);
+  return wrong ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 100;
+  int depth = argc > 2 ? atoi(argv[2]) : 3;
+  if (n <= 0 || n > MAX_POSITIONS || depth < 1 || depth > BOT_MAX_DEPTH) {
+    fprintf(stderr, "Usage: %s [POSITIONS (1 to %d) [DEPTH (1 to %d)]]\n",
+      argv[0], MAX_POSITIONS, BOT_MAX_DEPTH);
+    return EXIT_FAILURE;
+  }
+  if (init_bot() < 0) {
+    fputs("Out of memory.\n", stderr);
+    return EXIT_FAILURE;
+  }
+
+  collect_positions(n);
+  printf("%d positions, depth %d\n", n, depth);
+  run("no table", 0, n, depth);
+  run("fresh table", 1, n, depth);
+  run("shared table", 2, n, depth);
+  destroy_bot();
+
+  return run_stress() < 0 ? EXIT_FAILURE : 0;
+}
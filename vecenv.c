@@ -0,0 +1,185 @@
+#include <SDL2/SDL.h>
+
+#include "error.h"
+#include "board.h"
+#include "jobs.h"
+#include "vecenv.h"
+
+enum {
+  // Jobs per thread. A few per thread evens out environments that happen to
+  // be slower (line clears, game overs) without paying much for scheduling.
+  JOBS_PER_THREAD = 4
+};
+
+struct VecEnv {
+  struct Board *boards;
+  Uint32 *seeds;
+  int num_envs;
+  struct EnvObs obs;
+  struct JobPool *pool;
+  int num_jobs;
+
+  // Arguments of the step being run.
+  const Uint8 *actions;
+  float *rewards;
+  Uint8 *dones;
+};
+
+static void
+write_obs(struct VecEnv *env, int i) {
+  const struct Board *b = env->boards + i;
+
+  Uint16 *occupancy = env->obs.occupancy + i*PANEL_ROWS;
+  SDL_memcpy(occupancy, b->rows, sizeof b->rows);
+
+  env->obs.piece[i] = board_is_falling(b) ? b->falling.kind : 255;
+  env->obs.next[i] = b->next.kind;
+  board_piece_cells(&b->falling, env->obs.piece_cells + i*NUM_PIECE_PARTS);
+
+  Uint8 *heights = env->obs.heights + i*PANEL_COLS;
+  Uint16 seen = 0;
+  SDL_memset(heights, 0, PANEL_COLS);
+  for (int y = PANEL_ROWS-1; y >= 0 && seen != FULL_ROW; y--) {
+    Uint16 fresh = b->rows[y] & ~seen;
+    for (int x = 0; fresh; x++, fresh >>= 1) {
+      if (fresh & 1) {
+        heights[x] = y + 1;
+      }
+    }
+    seen |= b->rows[y];
+  }
+}
+
+static void
+start_game(struct VecEnv *env, int i) {
+  board_reset(env->boards + i, env->seeds[i]);
+  ERR_IGNORE(board_spawn(env->boards + i));
+}
+
+/**
+ * One step of one environment. Returns the points scored; *done is set if
+ * the game ended.
+ */
+static int
+step_one(struct Board *b, int action, int *done) {
+  struct LockResult lock = {0, 0, 0};
+  int locked = 0;
+
+  switch (action) {
+    case ENV_LEFT:
+      board_move(b, -1, 0);
+      break;
+    case ENV_RIGHT:
+      board_move(b, 1, 0);
+      break;
+    case ENV_ROTATE:
+      board_rotate(b, 1);
+      break;
+    case ENV_ROTATE_CCW:
+      board_rotate(b, -1);
+      break;
+    case ENV_SOFT_DROP:
+      board_move(b, 0, -1);
+      break;
+    case ENV_HARD_DROP:
+      board_drop(b, PANEL_ROWS);
+      board_fixate(b, &lock);
+      locked = 1;
+      break;
+  }
+
+  // Gravity, one row per step.
+  if (!locked && !board_move(b, 0, -1)) {
+    board_fixate(b, &lock);
+    locked = 1;
+  }
+
+  *done = locked && board_spawn(b) < 0;
+  return lock.points;
+}
+
+static void
+step_job(void *ctx, int job_i) {
+  struct VecEnv *env = ctx;
+  int per_job = (env->num_envs + env->num_jobs - 1)/env->num_jobs;
+  int first = job_i*per_job;
+  int last = SDL_min(first + per_job, env->num_envs);
+
+  for (int i = first; i < last; i++) {
+    int done;
+    env->rewards[i] = step_one(env->boards + i, env->actions[i], &done);
+    env->dones[i] = done;
+    if (done) {
+      // Next seed is a pure function of the previous one so runs stay
+      // reproducible.
+      env->seeds[i] = env->seeds[i]*2654435761u + 1;
+      start_game(env, i);
+    }
+    write_obs(env, i);
+  }
+}
+
+static void
+reset_job(void *ctx, int job_i) {
+  struct VecEnv *env = ctx;
+  int per_job = (env->num_envs + env->num_jobs - 1)/env->num_jobs;
+  int first = job_i*per_job;
+  int last = SDL_min(first + per_job, env->num_envs);
+
+  for (int i = first; i < last; i++) {
+    start_game(env, i);
+    write_obs(env, i);
+  }
+}
+
+struct VecEnv*
+vecenv_create(int num_envs, int num_threads, const struct EnvObs *obs) {
+  COND_ERET(num_envs <= 0, 0, "Need at least one environment.");
+
+  struct VecEnv *env = SDL_calloc(1, sizeof *env);
+  COND_ERET_IF0(env, 0, "Out of memory.");
+  env->num_envs = num_envs;
+  env->obs = *obs;
+
+  env->boards = SDL_calloc(num_envs, sizeof *env->boards);
+  COND_EGOTO_IF0(env->boards, e_cleanup, "Out of memory.");
+  env->seeds = SDL_calloc(num_envs, sizeof *env->seeds);
+  COND_EGOTO_IF0(env->seeds, e_cleanup, "Out of memory.");
+  env->pool = create_job_pool(num_threads);
+  COND_PGOTO_IF0(env->pool, e_cleanup);
+
+  env->num_jobs = SDL_min(num_envs,
+    job_pool_threads(env->pool)*JOBS_PER_THREAD);
+  return env;
+
+e_cleanup:
+  vecenv_destroy(env);
+  return 0;
+}
+
+void
+vecenv_reset(struct VecEnv *env, const Uint32 *seeds) {
+  SDL_memcpy(env->seeds, seeds, env->num_envs * sizeof *seeds);
+  run_jobs(env->pool, reset_job, env, env->num_jobs);
+}
+
+void
+vecenv_step(struct VecEnv *env, const Uint8 *actions, float *rewards,
+            Uint8 *dones)
+{
+  env->actions = actions;
+  env->rewards = rewards;
+  env->dones = dones;
+  run_jobs(env->pool, step_job, env, env->num_jobs);
+}
+
+void
+vecenv_destroy(struct VecEnv *env) {
+  if (!env) {
+    return;
+  }
+  destroy_job_pool(env->pool);
+  SDL_free(env->seeds);
+  SDL_free(env->boards);
+  SDL_free(env);
+}
@@ -0,0 +1,73 @@
+#ifndef VECENV_H
+#define VECENV_H
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+
+/*
+ * Vectorized environment for reinforcement learning: many games stepped at
+ * once across threads, with the same rules and scoring as the game screen
+ * (both use board.c).
+ *
+ * Built as libtetrisenv.a / libtetrisenv.so (make env).
+ */
+
+enum EnvAction {
+  ENV_NOOP,
+  ENV_LEFT,
+  ENV_RIGHT,
+  ENV_ROTATE,
+  ENV_SOFT_DROP,
+  ENV_HARD_DROP,
+  ENV_ROTATE_CCW,
+  NUM_ENV_ACTIONS
+};
+
+/**
+ * Caller owned observation buffers, struct of arrays: entry i of each one
+ * belongs to environment i. They're written by vecenv_reset and
+ * vecenv_step.
+ */
+struct EnvObs {
+  // num_envs*PANEL_ROWS rows, bottom first. Bit j is column j.
+  Uint16 *occupancy;
+  // num_envs kinds of the falling piece (NO_PIECE as 255) and the next one.
+  Uint8 *piece;
+  Uint8 *next;
+  // num_envs*NUM_PIECE_PARTS cell indexes (y*PANEL_COLS + x) of the falling
+  // piece's blocks.
+  Uint8 *piece_cells;
+  // num_envs*PANEL_COLS column heights.
+  Uint8 *heights;
+};
+
+struct VecEnv;
+
+/**
+ * num_threads counts the calling thread; 0 means one per CPU. The buffers in
+ * *obs must stay valid until vecenv_destroy. Returns null on failure.
+ */
+struct VecEnv*
+vecenv_create(int num_envs, int num_threads, const struct EnvObs *obs);
+
+/**
+ * Starts a new game in every environment, seeded with seeds[i].
+ */
+void
+vecenv_reset(struct VecEnv *env, const Uint32 *seeds);
+
+/**
+ * Applies actions[i] (an EnvAction) to environment i and then lets gravity
+ * pull its piece one row. rewards[i] gets the points scored and dones[i] is
+ * set to 1 if the game ended, in which case the environment starts over on
+ * its own (from a seed derived from the one it was last reset with).
+ */
+void
+vecenv_step(struct VecEnv *env, const Uint8 *actions, float *rewards,
+            Uint8 *dones);
+
+void
+vecenv_destroy(struct VecEnv *env);
+
+#endif
@@ -0,0 +1,128 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <SDL2/SDL.h>
+
+#include "board.h"
+#include "delta.h"
+
+/*
+ * Headless spectator. Connects to a game started with --spectate PORT on this
+ * machine and prints the board every time a piece lands. With -q it only
+ * prints the bandwidth summary once the game goes away.
+ */
+
+enum {
+  READ_BUF_SIZE = 4096
+};
+
+static void
+print_board(const struct DeltaBoard *b) {
+  char rows[PANEL_ROWS][PANEL_COLS];
+  for (int i = 0; i < PANEL_ROWS; i++) {
+    for (int j = 0; j < PANEL_COLS; j++) {
+      rows[i][j] = b->cells[i][j] ? '0' + b->cells[i][j] : '.';
+    }
+  }
+  if (b->piece_kind) {
+    for (int i = 0; i < NUM_PIECE_PARTS; i++) {
+      if (b->piece[i] < PANEL_ROWS*PANEL_COLS) {
+        rows[b->piece[i]/PANEL_COLS][b->piece[i]%PANEL_COLS] = '#';
+      }
+    }
+  }
+  printf("pieces %u  points %u  next %d\n", (unsigned) b->pieces,
+    (unsigned) b->points, b->next_kind);
+  for (int i = PANEL_ROWS-1; i >= 0; i--) {
+    printf("|%.*s|\n", PANEL_COLS, rows[i]);
+  }
+  fflush(stdout);
+}
+
+int
+main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s PORT [-q]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  int port = atoi(argv[1]);
+  int quiet = argc > 2 && !strcmp(argv[2], "-q");
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return EXIT_FAILURE;
+  }
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+    perror("connect");
+    close(fd);
+    return EXIT_FAILURE;
+  }
+
+  struct DeltaBoard board;
+  delta_reset(&board);
+  Uint8 buf[READ_BUF_SIZE];
+  int used = 0;
+  unsigned long total_bytes = 0;
+  unsigned long keyframe_bytes = 0;
+  unsigned spawns = 0;
+  ssize_t n;
+
+  while ((n = read(fd, buf + used, sizeof buf - used)) > 0) {
+    total_bytes += n;
+    used += n;
+    int off = 0;
+    int len;
+    while ((len = delta_msg_len(buf + off, used - off)) > 0
+           && len <= used - off)
+    {
+      if (delta_apply(&board, buf + off, len) < 0) {
+        len = -1;
+        break;
+      }
+      switch (buf[off]) {
+        case DELTA_KEYFRAME:
+          keyframe_bytes += len;
+          break;
+        case DELTA_SPAWN:
+          spawns++;
+          break;
+        case DELTA_FIXATE:
+          if (!quiet) {
+            print_board(&board);
+          }
+          break;
+      }
+      off += len;
+    }
+    if (len < 0) {
+      fprintf(stderr, "Malformed stream (message type 0x%02x).\n", buf[off]);
+      break;
+    }
+    used -= off;
+    memmove(buf, buf + off, used);
+  }
+  close(fd);
+
+  printf("%lu bytes (%lu in keyframes), %u pieces", total_bytes,
+    keyframe_bytes, spawns);
+  if (spawns) {
+    printf(", %.1f bytes per piece without keyframes",
+      (double) (total_bytes - keyframe_bytes)/spawns);
+  }
+  putchar('\n');
+  return 0;
+}